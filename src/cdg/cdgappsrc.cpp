@@ -1,6 +1,7 @@
 #include "cdgappsrc.h"
 #include <gst/app/gstappsrc.h>
 #include "cdg/cdgfilereader.h"
+#include "cdg/cdgupscaler.h"
 #include <QMutex>
 #include <spdlog/spdlog.h>
 
@@ -10,19 +11,9 @@ CdgAppSrc::CdgAppSrc()
     m_cdgAppSrc = reinterpret_cast<GstAppSrc*>(gst_element_factory_make("appsrc", "cdgAppSrc"));
     g_object_ref(m_cdgAppSrc);
 
-    auto appSrcCaps = gst_caps_new_simple(
-                "video/x-raw",
-                "format", G_TYPE_STRING, "RGB8P",
-                "width",  G_TYPE_INT, cdg::FRAME_DIM_CROPPED.width(),
-                "height", G_TYPE_INT, cdg::FRAME_DIM_CROPPED.height(),
-                "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
-                NULL);
-
-    g_object_set(m_cdgAppSrc, "caps", appSrcCaps, NULL);
-    gst_caps_unref(appSrcCaps);
+    configureOutput();
 
     g_object_set(m_cdgAppSrc, "stream-type", GST_APP_STREAM_TYPE_SEEKABLE, "format", GST_FORMAT_TIME, NULL);
-    gst_app_src_set_max_bytes(m_cdgAppSrc, cdg::CDG_IMAGE_SIZE * 200);
 
     GstAppSrcCallbacks callbacks;
     callbacks.need_data	  = &CdgAppSrc::cb_need_data;
@@ -35,6 +26,64 @@ CdgAppSrc::~CdgAppSrc()
 {
     reset();
     g_object_unref(m_cdgAppSrc);
+    gst_buffer_pool_set_active(m_bufferPool, FALSE);
+    gst_object_unref(m_bufferPool);
+}
+
+void CdgAppSrc::configureOutput()
+{
+    const QSize frameSize = m_upscaler ? m_upscaler->outputSize() : cdg::FRAME_DIM_CROPPED;
+    m_frameBufferSize = m_upscaler ? m_upscaler->outputBufferSize() : cdg::CDG_IMAGE_SIZE;
+
+    auto appSrcCaps = gst_caps_new_simple(
+                "video/x-raw",
+                "format", G_TYPE_STRING, "RGB8P",
+                "width",  G_TYPE_INT, frameSize.width(),
+                "height", G_TYPE_INT, frameSize.height(),
+                "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+                // variable, frames are only pushed when the image changes
+                "framerate", GST_TYPE_FRACTION, 0, 1,
+                NULL);
+
+    g_object_set(m_cdgAppSrc, "caps", appSrcCaps, NULL);
+
+    if (m_bufferPool)
+    {
+        gst_buffer_pool_set_active(m_bufferPool, FALSE);
+        gst_object_unref(m_bufferPool);
+    }
+    // Frames are rendered straight into pooled buffers. There's no upper limit, the pool grows to what appsrc's
+    // queue and the downstream elements hold on to and stops allocating from there on.
+    m_bufferPool = gst_buffer_pool_new();
+    auto poolConfig = gst_buffer_pool_get_config(m_bufferPool);
+    gst_buffer_pool_config_set_params(poolConfig, appSrcCaps, m_frameBufferSize, 8, 0);
+    gst_buffer_pool_set_config(m_bufferPool, poolConfig);
+    gst_buffer_pool_set_active(m_bufferPool, TRUE);
+    gst_caps_unref(appSrcCaps);
+
+    // Upscaled frames are up to 16 times larger, queue fewer of them
+    gst_app_src_set_max_bytes(m_cdgAppSrc, m_frameBufferSize * (m_upscaler ? 20 : 200));
+}
+
+void CdgAppSrc::setPrescaleFactor(int factor)
+{
+    QMutexLocker locker(&m_cdgFileReaderLock);
+    if (factor < 2)
+    {
+        if (!m_upscaler)
+            return;
+        m_upscaler.reset();
+    }
+    else
+    {
+        if (m_upscaler && m_upscaler->factor() == factor)
+            return;
+        m_upscaler = std::make_unique<CdgUpscaler>(factor);
+    }
+    configureOutput();
+    logger->debug("{} Output size set to {}x{}", m_loggingPrefix,
+                  m_upscaler ? m_upscaler->outputSize().width() : cdg::FRAME_DIM_CROPPED.width(),
+                  m_upscaler ? m_upscaler->outputSize().height() : cdg::FRAME_DIM_CROPPED.height());
 }
 
 GstElement *CdgAppSrc::getSrcElement()
@@ -46,15 +95,40 @@ void CdgAppSrc::reset()
 {
     g_appSrcNeedData = false;
     QMutexLocker locker(&m_cdgFileReaderLock);
-    delete m_cdgFileReader;
-    m_cdgFileReader = nullptr;
+    m_cdgFileReader.reset();
 }
 
 void CdgAppSrc::load(const QString& filename)
 {
     QMutexLocker locker(&m_cdgFileReaderLock);
     reset();
-    m_cdgFileReader = new CdgFileReader(filename);
+    m_cdgFileReader = std::make_shared<CdgFileReader>(filename);
+    // Decoding the whole file for the seek index takes a while for long songs, keep it off the GUI thread and the lock
+    m_cdgFileReader->indexInBackground();
+    if (m_upscaler)
+        m_upscaler->invalidate();
+    gst_app_src_set_duration(m_cdgAppSrc, m_cdgFileReader->getTotalDurationMS() * GST_MSECOND);
+}
+
+void CdgAppSrc::load(const QByteArray& cdgData)
+{
+    QMutexLocker locker(&m_cdgFileReaderLock);
+    reset();
+    m_cdgFileReader = std::make_shared<CdgFileReader>(cdgData);
+    m_cdgFileReader->indexInBackground();
+    if (m_upscaler)
+        m_upscaler->invalidate();
+    gst_app_src_set_duration(m_cdgAppSrc, m_cdgFileReader->getTotalDurationMS() * GST_MSECOND);
+}
+
+void CdgAppSrc::load(std::shared_ptr<CdgFileReader> cdgFileReader)
+{
+    QMutexLocker locker(&m_cdgFileReaderLock);
+    reset();
+    m_cdgFileReader = std::move(cdgFileReader);
+    m_cdgFileReader->indexInBackground();
+    if (m_upscaler)
+        m_upscaler->invalidate();
     gst_app_src_set_duration(m_cdgAppSrc, m_cdgFileReader->getTotalDurationMS() * GST_MSECOND);
 }
 
@@ -75,34 +149,80 @@ void CdgAppSrc::cb_need_data(GstAppSrc *appsrc, [[maybe_unused]]guint unused_siz
 
     while (instance->g_appSrcNeedData)
     {
-        if(instance->m_cdgFileReader->moveToNextFrame())
+        auto buffer = instance->acquireFrameBuffer();
+        if (buffer == nullptr)
+        {
+            instance->logger->error("{} Unable to get a frame buffer from the pool", instance->m_loggingPrefix);
+            return;
+        }
+        GstMapInfo map;
+        gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+        bool moreFrames;
+        if (instance->m_upscaler)
         {
-            auto buffer = gst_buffer_new_and_alloc(cdg::CDG_IMAGE_SIZE);
-            gst_buffer_fill(buffer,
-                            0,
-                            instance->m_cdgFileReader->currentFrame().data(),
-                            cdg::CDG_IMAGE_SIZE
-                            );
-
-            GST_BUFFER_PTS(buffer) = instance->m_cdgFileReader->currentFramePositionMS() * GST_MSECOND;
-            GST_BUFFER_DURATION(buffer) = instance->m_cdgFileReader->currentFrameDurationMS() * GST_MSECOND;
-
-            auto rc = gst_app_src_push_buffer(appsrc, buffer);
-
-            if (rc != GST_FLOW_OK)
-            {
-                instance->logger->trace("{} Push buffer returned non-OK status", instance->m_loggingPrefix);
-                break;
-            }
+            moreFrames = instance->m_cdgFileReader->moveToNextFrame();
+            if (moreFrames)
+                instance->m_upscaler->render(instance->m_cdgFileReader->currentFrame().data(),
+                                             instance->m_cdgFileReader->currentFrameChangedRect(), map.data);
         }
         else
         {
+            moreFrames = instance->m_cdgFileReader->moveToNextFrame(map.data);
+        }
+        gst_buffer_unmap(buffer, &map);
+
+        if (!moreFrames)
+        {
+            gst_buffer_unref(buffer);
             gst_app_src_end_of_stream(appsrc);
             return;
         }
+
+        GST_BUFFER_PTS(buffer) = instance->m_cdgFileReader->currentFramePositionMS() * GST_MSECOND;
+        GST_BUFFER_DURATION(buffer) = instance->m_cdgFileReader->currentFrameDurationMS() * GST_MSECOND;
+        instance->m_statsFrames++;
+        instance->m_statsBytesCopied += instance->m_frameBufferSize;
+        instance->updateStats();
+
+        auto rc = gst_app_src_push_buffer(appsrc, buffer);
+
+        if (rc != GST_FLOW_OK)
+        {
+            instance->logger->trace("{} Push buffer returned non-OK status", instance->m_loggingPrefix);
+            break;
+        }
     }
 }
 
+GstBuffer *CdgAppSrc::acquireFrameBuffer()
+{
+    static const GQuark pooledQuark = g_quark_from_static_string("okj-cdg-pooled");
+    GstBuffer *buffer{nullptr};
+    if (gst_buffer_pool_acquire_buffer(m_bufferPool, &buffer, nullptr) != GST_FLOW_OK)
+        return nullptr;
+    // Recycled buffers keep their qdata, so an unmarked one was just allocated by the pool
+    if (gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(buffer), pooledQuark) == nullptr)
+    {
+        gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(buffer), pooledQuark, GINT_TO_POINTER(1), nullptr);
+        m_statsAllocations++;
+    }
+    return buffer;
+}
+
+void CdgAppSrc::updateStats()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_statsStart).count();
+    if (elapsed < 1000)
+        return;
+    logger->debug("{} Last {}ms: {} frames, {} buffer allocations, {} bytes copied", m_loggingPrefix, elapsed,
+                  m_statsFrames, m_statsAllocations, m_statsBytesCopied);
+    m_statsStart = now;
+    m_statsFrames = 0;
+    m_statsAllocations = 0;
+    m_statsBytesCopied = 0;
+}
+
 void CdgAppSrc::cb_enough_data([[maybe_unused]]GstAppSrc *appsrc, [[maybe_unused]]gpointer user_data)
 {
     auto instance = reinterpret_cast<CdgAppSrc *>(user_data);
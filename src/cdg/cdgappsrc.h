@@ -6,17 +6,33 @@
 #include <QRecursiveMutex>
 #include "cdgfilereader.h"
 #include <spdlog/logger.h>
+#include <chrono>
+#include <memory>
+
+class CdgUpscaler;
 
 class CdgAppSrc
 {
 
 private:
     GstAppSrc *m_cdgAppSrc { nullptr };
+    GstBufferPool *m_bufferPool { nullptr };
+    std::unique_ptr<CdgUpscaler> m_upscaler;
+    int m_frameBufferSize{cdg::CDG_IMAGE_SIZE};
+    void configureOutput();
 
-    CdgFileReader *m_cdgFileReader { nullptr };
+    std::shared_ptr<CdgFileReader> m_cdgFileReader;
     std::atomic<bool> g_appSrcNeedData { false };
     QRecursiveMutex m_cdgFileReaderLock{};
 
+    // Streaming thread counters, logged about once a second while frames are being produced
+    std::chrono::steady_clock::time_point m_statsStart{std::chrono::steady_clock::now()};
+    quint64 m_statsFrames{0};
+    quint64 m_statsAllocations{0};
+    quint64 m_statsBytesCopied{0};
+    GstBuffer* acquireFrameBuffer();
+    void updateStats();
+
     // AppSrc callbacks
     static void cb_need_data(GstAppSrc *appsrc, guint unused_size, gpointer user_data);
     static void cb_enough_data(GstAppSrc *appsrc, gpointer user_data);
@@ -31,12 +47,25 @@ public:
     GstElement* getSrcElement();
     void reset();
     void load(const QString& filename);
+    void load(const QByteArray& cdgData);
+    /**
+     * @brief Play from a reader that was already set up, e.g. parsed and indexed ahead of time by NextSongStager.
+     * The reader must not have produced any frames yet.
+     */
+    void load(std::shared_ptr<CdgFileReader> cdgFileReader);
+
+    /**
+     * @brief Output frames upscaled with a pixel-art scaler instead of at the native 288x192.
+     * Only call while the element isn't streaming, it changes the caps.
+     * @param factor 2 to 4, or 1 for no upscaling.
+     */
+    void setPrescaleFactor(int factor);
 
     /**
      * Returns the position of the very last frame.
      * This can be less than the total duration, beceause: "total duration = position + duration of final frame".
      *
-     * @return The value is not known until all data is read. If so, -1 is returned.
+     * @return -1 if nothing is loaded or the file has no visible frames.
      */
     int positionOfFinalFrameMS();
 
@@ -1,10 +1,15 @@
 #include "cdgfilereader.h"
 #include <QFile>
+#include <QtConcurrent>
 #include <spdlog/spdlog.h>
+#include <chrono>
 
 constexpr int CDG_PACKAGES_PER_SECOND = 300;
 constexpr int MAXFPS = 60;  // no need to go higher than 60 fps
 constexpr int MIN_PACKAGES_BEFORE_NEW_FRAME = CDG_PACKAGES_PER_SECOND / MAXFPS;
+// Each keyframe holds a full copy of the 300x216 indexed image, ~65KB, so a 5 minute song indexes to about 10MB.
+// A seek replays at most the 600 packages from the keyframe before it, well under a millisecond of decoding.
+constexpr int KEYFRAME_INTERVAL_PACKAGES = CDG_PACKAGES_PER_SECOND * 2;
 
 CdgFileReader::CdgFileReader(const QString &filename)
 {
@@ -16,6 +21,26 @@ CdgFileReader::CdgFileReader(const QString &filename)
     rewind();
 }
 
+CdgFileReader::CdgFileReader(const QByteArray &cdgData) :
+    m_cdgData(cdgData)
+{
+    logger = spdlog::get("logger");
+    rewind();
+}
+
+void CdgFileReader::indexInBackground()
+{
+    if (m_index || m_indexing)
+        return;
+    m_indexFuture = QtConcurrent::run(&CdgFileReader::buildKeyframeIndex, m_cdgData);
+    m_indexing = true;
+}
+
+void CdgFileReader::buildIndex()
+{
+    keyframeIndex();
+}
+
 int CdgFileReader::getTotalDurationMS()
 {
     return getDurationOfPackagesInMS(m_cdgData.length() / (int)sizeof (cdg::CDG_SubCode));
@@ -23,10 +48,21 @@ int CdgFileReader::getTotalDurationMS()
 
 int CdgFileReader::positionOfFinalFrameMS()
 {
-    return isEOF() ? getDurationOfPackagesInMS(m_last_image_change_pgk_idx) : -1;
+    const int lastImageChangePkgIdx = keyframeIndex().lastImageChangePkgIdx;
+    return lastImageChangePkgIdx < 0 ? -1 : getDurationOfPackagesInMS(lastImageChangePkgIdx);
+}
+
+const cdg::PacketErrors &CdgFileReader::packetErrors()
+{
+    return keyframeIndex().packetErrors;
 }
 
 bool CdgFileReader::moveToNextFrame()
+{
+    return moveToNextFrame(m_current_image_data.data());
+}
+
+bool CdgFileReader::moveToNextFrame(uchar *frameBuffer)
 {
     if (m_current_image_pgk_idx == 0)
     {
@@ -35,7 +71,9 @@ bool CdgFileReader::moveToNextFrame()
     }
 
     // shift m_next_image to current image
-    m_next_image.copyCroppedImagedata(m_current_image_data.data());
+    m_next_image.copyCroppedImagedata(frameBuffer);
+    m_current_image_changed_rect = m_next_image.changedRect();
+    m_next_image.clearChangedRect();
     m_current_image_pgk_idx = m_next_image_pgk_idx;
 
     bool imageChanged = false;
@@ -59,7 +97,6 @@ bool CdgFileReader::moveToNextFrame()
         if(readAndProcessNextPackage())
         {
             imageChanged = true;
-            m_last_image_change_pgk_idx = m_next_image_pgk_idx;
         }
     }
 }
@@ -80,21 +117,41 @@ bool CdgFileReader::seek(int positionMS)
 
     if (pkgIdx > m_cdgData.length() / (int)sizeof(cdg::CDG_SubCode))
     {
-        logger->warn("CDG: Tried to seek past file size!", m_loggingPrefix);
+        logger->warn("{} Tried to seek past file size!", m_loggingPrefix);
         return false;
     }
 
-    if (pkgIdx < m_current_image_pgk_idx)
+    auto st = std::chrono::steady_clock::now();
+    int startPkgIdx = m_next_image_pgk_idx;
+    const auto &keyframes = keyframeIndex().keyframes;
+    if (!keyframes.empty())
+    {
+        const auto &keyframe = keyframes.at(std::min(pkgIdx / KEYFRAME_INTERVAL_PACKAGES, (int)keyframes.size() - 1));
+        if (pkgIdx < m_current_image_pgk_idx || keyframe.pkgIdx > m_next_image_pgk_idx)
+        {
+            m_next_image = keyframe.image;
+            m_next_image_pgk_idx = keyframe.pkgIdx;
+            m_cdgDataPos = keyframe.pkgIdx * (int)sizeof(cdg::CDG_SubCode);
+            m_current_image_pgk_idx = keyframe.pkgIdx;
+            startPkgIdx = keyframe.pkgIdx;
+        }
+    }
+    else if (pkgIdx < m_current_image_pgk_idx)
     {
-        logger->debug("CDG: Seek backwards - rewinding", m_loggingPrefix);
         rewind();
+        startPkgIdx = 0;
     }
 
     while (m_next_image_pgk_idx < pkgIdx)
     {
         readAndProcessNextPackage();
     }
+    // Whatever was displayed before the seek, the next frame has to be drawn in full
+    m_next_image.markAllChanged();
 
+    logger->trace("{} Seek to {}ms replayed {} packages in {}us", m_loggingPrefix, positionMS,
+                  m_next_image_pgk_idx - startPkgIdx,
+                  std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - st).count());
     return true;
 }
 
@@ -104,8 +161,48 @@ void CdgFileReader::rewind()
     m_current_image_data.fill(0); // all black frame
     m_current_image_pgk_idx = 0;
     m_next_image = CdgImageFrame();
+    m_next_image.markAllChanged();
     m_next_image_pgk_idx = 0;
-    m_last_image_change_pgk_idx = -1;
+}
+
+std::shared_ptr<const CdgFileReader::KeyframeIndex> CdgFileReader::buildKeyframeIndex(const QByteArray &cdgData)
+{
+    auto st = std::chrono::steady_clock::now();
+    auto index = std::make_shared<KeyframeIndex>();
+    const int numPackages = cdgData.length() / (int)sizeof(cdg::CDG_SubCode);
+    auto subCodes = reinterpret_cast<const cdg::CDG_SubCode*>(cdgData.constData());
+    CdgImageFrame image;
+    index->keyframes.reserve(numPackages / KEYFRAME_INTERVAL_PACKAGES + 1);
+    for (int i = 0; i < numPackages; i++)
+    {
+        // Keyframe i holds the state after the first i packages, the same state readAndProcessNextPackage() reaches
+        if (i % KEYFRAME_INTERVAL_PACKAGES == 0)
+            index->keyframes.push_back({i, image});
+        if (image.applySubCode(subCodes[i]))
+            index->lastImageChangePkgIdx = i + 1;
+    }
+    index->packetErrors = image.packetErrors();
+    index->buildTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - st).count();
+    return index;
+}
+
+const CdgFileReader::KeyframeIndex &CdgFileReader::keyframeIndex()
+{
+    if (m_index)
+        return *m_index;
+    m_index = m_indexing ? m_indexFuture.result() : buildKeyframeIndex(m_cdgData);
+    m_indexing = false;
+    const auto &packetErrors = m_index->packetErrors;
+    if (packetErrors.total() > 0)
+        logger->warn("{} File contains {} corrupted packages (row: {} column: {} color: {} scroll: {})", m_loggingPrefix,
+                     packetErrors.total(), packetErrors.row, packetErrors.column, packetErrors.color,
+                     packetErrors.scroll);
+    // Indexing decodes every package once, so this doubles as the decoder's throughput
+    const int numPackages = m_cdgData.length() / (int)sizeof(cdg::CDG_SubCode);
+    const auto elapsedUs = m_index->buildTimeUs;
+    logger->debug("{} Indexed {} keyframes for {} packages in {}ms ({} packages/s)", m_loggingPrefix, m_index->keyframes.size(),
+                  numPackages, elapsedUs / 1000, elapsedUs > 0 ? numPackages * 1000000LL / elapsedUs : 0);
+    return *m_index;
 }
 
 bool CdgFileReader::readAndProcessNextPackage()
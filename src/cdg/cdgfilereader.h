@@ -1,16 +1,36 @@
 #ifndef CDGFILEREADER_H
 #define CDGFILEREADER_H
 
+#include <QFuture>
 #include <QString>
 #include "cdgimageframe.h"
 #include "libCDG.h"
 #include <spdlog/logger.h>
+#include <memory>
+#include <vector>
 
 class CdgFileReader
 {
 public:
     explicit CdgFileReader(const QString &filename);
 
+    /**
+     * @brief Read CDG packets from a buffer that is already in memory (e.g. decompressed from a zip).
+     * @note The data is implicitly shared, no copy is made.
+     */
+    explicit CdgFileReader(const QByteArray &cdgData);
+
+    /**
+     * @brief Build the keyframe index on the global thread pool now instead of on first use.
+     * seek(), positionOfFinalFrameMS() and packetErrors() wait for it if they need it before it is done.
+     */
+    void indexInBackground();
+
+    /**
+     * @brief Build the keyframe index on the calling thread now instead of on first use.
+     */
+    void buildIndex();
+
     /**
      * @brief Read first/next frame from the data stream.
      * @note  Replaces currentFrame() with the next frame with visible changes and
@@ -19,13 +39,26 @@ public:
      */
     bool moveToNextFrame();
 
-    std::array<uchar, cdg::CDG_IMAGE_SIZE> currentFrame() { return m_current_image_data; }
+    /**
+     * @brief Same as moveToNextFrame(), but renders the new current frame (cropped image followed by the palette)
+     * straight into frameBuffer instead of currentFrame().
+     * @param frameBuffer At least cdg::CDG_IMAGE_SIZE bytes, e.g. a mapped GstBuffer.
+     */
+    bool moveToNextFrame(uchar *frameBuffer);
+
+    [[nodiscard]] const std::array<uchar, cdg::CDG_IMAGE_SIZE> &currentFrame() const { return m_current_image_data; }
+    /**
+     * @brief Region of currentFrame() that differs from the frame before it, in cropped image coordinates.
+     * The whole frame after a seek.
+     */
+    [[nodiscard]] QRect currentFrameChangedRect() const { return m_current_image_changed_rect; }
     [[nodiscard]] int currentFrameDurationMS() const;
     [[nodiscard]] int currentFramePositionMS() const;
 
     /**
      * @brief Set currentFrame() to the frame that should be displayed at a given point in time.
-     * Note: If the position given is less than the position of currentFrame, the file is "rewinded" and read from the start.
+     * Note: Seeking backwards, or further ahead than the keyframe interval, restores the nearest keyframe before
+     * the position and replays the packages from there.
      * @param positionMS The position in milliseconds.
      * @return true is positionMS is within file range.
      */
@@ -41,10 +74,15 @@ public:
      * Returns the position of the very last frame.
      * This can be less than the total duration, beceause: "total duration = position + duration of final frame".
      *
-     * @return The value is not known until all data is read. If so, -1 is returned.
+     * @return -1 if the file has no visible frames.
      */
     int positionOfFinalFrameMS();
 
+    /**
+     * @brief Corrupted packages found in the file, counted while it's indexed.
+     */
+    const cdg::PacketErrors &packetErrors();
+
 #ifdef QT_DEBUG
     [[maybe_unused]] void saveNextImgToFile();
     [[maybe_unused]] void saveCurrentImgToFile();
@@ -64,14 +102,38 @@ private:
 
     std::array<uchar, cdg::CDG_IMAGE_SIZE> m_current_image_data{0};
     int m_current_image_pgk_idx{0};
+    QRect m_current_image_changed_rect;
 
     CdgImageFrame m_next_image;
     int m_next_image_pgk_idx{0};
 
     /**
-     * Index of the last read package that caused a visible image change.
+     * Complete decoder state (pixels, palette, scroll offsets) after every KEYFRAME_INTERVAL_PACKAGES packages,
+     * so seeking never has to replay more than one interval.
      */
-    int m_last_image_change_pgk_idx{0};
+    struct Keyframe {
+        int pkgIdx;
+        CdgImageFrame image;
+    };
+    /**
+     * Everything learned from decoding the whole file once. Built from a copy of the data only, so it can be built
+     * on another thread while the reader is already producing frames.
+     */
+    struct KeyframeIndex {
+        std::vector<Keyframe> keyframes;
+        /**
+         * Index of the last package in the file that causes a visible image change.
+         */
+        int lastImageChangePkgIdx{-1};
+        cdg::PacketErrors packetErrors;
+        qint64 buildTimeUs{0};
+    };
+    static std::shared_ptr<const KeyframeIndex> buildKeyframeIndex(const QByteArray &cdgData);
+    const KeyframeIndex &keyframeIndex();
+
+    std::shared_ptr<const KeyframeIndex> m_index;
+    QFuture<std::shared_ptr<const KeyframeIndex>> m_indexFuture;
+    bool m_indexing{false};
 };
 
 #endif // CDGFILEREADER_H
@@ -1,21 +1,21 @@
 #include "cdgimageframe.h"
 
+namespace {
+// For every 6 bit tile row: 0xFF where the pixel takes color1, 0x00 where it takes color0, leftmost pixel first.
+// Lets a tile row be drawn as color0 ^ ((color0 ^ color1) & mask) without a branch per pixel.
+constexpr auto TILE_ROW_MASKS = [] {
+    std::array<std::array<uchar, 6>, 64> masks{};
+    for (int bits = 0; bits < 64; bits++)
+        for (int px = 0; px < 6; px++)
+            masks[bits][px] = (bits & (0x20 >> px)) ? 0xFF : 0x00;
+    return masks;
+}();
+}
 
 CdgImageFrame::CdgImageFrame()
 {
-    m_image = QImage(cdg::FRAME_DIM_FULL, QImage::Format_Indexed8);
-
-    m_curHOffset = 0;
-    m_curVOffset = 0;
-    QVector<QRgb> palette;
-    for (int i=0; i < 16; i++)
-        palette.append(QColor(0,0,0).rgb());
-    m_image = QImage(cdg::FRAME_DIM_FULL, QImage::Format_Indexed8);
-    m_bytesPerPixel = m_image.pixelFormat().bitsPerPixel() / 8;
-    m_borderLRBytes = m_bytesPerPixel * 6;
-    m_borderRBytesOffset = 294 * m_bytesPerPixel;
-    m_image.setColorTable(palette);
-    m_image.fill(0);
+    m_pixels.fill(0);
+    m_palette.fill(qRgb(0, 0, 0));
 }
 
 bool CdgImageFrame::applySubCode(const cdg::CDG_SubCode &subCode)
@@ -30,23 +30,24 @@ bool CdgImageFrame::applySubCode(const cdg::CDG_SubCode &subCode)
     switch (subCode.instruction & SUBCODE_MASK)
     {
         case cdg::CmdMemoryPreset:
+            checkColorByte(subCode.data[0]);
             updated = cmdMemoryPreset(cdg::CdgMemoryPresetData(subCode.data));
             break;
         case cdg::CmdBorderPreset:
-            cmdBorderPreset(cdg::CdgBorderPresetData(subCode.data));
-            updated = true;
+            checkColorByte(subCode.data[0]);
+            updated = cmdBorderPreset(cdg::CdgBorderPresetData(subCode.data));
             break;
         case cdg::CmdTileBlock:
-            cmdTileBlock(cdg::CdgTileBlockData(subCode.data), cdg::TileBlockNormal);
-            updated = true;
+            checkColorByte(subCode.data[0]);
+            checkColorByte(subCode.data[1]);
+            updated = cmdTileBlock(cdg::CdgTileBlockData(subCode.data), cdg::TileBlockNormal);
             break;
         case cdg::CmdScrollPreset:
-            cmdScroll(subCode.data, cdg::ScrollPreset);
-            updated = true;
+            checkColorByte(subCode.data[0]);
+            updated = cmdScroll(subCode.data, cdg::ScrollPreset);
             break;
         case cdg::CmdScrollCopy:
-            cmdScroll(subCode.data, cdg::ScrollCopy);
-            updated = true;
+            updated = cmdScroll(subCode.data, cdg::ScrollCopy);
             break;
         case cdg::CmdDefineTrans:
             cmdDefineTransparent(subCode.data);
@@ -58,8 +59,9 @@ bool CdgImageFrame::applySubCode(const cdg::CDG_SubCode &subCode)
             updated = cmdColors(cdg::CdgColorsData(subCode.data), cdg::HighColors);
             break;
         case cdg::CmdTileBlockXOR:
-            cmdTileBlock(cdg::CdgTileBlockData(subCode.data), cdg::TileBlockXOR);
-            updated = true;
+            checkColorByte(subCode.data[0]);
+            checkColorByte(subCode.data[1]);
+            updated = cmdTileBlock(cdg::CdgTileBlockData(subCode.data), cdg::TileBlockXOR);
             break;
     }
     m_lastCmdWasMempreset = (subCode.instruction == cdg::CmdMemoryPreset);
@@ -69,38 +71,73 @@ bool CdgImageFrame::applySubCode(const cdg::CDG_SubCode &subCode)
 
 void CdgImageFrame::copyCroppedImagedata(uchar *destbuffer)
 {
-    uchar* src = m_image.bits();
+    const uchar* src = m_pixels.data() + WIDTH * (12 + m_curVOffset) + 6 + m_curHOffset; // 12?
     uchar* destpos = destbuffer;
 
     for (auto y=0; y < cdg::FRAME_DIM_CROPPED.height(); y++)
     {
-        auto curSrcLineNum = y + m_curVOffset;
-        auto srcLineOffset = m_image.bytesPerLine() * (12 + curSrcLineNum); // 12?
-
-        memcpy(destpos, src + srcLineOffset + m_borderLRBytes + m_curHOffset, cdg::FRAME_DIM_CROPPED.width());
+        memcpy(destpos, src, cdg::FRAME_DIM_CROPPED.width());
         destpos += cdg::FRAME_DIM_CROPPED.width();
+        src += WIDTH;
     }
 
-    // copy color table
-    memcpy(destpos, m_image.colorTable().data(), m_image.colorTable().length() * sizeof(uint));
+    // copy color table, the unused entries are zeroed since the destination may be a recycled buffer
+    memcpy(destpos, m_palette.data(), sizeof(m_palette));
+    memset(destpos + sizeof(m_palette), 0, 1024 - sizeof(m_palette));
 
 }
 
-void CdgImageFrame::cmdBorderPreset(const cdg::CdgBorderPresetData &borderPreset)
+QImage CdgImageFrame::getImage()
+{
+    QImage image = QImage(m_pixels.data(), WIDTH, HEIGHT, WIDTH, QImage::Format_Indexed8).copy();
+    QVector<QRgb> colors(m_palette.size());
+    std::copy(m_palette.begin(), m_palette.end(), colors.begin());
+    image.setColorTable(colors);
+    return image;
+}
+
+void CdgImageFrame::checkColorByte(char colorByte)
+{
+    // Only the low 4 bits hold the color index, the decoder masks the rest off
+    if (colorByte & 0x30)
+        m_packetErrors.color++;
+}
+
+bool CdgImageFrame::markChanged(const QRect &fullFrameRect)
+{
+    // The visible part of the frame moves with the scroll offsets
+    QRect visible = fullFrameRect.translated(-(6 + m_curHOffset), -(12 + m_curVOffset))
+            & QRect(QPoint(0, 0), cdg::FRAME_DIM_CROPPED);
+    if (visible.isEmpty())
+        return false;
+    m_changedRect |= visible;
+    return true;
+}
+
+bool CdgImageFrame::cmdBorderPreset(const cdg::CdgBorderPresetData &borderPreset)
 {
-    // Is there a safer C++ way to do these memory copies?
     if (borderPreset.color >= 16)
-        return;
-    for (auto line=0; line < 216; line++)
+        return false;
+    uchar *line = m_pixels.data();
+    for (auto y=0; y < HEIGHT; y++, line += WIDTH)
     {
-        if (line < 12 || line > 202)
-            memset(m_image.scanLine(line), borderPreset.color, m_image.bytesPerLine());
+        if (y < 12 || y > 202)
+            memset(line, borderPreset.color, WIDTH);
         else
         {
-            memset(m_image.scanLine(line), borderPreset.color, m_borderLRBytes);
-            memset(m_image.scanLine(line) + m_borderRBytesOffset, borderPreset.color, m_borderLRBytes);
+            memset(line, borderPreset.color, 6);
+            memset(line + 294, borderPreset.color, 6);
         }
     }
+    if (m_presetColor != borderPreset.color)
+        m_presetColor = -1;
+
+    // Only shows with a scroll offset set, the border is outside of the cropped image otherwise
+    bool changed = markChanged(QRect(0, 0, WIDTH, 12));
+    changed |= markChanged(QRect(0, 203, WIDTH, 13));
+    changed |= markChanged(QRect(0, 12, 6, 191));
+    changed |= markChanged(QRect(294, 12, 6, 191));
+    return changed;
 }
 
 bool CdgImageFrame::cmdColors(const cdg::CdgColorsData &data, const cdg::CdgColorTables &table)
@@ -108,13 +145,15 @@ bool CdgImageFrame::cmdColors(const cdg::CdgColorsData &data, const cdg::CdgColo
     bool changed{false};
     int curColor = (table == cdg::HighColors) ? 8 : 0;
     std::for_each(data.colors.begin(), data.colors.end(), [&] (auto color) {
-        if (m_image.colorTable().at(curColor) != color.rgb())
+        if (m_palette[curColor] != color.rgb())
         {
             changed = true;
-            m_image.setColor(curColor, color.rgb());
+            m_palette[curColor] = color.rgb();
         }
         curColor++;
     });
+    if (changed)
+        markAllChanged();
     return changed;
 }
 
@@ -128,107 +167,126 @@ bool CdgImageFrame::cmdMemoryPreset(const cdg::CdgMemoryPresetData &memoryPreset
     {
         return false;
     }
-    m_image.fill(memoryPreset.color);
-    return true;
+    // Presets are usually sent in bursts, no need to fill the frame again with the color it already has
+    if (m_presetColor == memoryPreset.color)
+        return false;
+    m_pixels.fill(memoryPreset.color);
+    m_presetColor = memoryPreset.color;
+    return markChanged(QRect(0, 0, WIDTH, HEIGHT));
 }
 
 
-void CdgImageFrame::cmdTileBlock(const cdg::CdgTileBlockData &tileBlockPacket, const cdg::TileBlockType &type)
+bool CdgImageFrame::cmdTileBlock(const cdg::CdgTileBlockData &tileBlockPacket, const cdg::TileBlockType &type)
 {
-    constexpr static std::array<char,6> MASKS{0x20,0x10,0x08,0x04,0x02,0x01};
-
     // reject corrupted CDG packets w/ invalid row/column
-    if (tileBlockPacket.row >= 18 || tileBlockPacket.column >= 50 || tileBlockPacket.color0 >= 16 || tileBlockPacket.color1 >= 16)
-        return;
+    if (tileBlockPacket.row >= 18)
+        m_packetErrors.row++;
+    if (tileBlockPacket.column >= 50)
+        m_packetErrors.column++;
+    if (tileBlockPacket.row >= 18 || tileBlockPacket.column >= 50)
+        return false;
 
-    // There's probably a better way to do this, needs research
-    for (auto y = 0; y < 12; y++)
+    const uchar color0 = tileBlockPacket.color0;
+    const uchar colorDiff = tileBlockPacket.color0 ^ tileBlockPacket.color1;
+    uchar *ptr = m_pixels.data() + WIDTH * tileBlockPacket.top + tileBlockPacket.left;
+    for (auto y = 0; y < 12; y++, ptr += WIDTH)
     {
-        auto ptr = m_image.scanLine(y + tileBlockPacket.top);
-        auto rowData = tileBlockPacket.tilePixels[y];
-        switch (type) {
-        case cdg::TileBlockXOR:
-            *(ptr + (tileBlockPacket.left * m_bytesPerPixel))       ^= (rowData & MASKS[0]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 1) * m_bytesPerPixel)) ^= (rowData & MASKS[1]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 2) * m_bytesPerPixel)) ^= (rowData & MASKS[2]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 3) * m_bytesPerPixel)) ^= (rowData & MASKS[3]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 4) * m_bytesPerPixel)) ^= (rowData & MASKS[4]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 5) * m_bytesPerPixel)) ^= (rowData & MASKS[5]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            break;
-        case cdg::TileBlockNormal:
-            *(ptr + (tileBlockPacket.left * m_bytesPerPixel))       = (rowData & MASKS[0]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 1) * m_bytesPerPixel)) = (rowData & MASKS[1]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 2) * m_bytesPerPixel)) = (rowData & MASKS[2]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 3) * m_bytesPerPixel)) = (rowData & MASKS[3]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 4) * m_bytesPerPixel)) = (rowData & MASKS[4]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            *(ptr + ((tileBlockPacket.left + 5) * m_bytesPerPixel)) = (rowData & MASKS[5]) ? tileBlockPacket.color1 : tileBlockPacket.color0;
-            break;
+        const auto &mask = TILE_ROW_MASKS[tileBlockPacket.tilePixels[y] & 0x3F];
+        if (type == cdg::TileBlockXOR)
+        {
+            for (auto x = 0; x < 6; x++)
+                ptr[x] ^= color0 ^ (colorDiff & mask[x]);
+        }
+        else
+        {
+            for (auto x = 0; x < 6; x++)
+                ptr[x] = color0 ^ (colorDiff & mask[x]);
         }
     }
+    m_presetColor = -1;
+    return markChanged(QRect(tileBlockPacket.left, tileBlockPacket.top, 6, 12));
 }
 
-void CdgImageFrame::cmdScroll(const cdg::CdgScrollCmdData &scrollCmdData, const cdg::ScrollType type)
+bool CdgImageFrame::cmdScroll(const cdg::CdgScrollCmdData &scrollCmdData, const cdg::ScrollType type)
 {
-    // Todo: add range checks for corrupted CDG packets to prevent crashes
+    // reject corrupted CDG packets, the offsets are used unchecked when cropping
+    if (scrollCmdData.hSCmd == 3 || scrollCmdData.vSCmd == 3 || scrollCmdData.hSOffset >= 6 || scrollCmdData.vSOffset >= 12)
+    {
+        m_packetErrors.scroll++;
+        return false;
+    }
 
+    bool moved{false};
     if (scrollCmdData.hSCmd == 2)
     {
         // scroll left 6px
-        for (auto i=0; i < 216; i++)
+        uchar *line = m_pixels.data();
+        for (auto y=0; y < HEIGHT; y++, line += WIDTH)
         {
-            auto bits = m_image.scanLine(i);
-            unsigned char* tmpPixels[6];
-            memcpy(tmpPixels, bits, 6);
-            memcpy(bits, bits + (6 * m_bytesPerPixel), 294 * m_bytesPerPixel);
+            uchar tmpPixels[6];
+            memcpy(tmpPixels, line, 6);
+            memmove(line, line + 6, WIDTH - 6);
             if (type == cdg::ScrollCopy)
-                memcpy(bits + m_borderRBytesOffset, tmpPixels, 6);
+                memcpy(line + WIDTH - 6, tmpPixels, 6);
             else
-                memset(bits + m_borderLRBytes, scrollCmdData.color, 6);
+                memset(line + WIDTH - 6, scrollCmdData.color, 6);
         }
+        moved = true;
     }
     if (scrollCmdData.hSCmd == 1)
     {
         // scroll right 6px
-        for (auto i=0; i < 216; i++)
+        uchar *line = m_pixels.data();
+        for (auto y=0; y < HEIGHT; y++, line += WIDTH)
         {
-            auto bits = m_image.scanLine(i);
-            unsigned char* tmpPixels[6];
-            memcpy(tmpPixels, bits + (m_bytesPerPixel * 294), 6);
-            memcpy(bits + (6 * m_bytesPerPixel), bits , 294 * m_bytesPerPixel);
+            uchar tmpPixels[6];
+            memcpy(tmpPixels, line + WIDTH - 6, 6);
+            memmove(line + 6, line, WIDTH - 6);
             if (type == cdg::ScrollCopy)
-                memcpy(bits, tmpPixels, 6);
+                memcpy(line, tmpPixels, 6);
             else
-                memset(bits, scrollCmdData.color, 6);
+                memset(line, scrollCmdData.color, 6);
         }
+        moved = true;
     }
+    constexpr int SCROLL_V_BYTES = WIDTH * 12;
     if (scrollCmdData.vSCmd == 2)
     {
         // scroll up 12px
-        auto bits = m_image.bits();
-        unsigned char* tmpLines[3600]; // m_image.bytesPerLine() * 12
-        memcpy(tmpLines, bits, m_image.bytesPerLine() * 12);
-        memcpy(bits, bits + m_image.bytesPerLine() * 12, 204 * m_image.bytesPerLine());
+        auto bits = m_pixels.data();
+        uchar tmpLines[SCROLL_V_BYTES];
+        memcpy(tmpLines, bits, SCROLL_V_BYTES);
+        memmove(bits, bits + SCROLL_V_BYTES, m_pixels.size() - SCROLL_V_BYTES);
         if (type == cdg::ScrollCopy)
-            memcpy(bits + (204 * m_image.bytesPerLine()), tmpLines, m_image.bytesPerLine() * 12);
+            memcpy(bits + m_pixels.size() - SCROLL_V_BYTES, tmpLines, SCROLL_V_BYTES);
         else
-            memset(bits + (204 * m_image.bytesPerLine()), scrollCmdData.color, m_image.bytesPerLine() * 12);
+            memset(bits + m_pixels.size() - SCROLL_V_BYTES, scrollCmdData.color, SCROLL_V_BYTES);
+        moved = true;
     }
     if (scrollCmdData.vSCmd == 1)
     {
         // scroll down 12px
-        auto bits = m_image.bits();
-        unsigned char* tmpLines[3600];
-        memcpy(tmpLines, bits + (m_image.bytesPerLine() * 204), m_image.bytesPerLine() * 12);
-        memcpy(bits + (m_image.bytesPerLine() * 12), bits, 204 * m_image.bytesPerLine());
+        auto bits = m_pixels.data();
+        uchar tmpLines[SCROLL_V_BYTES];
+        memcpy(tmpLines, bits + m_pixels.size() - SCROLL_V_BYTES, SCROLL_V_BYTES);
+        memmove(bits + SCROLL_V_BYTES, bits, m_pixels.size() - SCROLL_V_BYTES);
         if (type == cdg::ScrollCopy)
-            memcpy(bits, tmpLines, m_image.bytesPerLine() * 12);
+            memcpy(bits, tmpLines, SCROLL_V_BYTES);
         else
-            memset(bits, scrollCmdData.color, m_image.bytesPerLine() * 12);
+            memset(bits, scrollCmdData.color, SCROLL_V_BYTES);
+        moved = true;
     }
-    if (m_curVOffset != scrollCmdData.vSOffset)
-        m_curVOffset = scrollCmdData.vSOffset;
-    if (m_curHOffset != scrollCmdData.hSOffset)
-        m_curHOffset = scrollCmdData.hSOffset;
+    if (moved && type == cdg::ScrollPreset && m_presetColor != scrollCmdData.color)
+        m_presetColor = -1;
+
+    bool offsetChanged = (m_curVOffset != scrollCmdData.vSOffset || m_curHOffset != scrollCmdData.hSOffset);
+    m_curVOffset = scrollCmdData.vSOffset;
+    m_curHOffset = scrollCmdData.hSOffset;
+
+    if (!moved && !offsetChanged)
+        return false;
+    markAllChanged();
+    return true;
 }
 
 
@@ -239,4 +297,3 @@ void CdgImageFrame::cmdDefineTransparent([[maybe_unused]] const std::array<char,
     // This is rarely if ever used
     // No idea what the data structure is, it's missing from CDG Revealed
 }
-
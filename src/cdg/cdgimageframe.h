@@ -2,6 +2,7 @@
 #define CDGIMAGEFRAME_H
 
 #include <QImage>
+#include <QRect>
 #include "libCDG.h"
 
 class CdgImageFrame
@@ -14,24 +15,41 @@ public:
 
     void copyCroppedImagedata(uchar *destbuffer);
 
-    QImage getImage() { return m_image; }
+    // Region of the cropped image that changed since the last clearChangedRect(), in cropped image coordinates
+    [[nodiscard]] QRect changedRect() const { return m_changedRect; }
+    void clearChangedRect() { m_changedRect = QRect(); }
+    void markAllChanged() { m_changedRect = QRect(QPoint(0, 0), cdg::FRAME_DIM_CROPPED); }
+
+    QImage getImage();
+
+    // Counts of the corrupted packets seen so far
+    [[nodiscard]] const cdg::PacketErrors &packetErrors() const { return m_packetErrors; }
 
 private:
+    static constexpr int WIDTH = 300;
+    static constexpr int HEIGHT = 216;
 
-    QImage m_image;
+    // Indexed pixels of the full 300x216 frame, one byte per pixel, no line padding
+    std::array<uchar, WIDTH * HEIGHT> m_pixels;
+    std::array<QRgb, 16> m_palette;
 
-    int m_bytesPerPixel;
-    int m_borderLRBytes;
-    int m_borderRBytesOffset;
-    int m_curVOffset;
-    int m_curHOffset;
+    int m_curVOffset{0};
+    int m_curHOffset{0};
+
+    QRect m_changedRect;
+    // Color the whole frame is known to be filled with, -1 once anything else is drawn
+    int m_presetColor{0};
 
     bool m_lastCmdWasMempreset {false};
+    cdg::PacketErrors m_packetErrors;
+
+    bool markChanged(const QRect &fullFrameRect);
+    void checkColorByte(char colorByte);
 
-    void cmdScroll(const cdg::CdgScrollCmdData &scrollCmdData, const cdg::ScrollType type);
-    void cmdTileBlock(const cdg::CdgTileBlockData &tileBlockPacket, const cdg::TileBlockType &type);
+    bool cmdScroll(const cdg::CdgScrollCmdData &scrollCmdData, const cdg::ScrollType type);
+    bool cmdTileBlock(const cdg::CdgTileBlockData &tileBlockPacket, const cdg::TileBlockType &type);
     bool cmdMemoryPreset(const cdg::CdgMemoryPresetData &memoryPreset);
-    void cmdBorderPreset(const cdg::CdgBorderPresetData &borderPreset);
+    bool cmdBorderPreset(const cdg::CdgBorderPresetData &borderPreset);
     bool cmdColors(const cdg::CdgColorsData &data,const cdg::CdgColorTables &table);
     void cmdDefineTransparent(const std::array<char,16> &data);
 
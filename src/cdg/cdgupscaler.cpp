@@ -0,0 +1,144 @@
+#include "cdgupscaler.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// Neighbours of a source pixel, past the frame edges the pixel itself is used
+struct Neighbourhood
+{
+    uchar a, b, c;
+    uchar d, e, f;
+    uchar g, h, i;
+};
+
+inline Neighbourhood neighbourhood(const uchar *src, int width, int height, int x, int y)
+{
+    const uchar *line = src + y * width;
+    const uchar *up = y > 0 ? line - width : line;
+    const uchar *down = y < height - 1 ? line + width : line;
+    const int left = x > 0 ? x - 1 : x;
+    const int right = x < width - 1 ? x + 1 : x;
+    return {
+        up[left],   up[x],   up[right],
+        line[left], line[x], line[right],
+        down[left], down[x], down[right]
+    };
+}
+
+// The 3x3 neighbourhood decides the output of a source pixel, so a changed pixel affects its neighbours too
+QRect affectedRect(const QRect &changed, int width, int height)
+{
+    return changed.adjusted(-1, -1, 1, 1) & QRect(0, 0, width, height);
+}
+
+void scale2x(const uchar *src, int width, int height, const QRect &rect, uchar *dst)
+{
+    const int dstWidth = width * 2;
+    for (int y = rect.top(); y <= rect.bottom(); y++)
+    {
+        uchar *out0 = dst + (y * 2) * dstWidth;
+        uchar *out1 = out0 + dstWidth;
+        for (int x = rect.left(); x <= rect.right(); x++)
+        {
+            const auto n = neighbourhood(src, width, height, x, y);
+            uchar e0 = n.e, e1 = n.e, e2 = n.e, e3 = n.e;
+            if (n.b != n.h && n.d != n.f)
+            {
+                e0 = n.d == n.b ? n.d : n.e;
+                e1 = n.b == n.f ? n.f : n.e;
+                e2 = n.d == n.h ? n.d : n.e;
+                e3 = n.h == n.f ? n.f : n.e;
+            }
+            out0[x * 2] = e0;
+            out0[x * 2 + 1] = e1;
+            out1[x * 2] = e2;
+            out1[x * 2 + 1] = e3;
+        }
+    }
+}
+
+void scale3x(const uchar *src, int width, int height, const QRect &rect, uchar *dst)
+{
+    const int dstWidth = width * 3;
+    for (int y = rect.top(); y <= rect.bottom(); y++)
+    {
+        uchar *out0 = dst + (y * 3) * dstWidth;
+        uchar *out1 = out0 + dstWidth;
+        uchar *out2 = out1 + dstWidth;
+        for (int x = rect.left(); x <= rect.right(); x++)
+        {
+            const auto n = neighbourhood(src, width, height, x, y);
+            uchar *o0 = out0 + x * 3;
+            uchar *o1 = out1 + x * 3;
+            uchar *o2 = out2 + x * 3;
+            if (n.b != n.h && n.d != n.f)
+            {
+                o0[0] = n.d == n.b ? n.d : n.e;
+                o0[1] = (n.d == n.b && n.e != n.c) || (n.b == n.f && n.e != n.a) ? n.b : n.e;
+                o0[2] = n.b == n.f ? n.f : n.e;
+                o1[0] = (n.d == n.b && n.e != n.g) || (n.d == n.h && n.e != n.a) ? n.d : n.e;
+                o1[1] = n.e;
+                o1[2] = (n.b == n.f && n.e != n.i) || (n.h == n.f && n.e != n.c) ? n.f : n.e;
+                o2[0] = n.d == n.h ? n.d : n.e;
+                o2[1] = (n.d == n.h && n.e != n.i) || (n.h == n.f && n.e != n.g) ? n.h : n.e;
+                o2[2] = n.h == n.f ? n.f : n.e;
+            }
+            else
+            {
+                memset(o0, n.e, 3);
+                memset(o1, n.e, 3);
+                memset(o2, n.e, 3);
+            }
+        }
+    }
+}
+
+}
+
+CdgUpscaler::CdgUpscaler(int factor) :
+    m_factor(std::clamp(factor, 2, 4))
+{
+    const auto size = outputSize();
+    m_scaled.resize(size.width() * size.height());
+    if (m_factor == 4)
+        m_intermediate.resize(m_scaled.size() / 4);
+}
+
+int CdgUpscaler::outputBufferSize() const
+{
+    return static_cast<int>(m_scaled.size()) + cdg::CDG_IMAGE_SIZE - cdg::FRAME_DIM_CROPPED.width() * cdg::FRAME_DIM_CROPPED.height();
+}
+
+void CdgUpscaler::render(const uchar *frame, const QRect &changedRect, uchar *destBuffer)
+{
+    const int width = cdg::FRAME_DIM_CROPPED.width();
+    const int height = cdg::FRAME_DIM_CROPPED.height();
+    const QRect rect = m_valid ? affectedRect(changedRect, width, height) : QRect(0, 0, width, height);
+    m_valid = true;
+
+    if (!rect.isEmpty())
+    {
+        switch (m_factor)
+        {
+        case 2:
+            scale2x(frame, width, height, rect, m_scaled.data());
+            break;
+        case 3:
+            scale3x(frame, width, height, rect, m_scaled.data());
+            break;
+        case 4:
+        {
+            scale2x(frame, width, height, rect, m_intermediate.data());
+            const QRect rect2x(rect.topLeft() * 2, rect.size() * 2);
+            scale2x(m_intermediate.data(), width * 2, height * 2, affectedRect(rect2x, width * 2, height * 2), m_scaled.data());
+            break;
+        }
+        }
+    }
+
+    memcpy(destBuffer, m_scaled.data(), m_scaled.size());
+    // palette
+    memcpy(destBuffer + m_scaled.size(), frame + width * height, cdg::CDG_IMAGE_SIZE - width * height);
+}
@@ -0,0 +1,54 @@
+#ifndef CDGUPSCALER_H
+#define CDGUPSCALER_H
+
+#include <QRect>
+#include <QSize>
+#include <vector>
+#include "libCDG.h"
+
+/**
+ * @brief Pixel-art upscaler for cropped CDG frames.
+ *
+ * Scales the indexed frame with Scale2x (2x), Scale3x (3x) or Scale2x applied twice (4x). CDG art is flat colored
+ * and aliased, which is what these scalers are made for: edges and diagonals stay sharp instead of turning blocky
+ * (nearest neighbour) or blurry (bilinear). Working on palette indices rather than colors keeps the pixel compares
+ * exact and the output small, the palette is passed along unchanged.
+ *
+ * The scaled frame is kept between calls so only the part of the frame that changed is scaled again.
+ */
+class CdgUpscaler
+{
+public:
+    /**
+     * @param factor 2, 3 or 4
+     */
+    explicit CdgUpscaler(int factor);
+
+    [[nodiscard]] int factor() const { return m_factor; }
+    [[nodiscard]] QSize outputSize() const { return cdg::FRAME_DIM_CROPPED * m_factor; }
+
+    /**
+     * @brief Size of a rendered frame: the scaled indexed image followed by the 1024 byte palette.
+     */
+    [[nodiscard]] int outputBufferSize() const;
+
+    /**
+     * @brief Scale a frame as produced by CdgFileReader.
+     * @param frame Cropped indexed image followed by the palette, cdg::CDG_IMAGE_SIZE bytes.
+     * @param changedRect Part of frame that differs from the one passed in the previous call.
+     * @param destBuffer outputBufferSize() bytes.
+     */
+    void render(const uchar *frame, const QRect &changedRect, uchar *destBuffer);
+
+    // Have the next render() scale the whole frame, no matter what changed
+    void invalidate() { m_valid = false; }
+
+private:
+    int m_factor;
+    bool m_valid{false};
+    // Scale2x output that is scaled once more for 4x
+    std::vector<uchar> m_intermediate;
+    std::vector<uchar> m_scaled;
+};
+
+#endif // CDGUPSCALER_H
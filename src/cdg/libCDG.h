@@ -78,6 +78,16 @@ enum CdgColorTables : char {
     HighColors = 1
 };
 
+// Packets the decoder had to reject or mask because of out of range values, a sign of a damaged rip
+struct PacketErrors
+{
+    int row{0};
+    int column{0};
+    int color{0};
+    int scroll{0};
+    [[nodiscard]] int total() const { return row + column + color + scroll; }
+};
+
 struct CDG_SubCode
 {
     CdgCommand command;
@@ -0,0 +1,126 @@
+#include "dbsongsfts.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <spdlog/spdlog.h>
+
+#define SQL(...) #__VA_ARGS__
+
+namespace {
+    const std::string loggingPrefix{"[DbSongsFts]"};
+
+    // '&' is searched as "and" everywhere else, index it the same way. Apostrophes are dropped like the song list's
+    // search does with "ignore apostrophes" on, unicode61 would split "don't" into "don" and "t" otherwise.
+    // char(39) is the apostrophe.
+    QString indexedText(const QString &column)
+    {
+        return QString("replace(replace(%1, '&', ' and '), char(39), '')").arg(column);
+    }
+}
+
+bool DbSongsFts::create(QSqlDatabase db)
+{
+    auto logger = spdlog::get("logger");
+    if (exists(db))
+        return true;
+    logger->info("{} Creating full text search index", loggingPrefix);
+    QSqlQuery query(db);
+    if (!query.exec(SQL(
+        CREATE VIRTUAL TABLE dbsongs_fts USING fts5(searchstring, artist, title, tokenize = 'unicode61')
+        )))
+    {
+        logger->warn("{} Unable to create FTS5 table, full text search unavailable: {}", loggingPrefix,
+                     query.lastError().text().toStdString());
+        return false;
+    }
+    db.transaction();
+    bool ok{true};
+    ok = ok && query.exec(QString(SQL(
+        CREATE TRIGGER dbsongs_fts_insert AFTER INSERT ON dbsongs BEGIN
+            INSERT INTO dbsongs_fts (rowid, searchstring, artist, title)
+                VALUES (new.songid, %1, %2, %3);
+        END
+        )).arg(indexedText("new.searchstring"), indexedText("new.artist"), indexedText("new.title")));
+    ok = ok && query.exec(SQL(
+        CREATE TRIGGER dbsongs_fts_delete AFTER DELETE ON dbsongs BEGIN
+            DELETE FROM dbsongs_fts WHERE rowid = old.songid;
+        END
+        ));
+    ok = ok && query.exec(QString(SQL(
+        CREATE TRIGGER dbsongs_fts_update AFTER UPDATE OF searchstring, artist, title ON dbsongs BEGIN
+            UPDATE dbsongs_fts SET
+                searchstring = %1,
+                artist = %2,
+                title = %3
+                WHERE rowid = old.songid;
+        END
+        )).arg(indexedText("new.searchstring"), indexedText("new.artist"), indexedText("new.title")));
+    ok = ok && query.exec(QString(SQL(
+        INSERT INTO dbsongs_fts (rowid, searchstring, artist, title)
+            SELECT songid, %1, %2, %3
+            FROM dbsongs
+        )).arg(indexedText("searchstring"), indexedText("artist"), indexedText("title")));
+    if (!ok)
+    {
+        logger->error("{} Error while building the full text search index: {}", loggingPrefix,
+                      query.lastError().text().toStdString());
+        db.rollback();
+        drop(db);
+        return false;
+    }
+    db.commit();
+    optimize(db);
+    logger->info("{} Full text search index created", loggingPrefix);
+    return true;
+}
+
+void DbSongsFts::drop(QSqlDatabase db)
+{
+    QSqlQuery query(db);
+    query.exec("DROP TRIGGER IF EXISTS dbsongs_fts_insert");
+    query.exec("DROP TRIGGER IF EXISTS dbsongs_fts_delete");
+    query.exec("DROP TRIGGER IF EXISTS dbsongs_fts_update");
+    query.exec("DROP TABLE IF EXISTS dbsongs_fts");
+}
+
+bool DbSongsFts::exists(QSqlDatabase db)
+{
+    QSqlQuery query(db);
+    query.exec("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'dbsongs_fts'");
+    return query.first() && query.value(0).toInt() > 0;
+}
+
+void DbSongsFts::optimize(QSqlDatabase db)
+{
+    QSqlQuery query(db);
+    query.exec("INSERT INTO dbsongs_fts (dbsongs_fts) VALUES('optimize')");
+}
+
+QString DbSongsFts::matchExpression(const QStringList &needles, Column column)
+{
+    QString columnName;
+    switch (column)
+    {
+    case SearchString:
+        columnName = "searchstring";
+        break;
+    case Artist:
+        columnName = "artist";
+        break;
+    case Title:
+        columnName = "title";
+        break;
+    }
+    QStringList terms;
+    for (auto needle : needles)
+    {
+        // The indexed text has no apostrophes, see indexedText()
+        needle.remove('\'');
+        if (needle.isEmpty())
+            continue;
+        // Quoted as a string so punctuation in the needle can't be parsed as query syntax
+        needle.replace('"', "\"\"");
+        terms.push_back(columnName + " : \"" + needle + "\"*");
+    }
+    return terms.join(' ');
+}
@@ -0,0 +1,46 @@
+#ifndef DBSONGSFTS_H
+#define DBSONGSFTS_H
+
+#include <QString>
+#include <QStringList>
+#include <QSqlDatabase>
+
+/**
+ * @brief Optional SQLite FTS5 index over the dbSongs table.
+ *
+ * The dbsongs_fts table keeps its own copy of the searchable columns and is kept in sync with dbSongs
+ * by triggers, so every writer (DbUpdater, song edits, downloads) populates it without knowing it's
+ * there.  When the option is turned off the table and triggers are dropped again so imports don't pay
+ * for it.
+ */
+class DbSongsFts
+{
+public:
+    enum Column {
+        SearchString,
+        Artist,
+        Title
+    };
+
+    /**
+     * @brief Create the table and triggers if they don't exist yet and fill the table from dbSongs.
+     * @return false if the SQLite library has no FTS5 support.
+     */
+    static bool create(QSqlDatabase db = QSqlDatabase::database());
+    static void drop(QSqlDatabase db = QSqlDatabase::database());
+    static bool exists(QSqlDatabase db = QSqlDatabase::database());
+
+    /**
+     * @brief Merge the index segments, worth doing after large imports.
+     */
+    static void optimize(QSqlDatabase db = QSqlDatabase::database());
+
+    /**
+     * @brief Build an FTS5 MATCH expression requiring every needle as a word prefix in the given column.
+     * Apostrophes are ignored in the needles as they are in the indexed text, so "dont" and "don't" find the same
+     * songs whatever the "ignore apostrophes" setting is.
+     */
+    static QString matchExpression(const QStringList &needles, Column column);
+};
+
+#endif // DBSONGSFTS_H
@@ -23,12 +23,137 @@
 #include <array>
 #include <QSqlQuery>
 #include <QFileInfo>
+#include <QDateTime>
 #include <QDir>
-#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QStandardPaths>
 #include <QApplication>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
 #include "mzarchive.h"
 #include "karaokefileinfo.h"
+#include "dbsongsfts.h"
+#include "directorylistingcache.h"
+#include "directorywalker.h"
+
+namespace {
+
+// Held by whatever is updating dbSongs from the disk, so only one of them runs at a time
+std::mutex scannerMutex;
+
+// Paths below a directory, as a range that can use the index on path: prefix ends in '/' and '0' comes right after it
+QString pathRangeEnd(const QString &dirPrefix)
+{
+    return dirPrefix.left(dirPrefix.length() - 1) + '0';
+}
+
+struct ParsedFile
+{
+    QString path;
+    QString artist;
+    QString title;
+    QString songId;
+    QString filename;
+    QString searchString;
+    int duration{-2};
+    // What the file looked like when it was parsed, a song replaced at the same path loses its analysis results
+    qint64 fileSize{-1};
+    qint64 fileMtime{-1};
+    QString error;
+};
+
+// Bounded hand-off between the file parsing workers and the database writer.
+class ParsedFileQueue
+{
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::deque<ParsedFile> m_items;
+    size_t m_capacity;
+    int m_producers;
+
+public:
+    ParsedFileQueue(size_t capacity, int producers) : m_capacity(capacity), m_producers(producers) {}
+
+    void push(ParsedFile &&file)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_items.size() < m_capacity; });
+        m_items.push_back(std::move(file));
+        m_notEmpty.notify_one();
+    }
+
+    void producerDone()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_producers--;
+        m_notEmpty.notify_all();
+    }
+
+    // Waits for at least one item and moves up to maxItems into batch.
+    // Returns false once all producers are done and the queue is drained.
+    bool popBatch(std::vector<ParsedFile> &batch, size_t maxItems)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return !m_items.empty() || m_producers == 0; });
+        while (!m_items.empty() && batch.size() < maxItems) {
+            batch.push_back(std::move(m_items.front()));
+            m_items.pop_front();
+        }
+        m_notFull.notify_all();
+        return !batch.empty();
+    }
+};
+
+// Runs on the worker threads, must not touch the database.
+ParsedFile parseFile(const QString &filePath, KaraokeFileInfo &parser, MzArchive &archive, bool probeDuration, bool validateZip)
+{
+    ParsedFile result;
+    result.path = filePath;
+#ifdef Q_OS_WIN
+    if (filePath.contains("*") || filePath.contains("?") || filePath.contains("<") || filePath.contains(">") || filePath.contains("|"))
+    {
+        // illegal character
+        result.error = "Illegal character in filename: " + filePath;
+        return result;
+    }
+#endif
+    parser.setFile(filePath);
+
+    if (probeDuration)
+        result.duration = parser.getDuration();
+    if (validateZip && filePath.endsWith(".zip", Qt::CaseInsensitive)) {
+        archive.setArchiveFile(filePath);
+        if (!archive.isValidKaraokeFile()) {
+            result.error = archive.getLastError() + ": " + filePath;
+            return result;
+        }
+    }
+    const QFileInfo fileInfo(filePath);
+    result.filename = fileInfo.completeBaseName();
+    result.fileSize = fileInfo.size();
+    result.fileMtime = fileInfo.lastModified().toMSecsSinceEpoch();
+    result.songId = parser.getSongId();
+    result.artist = parser.getArtist();
+    // If metadata parse wasn't successful, just put the filename in the title field
+    result.title = (parser.parsedSuccessfully()) ? parser.getTitle() : result.filename;
+    // searchString contains the metadata plus the basename to work around people's libraries that are
+    // misnamed and don't import properly or who use media tags and have bad tags.
+    result.searchString = result.filename + " " + parser.getArtist() + " " + parser.getTitle() + " " + parser.getSongId();
+    return result;
+}
+
+}
 
 DbUpdater::DbUpdater(QObject *parent) :
         QObject(parent) {
@@ -43,12 +168,11 @@ bool DbUpdater::process(const QList<QString> &paths, ProcessingOptions options)
     // Even though the program is primarily single threaded, excessive use of
     // QApplication::processEvents can cause reentrant calls.
 
-    static std::mutex mutex;
-    if (!mutex.try_lock()) {
+    if (!scannerMutex.try_lock()) {
         m_errors.append("Scanner already running");
         return false;
     }
-    const std::lock_guard<std::mutex> locker(mutex, std::adopt_lock);
+    const std::lock_guard<std::mutex> locker(scannerMutex, std::adopt_lock);
 
     m_missingFilesSongIds.clear();
     setPaths(paths);
@@ -140,71 +264,129 @@ void DbUpdater::addFilesToDatabase(const QList<QString> &files)
 
     emit stateChanged("Adding new files to database...")    ;
 
-    QSqlQuery query;
-    query.exec("PRAGMA synchronous=OFF");
-    query.exec("PRAGMA cache_size=500000");
-    query.exec("PRAGMA temp_store=2");
-    query.exec("BEGIN TRANSACTION");
-    query.prepare(SQL(
-            INSERT INTO dbSongs (discid, artist, title, path, filename, duration, searchstring)
-            VALUES(:discid, :artist, :title, :path, :filename, :duration, :searchstring)
-            ON CONFLICT(path) DO UPDATE SET
-                discid = :discid,
-                artist = :artist,
-                title = :title,
-                filename = :filename,
-                duration = :duration,
-                searchstring = :searchstring
-           ));
-
-    MzArchive archive;
-    KaraokeFileInfo parser(this);
-    QFileInfo fileInfo;
-    int loops = 0;
-
-    for (const auto &filePath : files) {
-        loops++;
-        int duration{-2};
-        fileInfo.setFile(filePath);
-#ifdef Q_OS_WIN
-        if (filePath.contains("*") || filePath.contains("?") || filePath.contains("<") || filePath.contains(">") || filePath.contains("|"))
-        {
-            // illegal character
-            m_errors.append("Illegal character in filename: " + filePath);
-            emit progressMessage("Illegal character in filename: " + filePath);
-            emit progressChanged(loops, files.length());
-            continue;
+    // Pipeline: a pool of worker threads parses and validates files (the slow part, especially
+    // on network shares) while a single writer thread drains the results into the database in
+    // batched transactions. The calling thread only reports progress until the writer is done.
+
+    const bool probeDurations = !m_settings.dbLazyLoadDurations();
+    const bool validateZips = !m_settings.dbSkipValidation();
+    const int workerCount = qBound(1, m_settings.dbImportThreads(), files.size());
+    const QString dbFileName = QSqlDatabase::database().databaseName();
+
+    // The resolver queries the database, so load it here before the workers share it.
+    auto patternResolver = std::make_shared<KaraokeFilePatternResolver>();
+    patternResolver->initialize();
+
+    ParsedFileQueue queue(workerCount * 64, workerCount);
+    std::atomic<int> nextFile{0};
+    std::atomic<int> filesDone{0};
+
+    auto parseWorker = [&]() {
+        KaraokeFileInfo parser(nullptr, patternResolver);
+        MzArchive archive;
+        int i;
+        while ((i = nextFile.fetch_add(1)) < files.size()) {
+            queue.push(parseFile(files.at(i), parser, archive, probeDurations, validateZips));
         }
-#endif
-        parser.setFile(filePath);
-
-        if (!m_settings.dbLazyLoadDurations())
-            duration = parser.getDuration();
-        if (filePath.endsWith(".zip", Qt::CaseInsensitive) && !m_settings.dbSkipValidation()) {
-            archive.setArchiveFile(filePath);
-            if (!archive.isValidKaraokeFile()) {
-                m_errors.append(archive.getLastError() + ": " + filePath);
-                continue;
+        queue.producerDone();
+    };
+
+    auto dbWriter = [&]() -> QStringList {
+        QStringList errors;
+        const QString connectionName = "DbUpdaterImport";
+        {
+            auto db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            db.setDatabaseName(dbFileName);
+            db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=30000");
+            bool dbOpen = db.open();
+            if (!dbOpen)
+                errors.append("Unable to open database for import: " + db.lastError().text());
+
+            QSqlQuery query(db);
+            query.exec("PRAGMA synchronous=OFF");
+            query.exec("PRAGMA cache_size=500000");
+            query.exec("PRAGMA temp_store=2");
+            query.prepare(SQL(
+                    INSERT INTO dbSongs (discid, artist, title, path, filename, duration, searchstring, filesize, filemtime)
+                    VALUES(:discid, :artist, :title, :path, :filename, :duration, :searchstring, :filesize, :filemtime)
+                    ON CONFLICT(path) DO UPDATE SET
+                        discid = :discid,
+                        artist = :artist,
+                        title = :title,
+                        filename = :filename,
+                        duration = :duration,
+                        searchstring = :searchstring,
+                        audioend = CASE WHEN filesize IS :filesize AND filemtime IS :filemtime THEN audioend END,
+                        cdgend = CASE WHEN filesize IS :filesize AND filemtime IS :filemtime THEN cdgend END,
+                        rggain = CASE WHEN filesize IS :filesize AND filemtime IS :filemtime THEN rggain END,
+                        rgpeak = CASE WHEN filesize IS :filesize AND filemtime IS :filemtime THEN rgpeak END,
+                        filesize = :filesize,
+                        filemtime = :filemtime
+                   ));
+
+            // Keep draining even if the database could not be opened so the workers never block.
+            std::vector<ParsedFile> batch;
+            while (queue.popBatch(batch, 500)) {
+                // Transaction control goes through the connection, running it on query would replace the prepared statement
+                if (dbOpen)
+                    db.transaction();
+                for (const auto &file : batch) {
+                    if (!file.error.isEmpty()) {
+                        errors.append(file.error);
+                        continue;
+                    }
+                    if (!dbOpen)
+                        continue;
+                    query.bindValue(":discid", file.songId);
+                    query.bindValue(":artist", file.artist);
+                    query.bindValue(":title", file.title);
+                    query.bindValue(":path", file.path);
+                    query.bindValue(":filename", file.filename);
+                    query.bindValue(":duration", file.duration);
+                    query.bindValue(":searchstring", file.searchString);
+                    query.bindValue(":filesize", file.fileSize);
+                    query.bindValue(":filemtime", file.fileMtime);
+                    query.exec();
+                }
+                if (dbOpen)
+                    db.commit();
+                filesDone += static_cast<int>(batch.size());
+                batch.clear();
             }
+            // The full text index is filled by triggers row by row, merge its segments once at the end
+            if (dbOpen && DbSongsFts::exists(db))
+                DbSongsFts::optimize(db);
         }
-        query.bindValue(":discid", parser.getSongId());
-        query.bindValue(":artist", parser.getArtist());
-        // If metadata parse wasn't successful, just put the filename in the title field
-        query.bindValue(":title", (parser.parsedSuccessfully()) ? parser.getTitle() : fileInfo.completeBaseName());
-        query.bindValue(":path", filePath);
-        query.bindValue(":filename", fileInfo.completeBaseName());
-        query.bindValue(":duration", duration);
-        // searchString contains the metadata plus the basename to work around people's libraries that are
-        // misnamed and don't import properly or who use media tags and have bad tags.
-        query.bindValue(":searchstring", fileInfo.completeBaseName() + " " + parser.getArtist() + " " + parser.getTitle() + " " + parser.getSongId());
-        query.exec();
-        if (shouldUpdateGui()) {
-            emit progressChanged(loops, files.length());
-            //emit stateChanged(QString("Importing new files into the karaoke database... %1 of %2").arg(loops).arg(files.length()));
-            QApplication::processEvents();
-        }
+        QSqlDatabase::removeDatabase(connectionName);
+        return errors;
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(workerCount + 1);
+    QFuture<QStringList> writerFuture = QtConcurrent::run(&pool, dbWriter);
+    for (int i = 0; i < workerCount; i++)
+        QtConcurrent::run(&pool, parseWorker);
+
+    QEventLoop loop;
+    QTimer progressTimer;
+    QFutureWatcher<QStringList> writerWatcher;
+    connect(&writerWatcher, &QFutureWatcher<QStringList>::finished, &loop, &QEventLoop::quit);
+    connect(&progressTimer, &QTimer::timeout, this, [&] () {
+        emit progressChanged(filesDone, files.length());
+    });
+    progressTimer.start(200);
+    writerWatcher.setFuture(writerFuture);
+    if (!writerFuture.isFinished())
+        loop.exec();
+    progressTimer.stop();
+    pool.waitForDone();
+
+    emit progressChanged(files.length(), files.length());
+
+    for (const auto &error : writerFuture.result()) {
+        m_errors.append(error);
+        emit progressMessage(error);
     }
-    query.exec("COMMIT");
 
     emit progressMessage("Done processing new files.");
 
@@ -213,6 +395,157 @@ void DbUpdater::addFilesToDatabase(const QList<QString> &files)
     }
 }
 
+// Applies changes reported by a file system watcher straight to dbSongs, without listing any directories.
+// Moves only change the path, so the play history and regular singers keep pointing at the song.
+bool DbUpdater::applyFileChanges(const QVector<FileChange> &changes)
+{
+    if (!scannerMutex.try_lock()) {
+        m_errors.append("Scanner already running");
+        return false;
+    }
+    const std::lock_guard<std::mutex> locker(scannerMutex, std::adopt_lock);
+
+    auto db = QSqlDatabase::database();
+    if (!db.transaction()) {
+        m_errors.append("Unable to start a transaction: " + db.lastError().text());
+        return false;
+    }
+    QStringList filesToAdd;
+    QSqlQuery query;
+    for (const auto &change : changes) {
+        const QString dirPrefix = change.path + '/';
+        switch (change.type) {
+        case FileChange::Added:
+            // The watcher reports the files of a directory that appears one by one
+            if (change.isDir)
+                break;
+            if (isAudioFile(change.path))
+                updatePairedCdg(change.path, filesToAdd);
+            else if (isKaraokeFile(change.path) && (!change.path.endsWith(".cdg", Qt::CaseInsensitive) || hasAudioFile(change.path)))
+                filesToAdd.append(change.path);
+            break;
+        case FileChange::Removed:
+            if (change.isDir) {
+                query.prepare("DELETE FROM dbSongs WHERE path >= :prefix AND path < :end");
+                query.bindValue(":prefix", dirPrefix);
+                query.bindValue(":end", pathRangeEnd(dirPrefix));
+                query.exec();
+                filesToAdd.erase(std::remove_if(filesToAdd.begin(), filesToAdd.end(), [&dirPrefix] (const QString &path) {
+                    return path.startsWith(dirPrefix);
+                }), filesToAdd.end());
+                break;
+            }
+            query.prepare("DELETE FROM dbSongs WHERE path = :path");
+            query.bindValue(":path", change.path);
+            query.exec();
+            filesToAdd.removeAll(change.path);
+            if (isAudioFile(change.path))
+                updatePairedCdg(change.path, filesToAdd);
+            break;
+        case FileChange::Moved:
+            if (change.isDir) {
+                const QString newDirPrefix = change.newPath + '/';
+                query.prepare("UPDATE dbSongs SET path = :newprefix || substr(path, length(:prefix) + 1) WHERE path >= :prefix AND path < :end");
+                query.bindValue(":newprefix", newDirPrefix);
+                query.bindValue(":prefix", dirPrefix);
+                query.bindValue(":end", pathRangeEnd(dirPrefix));
+                query.exec();
+                for (auto &path : filesToAdd) {
+                    if (path.startsWith(dirPrefix))
+                        path.replace(0, dirPrefix.length(), newDirPrefix);
+                }
+                break;
+            }
+            if (isAudioFile(change.path) || isAudioFile(change.newPath)) {
+                updatePairedCdg(change.path, filesToAdd);
+                updatePairedCdg(change.newPath, filesToAdd);
+            }
+            if (!isKaraokeFile(change.newPath) || (change.newPath.endsWith(".cdg", Qt::CaseInsensitive) && !hasAudioFile(change.newPath))) {
+                query.prepare("DELETE FROM dbSongs WHERE path = :path");
+                query.bindValue(":path", change.path);
+                query.exec();
+                filesToAdd.removeAll(change.path);
+                break;
+            }
+            query.prepare("UPDATE dbSongs SET path = :newpath WHERE path = :path");
+            query.bindValue(":newpath", change.newPath);
+            query.bindValue(":path", change.path);
+            query.exec();
+            // A renamed file may be named after a different song now, parse it again
+            if (filesToAdd.removeAll(change.path) > 0 || query.numRowsAffected() <= 0
+                    || QFileInfo(change.path).fileName() != QFileInfo(change.newPath).fileName())
+                filesToAdd.append(change.newPath);
+            break;
+        }
+    }
+    query.exec("DELETE FROM queueSongs WHERE [song] NOT IN (SELECT [songid] FROM dbSongs)");
+    query.exec("DELETE FROM regularSongs WHERE [songid] NOT IN (SELECT [songid] FROM dbSongs)");
+    // Nothing of a batch that can't be committed is kept, the caller applies all of it again later
+    if (!db.commit()) {
+        m_errors.append("Unable to apply file changes: " + db.lastError().text());
+        db.rollback();
+        return false;
+    }
+
+    filesToAdd.removeDuplicates();
+    addFilesToDatabase(filesToAdd);
+    return true;
+}
+
+bool DbUpdater::isKaraokeFile(const QString &path) const
+{
+    const std::string ext = QFileInfo(path).suffix().toLower().toStdString();
+    return std::binary_search(karaoke_file_extensions.begin(), karaoke_file_extensions.end(), ext);
+}
+
+bool DbUpdater::isAudioFile(const QString &path) const
+{
+    const std::string ext = QFileInfo(path).suffix().toLower().toStdString();
+    return std::binary_search(audio_file_extensions.begin(), audio_file_extensions.end(), ext);
+}
+
+bool DbUpdater::hasAudioFile(const QString &cdgPath) const
+{
+    const QString basePath = cdgPath.left(cdgPath.lastIndexOf('.') + 1);
+    for (const auto &ext : audio_file_extensions) {
+        const QString suffix = QString::fromStdString(ext);
+        if (QFileInfo::exists(basePath + suffix) || QFileInfo::exists(basePath + suffix.toUpper()))
+            return true;
+    }
+    return false;
+}
+
+// A cdg is only a song while there is an audio file next to it, add or remove it to match
+void DbUpdater::updatePairedCdg(const QString &audioPath, QStringList &filesToAdd)
+{
+    const QString basePath = audioPath.left(audioPath.lastIndexOf('.') + 1);
+    for (const auto &suffix : {"cdg", "CDG", "Cdg"}) {
+        const QString cdgPath = basePath + suffix;
+        if (!QFileInfo::exists(cdgPath))
+            continue;
+        QSqlQuery query;
+        if (hasAudioFile(cdgPath)) {
+            query.prepare("SELECT 1 FROM dbSongs WHERE path = :path");
+            query.bindValue(":path", cdgPath);
+            query.exec();
+            if (!query.first()) {
+                filesToAdd.append(cdgPath);
+                continue;
+            }
+            // The cdg itself is unchanged, but where the song ends and how loud it is came from the old audio file
+            query.prepare("UPDATE dbSongs SET audioend = NULL, cdgend = NULL, rggain = NULL, rgpeak = NULL WHERE path = :path");
+            query.bindValue(":path", cdgPath);
+            query.exec();
+        }
+        else {
+            query.prepare("DELETE FROM dbSongs WHERE path = :path");
+            query.bindValue(":path", cdgPath);
+            query.exec();
+            filesToAdd.removeAll(cdgPath);
+        }
+    }
+}
+
 int DbUpdater::missingFilesCount()
 {
     return m_missingFilesSongIds.length();
@@ -246,54 +579,68 @@ void DbUpdater::DiskEnumerator::findKaraokeFilesOnDisk() {
 
     emit m_parent.progressChanged(0, 0);
 
-    // cdg and zip files
-    QStringList karaoke_files;
+    emit m_parent.stateChanged("Finding karaoke files...");
+    QApplication::processEvents();
+
+    // Directories whose mtime hasn't changed since the last scan come out of the cache instead of being listed again
+    DirectoryListingCache listingCache(m_parent.m_paths);
+    listingCache.load();
+
+    // Listing is bound by file system round trips rather than cpu, keep more listings in flight than there are cores
+    DirectoryWalker walker(qMax(8, QThread::idealThreadCount() * 2), &listingCache);
+    // cdg and zip files, one list per walker thread
+    std::vector<QStringList> karaoke_files(walker.threadCount());
     // audio files to match with cdg files
-    QStringList audio_files;
-    karaoke_files.reserve(200000);
-    audio_files.reserve(200000);
+    std::vector<QStringList> audio_files(walker.threadCount());
+    std::atomic<int> found{0};
 
-    foreach(auto path, m_parent.m_paths ) {
-        emit m_parent.stateChanged("Finding karaoke files in " + path);
-        QApplication::processEvents();
+    auto visitor = [&] (int worker, const QString &dirPrefix, const QStringList &fileNames) {
+        foreach(const auto &fileName, fileNames) {
+            const int extPos = fileName.lastIndexOf('.');
+            const std::string ext = extPos < 0 ? std::string() : fileName.mid(extPos + 1).toLower().toStdString();
 
-        int foundInPath = 0;
-        QDir dir(path);
-        QDirIterator iterator(dir.absolutePath(), QDirIterator::Subdirectories);
-        while (iterator.hasNext()) {
-            iterator.next();
-            if (!iterator.fileInfo().isDir()) {
-                const std::string ext = iterator.fileInfo().suffix().toLower().toStdString();
-
-                if (std::binary_search(m_parent.karaoke_file_extensions.begin(), m_parent.karaoke_file_extensions.end(), ext)) {
-                    karaoke_files.append(iterator.filePath());
-                    foundInPath++;
-                }
-                else if (std::binary_search(m_parent.audio_file_extensions.begin(), m_parent.audio_file_extensions.end(), ext)) {
-                    const QString filePath = iterator.filePath();
-                    audio_files.append(filePath.left(filePath.lastIndexOf('.')));
-                }
+            if (std::binary_search(m_parent.karaoke_file_extensions.begin(), m_parent.karaoke_file_extensions.end(), ext)) {
+                karaoke_files[worker].append(dirPrefix + fileName);
+                found++;
             }
-            if (m_parent.shouldUpdateGui()) {
-                emit m_parent.stateChanged(QString("Scanning %1\n    %2 found, %3 total...")
-                                  .arg(path)
-                                  .arg(foundInPath)
-                                  .arg(karaoke_files.length()));
-                QApplication::processEvents();
+            else if (std::binary_search(m_parent.audio_file_extensions.begin(), m_parent.audio_file_extensions.end(), ext)) {
+                audio_files[worker].append(dirPrefix + fileName.left(extPos));
             }
         }
-    }
+    };
+
+    QElapsedTimer walkTimer;
+    walkTimer.start();
+    QThreadPool pool;
+    pool.setMaxThreadCount(1);
+    QFuture<void> walkFuture = QtConcurrent::run(&pool, [&] () { walker.walk(m_parent.m_paths, visitor); });
+    QEventLoop loop;
+    QTimer progressTimer;
+    QFutureWatcher<void> walkWatcher;
+    QObject::connect(&walkWatcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&progressTimer, &QTimer::timeout, &m_parent, [&] () {
+        emit m_parent.stateChanged(QString("Scanning %1\n    %2 found...")
+                                   .arg(m_parent.m_paths.join(", "))
+                                   .arg(found.load()));
+    });
+    progressTimer.start(200);
+    walkWatcher.setFuture(walkFuture);
+    if (!walkFuture.isFinished())
+        loop.exec();
+    progressTimer.stop();
+    pool.waitForDone();
+
+    listingCache.save();
+    qInfo() << "Found" << found.load() << "karaoke files in" << walkTimer.elapsed() << "ms, listed"
+            << listingCache.listedCount() << "changed directories and reused" << listingCache.reusedCount() << "cached listings";
 
     emit m_parent.stateChanged("Sorting...");
     QApplication::processEvents();
 
-    karaoke_files.sort();
-    audio_files.sort();
+    m_karaokeFilesOnDisk = DirectoryWalker::mergeSorted(karaoke_files);
+    m_audioFilesOnDisk = DirectoryWalker::mergeSorted(audio_files);
 
     emit m_parent.stateChanged("Done searching for files.");
-
-    m_karaokeFilesOnDisk = karaoke_files;
-    m_audioFilesOnDisk = audio_files;
 }
 
 void DbUpdater::DiskEnumerator::readNextDiskFile()
@@ -373,6 +720,10 @@ void DbUpdater::DbEnumerator::readNextRecord()
             .path =      m_dbSongs.value(1).toString()
         };
     }
+    else {
+        // Release the read statement so the import writer's connection can take the write lock.
+        m_dbSongs.finish();
+    }
 }
 
 void DbUpdater::setPaths(const QList<QString> &paths)
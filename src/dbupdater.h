@@ -104,6 +104,10 @@ private:
     QElapsedTimer m_guiUpdateTimer;
 
     void setPaths(const QList<QString> &paths);
+    bool isKaraokeFile(const QString &path) const;
+    bool isAudioFile(const QString &path) const;
+    bool hasAudioFile(const QString &cdgPath) const;
+    void updatePairedCdg(const QString &audioPath, QStringList &filesToAdd);
     void fixMissingFiles(QVector<DbSongRecord> &filesMissingOnDisk, QStringList &newFilesOnDisk);
     bool shouldUpdateGui();
 
@@ -118,11 +122,23 @@ public:
     };
     Q_DECLARE_FLAGS(ProcessingOptions, ProcessingOption)
 
+    // A file or directory that appeared, went away or was renamed, as seen by a file system watcher
+    struct FileChange
+    {
+        enum Type { Added, Removed, Moved };
+        Type type{Added};
+        bool isDir{false};
+        QString path;
+        // Where a moved file or directory went
+        QString newPath;
+    };
+
     explicit DbUpdater(QObject *parent = nullptr);
 
     QStringList getErrors();
     bool process(const QList<QString> &paths, ProcessingOptions options);
     void addFilesToDatabase(const QList<QString> &files);
+    bool applyFileChanges(const QVector<FileChange> &changes);
     int missingFilesCount();
     void removeMissingFilesFromDatabase();
 
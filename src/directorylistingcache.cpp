@@ -0,0 +1,166 @@
+#include "directorylistingcache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariant>
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+// Directory listings newer than this, relative to their mtime, may miss a change made within the same mtime tick
+// (2s on FAT and some SMB servers)
+constexpr qint64 RACY_MTIME_WINDOW_MS = 2000;
+
+// '/' can't be part of a file name on any platform, so it doubles as the separator for the stored name lists
+const QChar NAME_SEPARATOR{'/'};
+
+QStringList splitNames(const QString &names)
+{
+    return names.isEmpty() ? QStringList() : names.split(NAME_SEPARATOR);
+}
+
+}
+
+DirectoryListingCache::DirectoryListingCache(const QStringList &rootPaths)
+{
+    for (const auto &rootPath : rootPaths)
+        m_rootPaths.append(QDir(rootPath).absolutePath());
+}
+
+void DirectoryListingCache::load()
+{
+    m_listings.clear();
+    m_visited.clear();
+    m_listed.clear();
+    QSqlQuery query;
+    // A range instead of LIKE, paths may contain wildcard characters and LIKE ignores case. '0' sorts right after '/'.
+    query.prepare("SELECT path, mtime, entries, files, subdirs FROM dirListingCache "
+                  "WHERE path = :root OR (path >= :prefix AND path < :end)");
+    for (const auto &rootPath : qAsConst(m_rootPaths))
+    {
+        QString prefix = rootPath.endsWith('/') ? rootPath : rootPath + '/';
+        query.bindValue(":root", rootPath);
+        query.bindValue(":prefix", prefix);
+        query.bindValue(":end", prefix.left(prefix.length() - 1) + '0');
+        query.exec();
+        while (query.next())
+        {
+            Listing listing;
+            listing.mtime = query.value(1).toLongLong();
+            listing.entries = query.value(2).toInt();
+            listing.files = splitNames(query.value(3).toString());
+            listing.subdirs = splitNames(query.value(4).toString());
+            m_listings.insert(query.value(0).toString(), listing);
+        }
+    }
+}
+
+DirectoryListingCache::Listing DirectoryListingCache::listing(const QString &dirPath)
+{
+    QFileInfo dirInfo(dirPath);
+    if (!dirInfo.isDir())
+        return {};
+    const qint64 mtime = dirInfo.lastModified().toMSecsSinceEpoch();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_visited.insert(dirPath);
+        auto it = m_listings.constFind(dirPath);
+        if (it != m_listings.cend() && it->mtime == mtime && it->entries == it->files.size() + it->subdirs.size())
+            return *it;
+    }
+    Listing listing = listDirectory(dirPath);
+    if (QDateTime::currentMSecsSinceEpoch() - mtime >= RACY_MTIME_WINDOW_MS)
+        listing.mtime = mtime;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_listed.insert(dirPath);
+    m_listings.insert(dirPath, listing);
+    return listing;
+}
+
+void DirectoryListingCache::save()
+{
+    auto db = QSqlDatabase::database();
+    db.transaction();
+    QSqlQuery query;
+    query.prepare("INSERT OR REPLACE INTO dirListingCache (path, mtime, entries, files, subdirs) "
+                  "VALUES(:path, :mtime, :entries, :files, :subdirs)");
+    for (const auto &path : qAsConst(m_listed))
+    {
+        const auto &listing = m_listings[path];
+        query.bindValue(":path", path);
+        query.bindValue(":mtime", listing.mtime);
+        query.bindValue(":entries", listing.entries);
+        query.bindValue(":files", listing.files.join(NAME_SEPARATOR));
+        query.bindValue(":subdirs", listing.subdirs.join(NAME_SEPARATOR));
+        query.exec();
+    }
+    query.prepare("DELETE FROM dirListingCache WHERE path = :path");
+    for (auto it = m_listings.cbegin(); it != m_listings.cend(); ++it)
+    {
+        if (m_visited.contains(it.key()))
+            continue;
+        query.bindValue(":path", it.key());
+        query.exec();
+    }
+    db.commit();
+}
+
+DirectoryListingCache::Listing DirectoryListingCache::listDirectory(const QString &dirPath)
+{
+    Listing listing;
+#ifdef Q_OS_LINUX
+    DIR *dir = opendir(QFile::encodeName(dirPath).constData());
+    if (!dir)
+        return listing;
+    while (auto entry = readdir(dir))
+    {
+        // Hidden entries as well as . and ..
+        if (entry->d_name[0] == '.')
+            continue;
+        bool isFile = entry->d_type == DT_REG;
+        bool isDir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            bool isLink = entry->d_type == DT_LNK;
+            if (!isLink)
+            {
+                if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                isLink = S_ISLNK(st.st_mode);
+            }
+            // A symlink counts as what it points to, except that QDirIterator doesn't follow symlinked directories
+            if (isLink && fstatat(dirfd(dir), entry->d_name, &st, 0) != 0)
+                continue;
+            isFile = S_ISREG(st.st_mode);
+            isDir = S_ISDIR(st.st_mode) && !isLink;
+        }
+        if (isFile)
+            listing.files.append(QFile::decodeName(entry->d_name));
+        else if (isDir)
+            listing.subdirs.append(QFile::decodeName(entry->d_name));
+    }
+    closedir(dir);
+#else
+    QDirIterator iterator(dirPath, QDir::AllEntries | QDir::NoDotAndDotDot);
+    while (iterator.hasNext())
+    {
+        iterator.next();
+        if (!iterator.fileInfo().isDir())
+            listing.files.append(iterator.fileName());
+        else if (!iterator.fileInfo().isSymLink())
+            listing.subdirs.append(iterator.fileName());
+    }
+#endif
+    listing.entries = listing.files.size() + listing.subdirs.size();
+    return listing;
+}
@@ -0,0 +1,68 @@
+#ifndef DIRECTORYLISTINGCACHE_H
+#define DIRECTORYLISTINGCACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <mutex>
+
+/**
+ * @brief Remembers what the directories below the library roots contained, so a rescan only re-lists the ones that changed.
+ *
+ * Each directory is stored in the dirListingCache table with its mtime, its entry count and the names of its files and
+ * subdirectories. A directory's mtime changes whenever an entry is added to, removed from or renamed in it, so a
+ * directory whose mtime still matches is taken from the cache without listing it. Its subdirectories are still checked
+ * one by one. A listing whose mtime is too close to the time it was listed could be followed by a change within the same
+ * mtime tick, so it is stored as never matching and listed again on the next scan.
+ *
+ * load() and save() use the default database connection and belong on the GUI thread, listing() may be called from any
+ * number of threads in between.
+ */
+class DirectoryListingCache
+{
+public:
+    struct Listing
+    {
+        qint64 mtime{-1};
+        int entries{0};
+        QStringList files;
+        QStringList subdirs;
+    };
+
+    explicit DirectoryListingCache(const QStringList &rootPaths);
+
+    /**
+     * @brief Loads the stored listings of the roots and everything below them.
+     */
+    void load();
+    /**
+     * @brief Listing of a directory below one of the roots, from the cache if its mtime hasn't changed.
+     */
+    Listing listing(const QString &dirPath);
+    /**
+     * @brief Stores the listings that changed and drops the ones of directories that weren't visited this time.
+     */
+    void save();
+
+    int listedCount() const { return m_listed.size(); }
+    int reusedCount() const { return m_visited.size() - m_listed.size(); }
+
+    /**
+     * @brief Lists a directory without going through the cache.
+     *
+     * Lists the same entries a QDirIterator with default filters would: no hidden entries, no broken symlinks and nothing
+     * but regular files and directories. Symlinked directories show up in neither list, as the iterator doesn't follow
+     * them either. On Linux the entry types come from readdir, only symlinks and filesystems without d_type cost a stat.
+     */
+    static Listing listDirectory(const QString &dirPath);
+
+private:
+    QStringList m_rootPaths;
+    std::mutex m_mutex;
+    QHash<QString, Listing> m_listings;
+    QSet<QString> m_visited;
+    QSet<QString> m_listed;
+};
+
+#endif // DIRECTORYLISTINGCACHE_H
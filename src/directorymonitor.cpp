@@ -3,11 +3,34 @@
 #include <QFutureWatcher>
 #include <QtConcurrent>
 
-DirectoryMonitor::DirectoryMonitor(QObject *parent, QStringList pathsToWatch) : QObject(parent)
+// Changes are applied once no new ones came in for a moment, but never later than a second after the first one
+constexpr int JOURNAL_QUIET_MS = 250;
+constexpr qint64 JOURNAL_MAX_DELAY_MS = 1000;
+// With part of the library unwatched, scan it from time to time instead
+constexpr int UNWATCHED_RESCAN_MS = 5 * 60 * 1000;
+
+DirectoryMonitor::DirectoryMonitor(QObject *parent, QStringList pathsToWatch) : QObject(parent), m_rootPaths(pathsToWatch)
 {
     m_scanTimer.setInterval(5000);
     m_scanTimer.setSingleShot(true);
     connect(&m_scanTimer, &QTimer::timeout, this, &DirectoryMonitor::scanPaths);
+    m_rescanTimer.setInterval(UNWATCHED_RESCAN_MS);
+    connect(&m_rescanTimer, &QTimer::timeout, this, &DirectoryMonitor::rescanAll);
+
+#ifdef Q_OS_LINUX
+    // inotify tells which file changed, so changes go straight to the database instead of rescanning directories
+    m_inotifyWatcher = std::make_unique<InotifyWatcher>();
+    if (m_inotifyWatcher->isValid())
+    {
+        m_journalTimer.setSingleShot(true);
+        connect(&m_journalTimer, &QTimer::timeout, this, &DirectoryMonitor::applyJournal);
+        connect(&m_watchesAddedWatcher, &QFutureWatcher<bool>::finished, this, &DirectoryMonitor::watchesAdded);
+        auto watcher = m_inotifyWatcher.get();
+        m_watchesAddedWatcher.setFuture(QtConcurrent::run([watcher, pathsToWatch] () { return watcher->watchTrees(pathsToWatch); }));
+        return;
+    }
+    m_inotifyWatcher.reset();
+#endif
 
     connect(&m_pathsEnumeratedWatcher, &QFutureWatcher<int>::finished, this, &DirectoryMonitor::directoriesEnumerated);
     auto future = QtConcurrent::run(this, &DirectoryMonitor::enumeratePathsAsync, pathsToWatch);
@@ -16,7 +39,11 @@ DirectoryMonitor::DirectoryMonitor(QObject *parent, QStringList pathsToWatch) :
 
 DirectoryMonitor::~DirectoryMonitor()
 {
-    m_fsWatcher.removePaths(m_fsWatcher.directories());
+#ifdef Q_OS_LINUX
+    m_watchesAddedWatcher.waitForFinished();
+#endif
+    if (!m_fsWatcher.directories().isEmpty())
+        m_fsWatcher.removePaths(m_fsWatcher.directories());
 }
 
 QStringList DirectoryMonitor::enumeratePathsAsync(QStringList paths)
@@ -50,6 +77,55 @@ void DirectoryMonitor::directoryChanged(const QString& dirPath)
     m_scanTimer.start();
 }
 
+#ifdef Q_OS_LINUX
+void DirectoryMonitor::watchesAdded()
+{
+    if (!m_watchesAddedWatcher.future().result())
+    {
+        qWarning() << "Not every library directory could be watched, rescanning the library every" << UNWATCHED_RESCAN_MS / 60000 << "minutes";
+        m_rescanTimer.start();
+    }
+    m_inotifyWatcher->start([this] () { journalChanged(); }, [this] () {
+        qWarning() << "inotify event queue overflowed, rescanning the library";
+        rescanAll();
+    });
+}
+
+void DirectoryMonitor::journalChanged()
+{
+    if (!m_journalTimer.isActive())
+        m_firstPendingChange.start();
+    m_journalTimer.start(static_cast<int>(qBound<qint64>(0, JOURNAL_MAX_DELAY_MS - m_firstPendingChange.elapsed(), JOURNAL_QUIET_MS)));
+}
+
+void DirectoryMonitor::applyJournal()
+{
+    // Changes a failed run handed back go first. Adding files runs an event loop, changes that come in meanwhile stay
+    // in the watcher's journal for the next run.
+    auto changes = m_pendingChanges + m_inotifyWatcher->takeJournal();
+    m_pendingChanges.clear();
+    if (changes.isEmpty())
+        return;
+    qInfo() << "Applying" << changes.size() << "file changes to the database";
+    DbUpdater dbUpdater(this);
+    if (dbUpdater.applyFileChanges(changes)) {
+        emit databaseUpdateComplete();
+    }
+    else {
+        // Another scan is running or the database was busy, try again in a moment
+        m_pendingChanges = changes + m_pendingChanges;
+        m_firstPendingChange.start();
+        m_journalTimer.start(JOURNAL_QUIET_MS);
+    }
+}
+#endif
+
+void DirectoryMonitor::rescanAll()
+{
+    m_pathsWithChangedFiles.unite(QSet<QString>(m_rootPaths.begin(), m_rootPaths.end()));
+    m_scanTimer.start();
+}
+
 void DirectoryMonitor::scanPaths()
 {
     auto paths = m_pathsWithChangedFiles.values();
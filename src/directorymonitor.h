@@ -1,12 +1,16 @@
 #ifndef DIRECTORYMONITOR_H
 #define DIRECTORYMONITOR_H
 
+#include <QElapsedTimer>
 #include <QFileSystemWatcher>
 #include <QFutureWatcher>
 #include <QObject>
 #include <QSet>
 #include <QStringList>
 #include <QTimer>
+#include <memory>
+#include "dbupdater.h"
+#include "inotifywatcher.h"
 
 class DirectoryMonitor : public QObject
 {
@@ -22,10 +26,25 @@ private:
 
     QSet<QString> m_pathsWithChangedFiles;
     QTimer m_scanTimer;
+    QStringList m_rootPaths;
+    QTimer m_rescanTimer;
+
+#ifdef Q_OS_LINUX
+    std::unique_ptr<InotifyWatcher> m_inotifyWatcher;
+    QFutureWatcher<bool> m_watchesAddedWatcher;
+    QVector<DbUpdater::FileChange> m_pendingChanges;
+    QTimer m_journalTimer;
+    QElapsedTimer m_firstPendingChange;
+
+    void watchesAdded();
+    void journalChanged();
+    void applyJournal();
+#endif
 
     QStringList enumeratePathsAsync(QStringList paths);
     void directoriesEnumerated();
     void directoryChanged(const QString& dirPath);
+    void rescanAll();
     void scanPaths();
 
 signals:
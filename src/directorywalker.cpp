@@ -0,0 +1,124 @@
+#include "directorywalker.h"
+
+#include <QDir>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include "directorylistingcache.h"
+
+namespace {
+
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<QString> dirs;
+};
+
+}
+
+DirectoryWalker::DirectoryWalker(int threadCount, DirectoryListingCache *cache) :
+    m_threadCount(std::max(1, threadCount)), m_cache(cache)
+{
+}
+
+void DirectoryWalker::walk(const QStringList &rootPaths, const FileVisitor &visitor)
+{
+    std::vector<WorkQueue> queues(m_threadCount);
+    // Directories queued or being listed, the walk is over when it drops to 0
+    std::atomic<int> pending{0};
+    std::mutex idleMutex;
+    std::condition_variable idle;
+
+    for (int i = 0; i < rootPaths.size(); i++)
+        queues[i % m_threadCount].dirs.push_back(QDir(rootPaths.at(i)).absolutePath());
+    pending = rootPaths.size();
+
+    auto takeDir = [&] (int worker, QString &dirPath) {
+        {
+            auto &own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.dirs.empty())
+            {
+                dirPath = std::move(own.dirs.back());
+                own.dirs.pop_back();
+                return true;
+            }
+        }
+        for (int i = 1; i < m_threadCount; i++)
+        {
+            auto &victim = queues[(worker + i) % m_threadCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.dirs.empty())
+            {
+                dirPath = std::move(victim.dirs.front());
+                victim.dirs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto walkWorker = [&] (int worker) {
+        QString dirPath;
+        while (pending > 0)
+        {
+            if (!takeDir(worker, dirPath))
+            {
+                // Everything left is being listed by other threads, wait for them to queue subdirectories or finish
+                std::unique_lock<std::mutex> lock(idleMutex);
+                idle.wait_for(lock, std::chrono::milliseconds(2));
+                continue;
+            }
+            auto listing = m_cache ? m_cache->listing(dirPath) : DirectoryListingCache::listDirectory(dirPath);
+            const QString dirPrefix = dirPath.endsWith('/') ? dirPath : dirPath + '/';
+            if (!listing.files.isEmpty())
+                visitor(worker, dirPrefix, listing.files);
+            if (!listing.subdirs.isEmpty())
+            {
+                // Count the subdirectories before this one is done so pending can't touch 0 in between
+                pending += listing.subdirs.size();
+                {
+                    auto &own = queues[worker];
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    for (const auto &subdir : qAsConst(listing.subdirs))
+                        own.dirs.push_back(dirPrefix + subdir);
+                }
+                idle.notify_all();
+            }
+            if (--pending == 0)
+                idle.notify_all();
+        }
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threadCount);
+    for (int i = 0; i < m_threadCount; i++)
+        QtConcurrent::run(&pool, walkWorker, i);
+    pool.waitForDone();
+}
+
+QStringList DirectoryWalker::mergeSorted(std::vector<QStringList> &lists)
+{
+    QtConcurrent::blockingMap(lists, [] (QStringList &list) { list.sort(); });
+    while (lists.size() > 1)
+    {
+        std::vector<QStringList> merged;
+        for (size_t i = 0; i + 1 < lists.size(); i += 2)
+        {
+            QStringList list;
+            list.reserve(lists[i].size() + lists[i + 1].size());
+            std::merge(lists[i].cbegin(), lists[i].cend(), lists[i + 1].cbegin(), lists[i + 1].cend(), std::back_inserter(list));
+            merged.push_back(list);
+        }
+        if (lists.size() % 2)
+            merged.push_back(lists.back());
+        lists.swap(merged);
+    }
+    return lists.empty() ? QStringList() : lists.front();
+}
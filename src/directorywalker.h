@@ -0,0 +1,52 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <vector>
+
+class DirectoryListingCache;
+
+/**
+ * @brief Lists directory trees on several threads at once.
+ *
+ * Each thread keeps its own queue of directories still to list. It works depth first through its own queue and, once
+ * that runs dry, steals the oldest directory from another thread's queue, which tends to be the root of the largest
+ * unexplored subtree. On network shares this keeps several directory listings in flight instead of paying each round
+ * trip in turn.
+ */
+class DirectoryWalker
+{
+public:
+    /**
+     * @brief Called on the worker threads with the files of each directory.
+     *
+     * @param worker Index of the calling thread, below threadCount(), so results can be gathered without locking.
+     * @param dirPrefix Path of the directory, ending in a separator.
+     */
+    using FileVisitor = std::function<void(int worker, const QString &dirPrefix, const QStringList &fileNames)>;
+
+    /**
+     * @param cache Cache to take unchanged listings from, nullptr to list every directory.
+     */
+    explicit DirectoryWalker(int threadCount, DirectoryListingCache *cache = nullptr);
+
+    /**
+     * @brief Walks all directories below rootPaths and returns once every one of them has been visited.
+     */
+    void walk(const QStringList &rootPaths, const FileVisitor &visitor);
+
+    int threadCount() const { return m_threadCount; }
+
+    /**
+     * @brief Sorts each of the per thread lists on its own thread, then merges them into one sorted list.
+     */
+    static QStringList mergeSorted(std::vector<QStringList> &lists);
+
+private:
+    int m_threadCount;
+    DirectoryListingCache *m_cache;
+};
+
+#endif // DIRECTORYWALKER_H
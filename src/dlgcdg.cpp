@@ -316,7 +316,7 @@ void DlgCdg::timer1sTimeout()
         }
         if (m_kmb.state() == MediaBackend::PlayingState)
         {
-            m_tWidget->setString(" " + MediaBackend::msToMMSS(m_kmb.duration() - m_kmb.position()) + " ");
+            m_tWidget->setString(" " + MediaBackend::msToMMSS(m_kmb.endPosition() - m_kmb.position()) + " ");
         }
     }
 }
@@ -84,7 +84,9 @@ DlgSettings::DlgSettings(MediaBackend &AudioBackend, MediaBackend &BmAudioBacken
     ui->tabWidgetMain->setCurrentIndex(0);
     ui->checkBoxDbSkipValidation->setChecked(m_settings.dbSkipValidation());
     ui->checkBoxLazyLoadDurations->setChecked(m_settings.dbLazyLoadDurations());
+    ui->spinBoxDbImportThreads->setValue(m_settings.dbImportThreads());
     ui->checkBoxMonitorDirs->setChecked(m_settings.dbDirectoryWatchEnabled());
+    ui->checkBoxDbFullTextSearch->setChecked(m_settings.dbFullTextSearch());
     ui->groupBoxShowDuration->setChecked(m_settings.cdgRemainEnabled());
     ui->cbxRotShowNextSong->setChecked(m_settings.rotationShowNextSong());
     ui->checkBoxCdgPrescaling->setChecked(m_settings.cdgPrescalingEnabled());
@@ -164,6 +166,7 @@ DlgSettings::DlgSettings(MediaBackend &AudioBackend, MediaBackend &BmAudioBacken
     ui->checkBoxFaderBm->setChecked(m_settings.audioUseFaderBm());
     ui->checkBoxDownmixBm->setChecked(m_settings.audioDownmixBm());
     ui->checkBoxSilenceDetectionBm->setChecked(m_settings.audioDetectSilenceBm());
+    ui->spinBoxCrossfadeBm->setValue(m_settings.bmCrossfadeMs() / 1000);
     ui->spinBoxInterval->setValue(m_settings.requestServerInterval());
     ui->spinBoxSystemId->setMaximum(songbookApi.entitledSystemCount());
     ui->spinBoxSystemId->setValue(m_settings.systemId());
@@ -263,6 +266,9 @@ DlgSettings::DlgSettings(MediaBackend &AudioBackend, MediaBackend &BmAudioBacken
     connect(ui->checkBoxDbSkipValidation, &QCheckBox::toggled, &m_settings, &Settings::dbSetSkipValidation);
     connect(ui->checkBoxLazyLoadDurations, &QCheckBox::toggled, &m_settings, &Settings::dbSetLazyLoadDurations);
     connect(ui->checkBoxMonitorDirs, &QCheckBox::toggled, &m_settings, &Settings::dbSetDirectoryWatchEnabled);
+    connect(ui->spinBoxDbImportThreads, qOverload<int>(&QSpinBox::valueChanged), &m_settings, &Settings::dbSetImportThreads);
+    connect(ui->checkBoxDbFullTextSearch, &QCheckBox::toggled, &m_settings, &Settings::dbSetFullTextSearch);
+    connect(ui->checkBoxDbFullTextSearch, &QCheckBox::toggled, this, &DlgSettings::dbFullTextSearchChanged);
     connect(ui->spinBoxSystemId, qOverload<int>(&QSpinBox::valueChanged), &m_settings, &Settings::setSystemId);
     connect(ui->checkBoxTreatAllSingersAsRegs, &QAbstractButton::toggled, &m_settings,
             &Settings::setTreatAllSingersAsRegs);
@@ -573,6 +579,12 @@ void DlgSettings::on_checkBoxSilenceDetectionBm_toggled(bool checked) {
     emit audioSilenceDetectChangedBm(checked);
 }
 
+void DlgSettings::on_spinBoxCrossfadeBm_valueChanged(int arg1) {
+    if (!m_pageSetupDone)
+        return;
+    m_settings.setBmCrossfadeMs(arg1 * 1000);
+}
+
 void DlgSettings::on_checkBoxDownmix_toggled(bool checked) {
     if (!m_pageSetupDone)
         return;
@@ -105,6 +105,7 @@ signals:
     void rotationShowNextSongChanged(bool enabled);
     void requestServerEnableChanged(bool enabled);
     void videoOffsetChanged(int offsetMs);
+    void dbFullTextSearchChanged(bool enabled);
 
 private slots:
     void comboBoxConsoleLogLevelChanged(int index);
@@ -127,6 +128,7 @@ private slots:
     void on_checkBoxSilenceDetectionBm_toggled(bool checked);
     void on_checkBoxDownmix_toggled(bool checked);
     void on_checkBoxDownmixBm_toggled(bool checked);
+    void on_spinBoxCrossfadeBm_valueChanged(int arg1);
     void on_comboBoxDevice_currentIndexChanged(const QString &arg1);
     void on_comboBoxCodec_currentIndexChanged(const QString &arg1);
     void on_groupBoxRecording_toggled(bool arg1);
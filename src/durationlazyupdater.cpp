@@ -1,44 +1,101 @@
 #include "durationlazyupdater.h"
 
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSqlDatabase>
 #include <QSqlQuery>
+#include <QThreadPool>
 #include <QVariant>
+#include <QtConcurrent>
+#include <atomic>
+#include "durationprobe.h"
 #include "mzarchive.h"
 #include "karaokefileinfo.h"
 
+LazyDurationUpdateWorker::LazyDurationUpdateWorker()
+{
+    m_logger = spdlog::get("logger");
+}
+
+unsigned int LazyDurationUpdateWorker::songDuration(const QString &path, bool &usedDiscoverer)
+{
+    usedDiscoverer = false;
+    unsigned int duration = 0;
+    if (path.endsWith(".zip", Qt::CaseInsensitive))
+    {
+        MzArchive archive(path);
+        duration = archive.getSongDuration();
+    }
+    else
+    {
+        duration = DurationProbe::fromHeaders(path);
+    }
+    if (duration == 0)
+    {
+        usedDiscoverer = true;
+        KaraokeFileInfo parser;
+        parser.setFile(path);
+        duration = parser.getDuration();
+    }
+    return duration;
+}
 
 void LazyDurationUpdateWorker::getDurations(const QStringList &files) {
     if (files.isEmpty())
         return;
-    std::string m_loggingPrefix{"[LazyDurationThread]"};
-    std::shared_ptr<spdlog::logger> logger;
-    logger = spdlog::get("logger");
-    logger->info("{} Starting scan", m_loggingPrefix);
-    MzArchive archive;
-    KaraokeFileInfo parser;
-    for (const auto &path : files)
-    {
-        unsigned int duration = 0;
-        if (path.endsWith(".zip", Qt::CaseInsensitive))
-        {
-            archive.setArchiveFile(path);
-            duration = archive.getSongDuration();
-        }
-        if (duration == 0)
+    m_logger->info("{} Starting scan of {} songs", m_loggingPrefix, files.size());
+    QElapsedTimer timer;
+    timer.start();
+
+    auto workerThread = QThread::currentThread();
+    std::atomic<int> nextFile{0};
+    std::atomic<int> discovered{0};
+    QMutex resultsMutex;
+    QStringList paths;
+    QVector<unsigned int> durations;
+    auto probeFiles = [&] () {
+        QThread::currentThread()->setPriority(QThread::IdlePriority);
+        for (int i = nextFile++; i < files.size() && !workerThread->isInterruptionRequested(); i = nextFile++)
         {
-            parser.setFile(path);
-            duration = parser.getDuration();
-        }
-        if (duration == 0)
-            logger->warn("{} Unable to get duration for file {}. - File is likely corrupted or invalid", m_loggingPrefix, path);
-        else
-            logger->trace("{} Got duration: {} for file: {}", m_loggingPrefix, duration, path);
-        emit gotDuration(path, duration);
-        if (QThread::currentThread()->isInterruptionRequested()) {
-            logger->info("{} Scan interrupt requested", m_loggingPrefix);
-            break;
+            const auto &path = files.at(i);
+            bool usedDiscoverer;
+            auto duration = songDuration(path, usedDiscoverer);
+            if (usedDiscoverer)
+                discovered++;
+            if (duration == 0)
+                m_logger->warn("{} Unable to get duration for file {}. - File is likely corrupted or invalid", m_loggingPrefix, path);
+            else
+                m_logger->trace("{} Got duration: {} for file: {}", m_loggingPrefix, duration, path);
+            QMutexLocker locker(&resultsMutex);
+            paths.append(path);
+            durations.append(duration);
         }
+    };
+
+    // Reading headers mostly waits on the disk, so use more threads than there are cores
+    QThreadPool pool;
+    pool.setMaxThreadCount(QThread::idealThreadCount() * 2);
+    for (int i = 0; i < pool.maxThreadCount(); i++)
+        QtConcurrent::run(&pool, probeFiles);
+
+    bool done{false};
+    while (!done)
+    {
+        done = pool.waitForDone(1000);
+        QMutexLocker locker(&resultsMutex);
+        if (paths.isEmpty())
+            continue;
+        emit gotDurations(paths, durations);
+        paths.clear();
+        durations.clear();
     }
-    logger->info("{} Scan complete", m_loggingPrefix);
+
+    if (workerThread->isInterruptionRequested())
+        m_logger->info("{} Scan interrupt requested", m_loggingPrefix);
+    int scanned = std::min(static_cast<int>(nextFile), static_cast<int>(files.size()));
+    auto elapsed = std::max<qint64>(timer.elapsed(), 1);
+    m_logger->info("{} Scan complete, {} songs in {}ms ({:.1f} songs/s), {} needed a full discovery", m_loggingPrefix,
+                   scanned, elapsed, scanned * 1000.0 / elapsed, discovered.load());
 }
 
 LazyDurationUpdateController::LazyDurationUpdateController(QObject *parent) : QObject(parent) {
@@ -48,7 +105,7 @@ LazyDurationUpdateController::LazyDurationUpdateController(QObject *parent) : QO
     worker->moveToThread(&workerThread);
     connect(&workerThread, &QThread::finished, worker, &QObject::deleteLater);
     connect(this, &LazyDurationUpdateController::operate, worker, &LazyDurationUpdateWorker::getDurations);
-    connect(worker, &LazyDurationUpdateWorker::gotDuration, this, &LazyDurationUpdateController::updateDbDuration);
+    connect(worker, &LazyDurationUpdateWorker::gotDurations, this, &LazyDurationUpdateController::updateDbDurations);
     workerThread.start();
     workerThread.setPriority(QThread::IdlePriority);
 }
@@ -77,14 +134,21 @@ void LazyDurationUpdateController::stopWork()
     workerThread.requestInterruption();
 }
 
-void LazyDurationUpdateController::updateDbDuration(const QString& file, int duration)
+void LazyDurationUpdateController::updateDbDurations(const QStringList &paths, const QVector<unsigned int> &durations)
 {
+    auto db = QSqlDatabase::database();
+    db.transaction();
     QSqlQuery query;
     query.prepare("UPDATE dbsongs SET duration = :duration WHERE path = :path");
-    query.bindValue(":path", file);
-    query.bindValue(":duration", duration);
-    query.exec();
-    emit gotDuration(file, duration);
+    for (int i = 0; i < paths.size(); i++)
+    {
+        query.bindValue(":path", paths.at(i));
+        query.bindValue(":duration", durations.at(i));
+        query.exec();
+    }
+    db.commit();
+    for (int i = 0; i < paths.size(); i++)
+        emit gotDuration(paths.at(i), durations.at(i));
 }
 
 void LazyDurationUpdateController::getDurations()
@@ -3,19 +3,34 @@
 
 #include <QObject>
 #include <QThread>
+#include <QVector>
 #include <spdlog/spdlog.h>
 #include <spdlog/async_logger.h>
 #include <spdlog/fmt/ostr.h>
 
 std::ostream& operator<<(std::ostream& os, const QString& s);
 
+/**
+ * @brief Reads the durations of songs on a pool of idle priority threads, from the file headers where possible and
+ * through a full discovery otherwise.
+ *
+ * Results are handed over in batches about once a second, so they can be written in a single transaction each.
+ */
 class LazyDurationUpdateWorker : public QObject
 {
     Q_OBJECT
+    std::string m_loggingPrefix{"[LazyDurationThread]"};
+    std::shared_ptr<spdlog::logger> m_logger;
+
+    static unsigned int songDuration(const QString &path, bool &usedDiscoverer);
+
+public:
+    LazyDurationUpdateWorker();
+
 public slots:
     void getDurations(const QStringList &files);
 signals:
-    void gotDuration(const QString&, unsigned int);
+    void gotDurations(const QStringList &paths, const QVector<unsigned int> &durations);
 
 };
 
@@ -33,7 +48,7 @@ public:
     void getSongsRequiringUpdate();
     void stopWork();
 public slots:
-    void updateDbDuration(const QString& file, int duration);
+    void updateDbDurations(const QStringList &paths, const QVector<unsigned int> &durations);
     void getDurations();
 signals:
     void operate(const QStringList &list);
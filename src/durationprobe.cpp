@@ -0,0 +1,318 @@
+#include "durationprobe.h"
+
+#include <QFileInfo>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Bytes after the ID3v2 tag searched for the first MP3 frame
+constexpr qint64 MP3_SYNC_SEARCH_BYTES = 65536;
+// CDG streams are 75 sectors of 4 packets of 24 bytes per second
+constexpr qint64 CDG_BYTES_PER_SECOND = 7200;
+
+constexpr qint64 EBML_HEADER_ID = 0x1A45DFA3;
+constexpr qint64 EBML_SEGMENT_ID = 0x18538067;
+constexpr qint64 EBML_INFO_ID = 0x1549A966;
+constexpr qint64 EBML_TIMECODE_SCALE_ID = 0x2AD7B1;
+constexpr qint64 EBML_DURATION_ID = 0x4489;
+constexpr qint64 EBML_CLUSTER_ID = 0x1F43B675;
+
+// kbps by [MPEG-1 or not][layer - 1][bitrate index]
+constexpr int MP3_BITRATES[2][3][15] = {
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 }
+    },
+    {
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }
+    }
+};
+constexpr int MP3_SAMPLE_RATES[3] = { 44100, 48000, 32000 };
+
+struct Mp3FrameHeader {
+    bool mpeg1{true};
+    bool mono{false};
+    int layer{3};
+    int bitrate{0};
+    int sampleRate{0};
+    int samplesPerFrame{0};
+    int frameLength{0};
+};
+
+bool parseMp3FrameHeader(const uchar *bytes, Mp3FrameHeader &header)
+{
+    if (bytes[0] != 0xFF || (bytes[1] & 0xE0) != 0xE0)
+        return false;
+    int versionBits = (bytes[1] >> 3) & 0x03; // 3: MPEG-1, 2: MPEG-2, 0: MPEG-2.5
+    int layerBits = (bytes[1] >> 1) & 0x03;   // 3: layer I, 2: layer II, 1: layer III
+    int bitrateIndex = bytes[2] >> 4;
+    int sampleRateIndex = (bytes[2] >> 2) & 0x03;
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || sampleRateIndex == 3)
+        return false;
+
+    header.mpeg1 = versionBits == 3;
+    header.mono = (bytes[3] >> 6) == 3;
+    header.layer = 4 - layerBits;
+    header.bitrate = MP3_BITRATES[header.mpeg1 ? 0 : 1][header.layer - 1][bitrateIndex];
+    header.sampleRate = MP3_SAMPLE_RATES[sampleRateIndex] >> (versionBits == 3 ? 0 : versionBits == 2 ? 1 : 2);
+    int padding = (bytes[2] >> 1) & 0x01;
+    if (header.layer == 1)
+    {
+        header.samplesPerFrame = 384;
+        header.frameLength = (12 * header.bitrate * 1000 / header.sampleRate + padding) * 4;
+    }
+    else
+    {
+        header.samplesPerFrame = (header.layer == 3 && !header.mpeg1) ? 576 : 1152;
+        header.frameLength = header.samplesPerFrame / 8 * header.bitrate * 1000 / header.sampleRate + padding;
+    }
+    return true;
+}
+
+// Finds the first box of a type between start and end and narrows start and end down to its content
+bool findMp4Box(QFile &file, qint64 &start, qint64 &end, const char *type)
+{
+    qint64 pos = start;
+    while (pos + 8 <= end)
+    {
+        if (!file.seek(pos))
+            return false;
+        auto header = file.read(16);
+        if (header.size() < 8)
+            return false;
+        auto bytes = reinterpret_cast<const uchar*>(header.constData());
+        qint64 size = qFromBigEndian<quint32>(bytes);
+        qint64 headerSize = 8;
+        if (size == 1)
+        {
+            // 64 bit size follows the type
+            if (header.size() < 16)
+                return false;
+            size = static_cast<qint64>(qFromBigEndian<quint64>(bytes + 8));
+            headerSize = 16;
+        }
+        else if (size == 0)
+        {
+            // Extends to the end of the file
+            size = end - pos;
+        }
+        if (size < headerSize)
+            return false;
+        if (memcmp(bytes + 4, type, 4) == 0)
+        {
+            start = pos + headerSize;
+            end = std::min(pos + size, end);
+            return true;
+        }
+        pos += size;
+    }
+    return false;
+}
+
+// Reads an EBML variable length integer. Element ids keep their length marker, sizes don't and are -1 if unknown.
+bool readEbmlVint(QFile &file, bool keepMarker, qint64 &value)
+{
+    char c;
+    if (!file.getChar(&c))
+        return false;
+    auto firstByte = static_cast<uchar>(c);
+    int length = 1;
+    while (length <= 8 && !(firstByte & (0x80 >> (length - 1))))
+        length++;
+    if (length > 8)
+        return false;
+    uchar mask = 0xFF >> length;
+    quint64 result = keepMarker ? firstByte : firstByte & mask;
+    bool allOnes = (firstByte & mask) == mask;
+    for (int i = 1; i < length; i++)
+    {
+        if (!file.getChar(&c))
+            return false;
+        result = (result << 8) | static_cast<uchar>(c);
+        allOnes = allOnes && static_cast<uchar>(c) == 0xFF;
+    }
+    value = (!keepMarker && allOnes) ? -1 : static_cast<qint64>(result);
+    return true;
+}
+
+int clampToInt(qint64 ms)
+{
+    return static_cast<int>(std::clamp<qint64>(ms, 0, std::numeric_limits<int>::max()));
+}
+
+}
+
+int DurationProbe::fromHeaders(const QString &path)
+{
+    QFile file(path);
+    auto suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "cdg")
+        return cdgDuration(file);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+    if (suffix == "mp3")
+        return mp3Duration(file);
+    if (suffix == "mp4" || suffix == "m4a" || suffix == "m4v" || suffix == "mov")
+        return mp4Duration(file);
+    if (suffix == "mkv" || suffix == "mka" || suffix == "webm")
+        return mkvDuration(file);
+    return 0;
+}
+
+int DurationProbe::cdgDuration(const QFile &file)
+{
+    return clampToInt(file.size() * 1000 / CDG_BYTES_PER_SECOND);
+}
+
+int DurationProbe::mp3Duration(QFile &file)
+{
+    qint64 audioStart = 0;
+    auto id3 = file.read(10);
+    if (id3.size() == 10 && id3.startsWith("ID3"))
+    {
+        // Synchsafe tag size, excluding the header and the optional footer
+        auto bytes = reinterpret_cast<const uchar*>(id3.constData());
+        audioStart = 10 + ((bytes[6] & 0x7F) << 21 | (bytes[7] & 0x7F) << 14 | (bytes[8] & 0x7F) << 7 | (bytes[9] & 0x7F));
+        if (bytes[5] & 0x10)
+            audioStart += 10;
+    }
+    if (!file.seek(audioStart))
+        return 0;
+    auto data = file.read(MP3_SYNC_SEARCH_BYTES);
+    auto bytes = reinterpret_cast<const uchar*>(data.constData());
+    for (int i = 0; i + 4 <= data.size(); i++)
+    {
+        Mp3FrameHeader header;
+        if (!parseMp3FrameHeader(bytes + i, header))
+            continue;
+        // A sync word that isn't followed by another one where the frame ends is most likely part of the tag or junk
+        Mp3FrameHeader nextHeader;
+        if (i + header.frameLength + 4 <= data.size() && !parseMp3FrameHeader(bytes + i + header.frameLength, nextHeader))
+            continue;
+
+        // VBR encoders store the frame count in a Xing/Info header after the side info, or in a VBRI header
+        qint64 frames = 0;
+        int xingOffset = i + 4 + (header.mpeg1 ? (header.mono ? 17 : 32) : (header.mono ? 9 : 17));
+        int vbriOffset = i + 4 + 32;
+        if (xingOffset + 12 <= data.size() &&
+                (memcmp(bytes + xingOffset, "Xing", 4) == 0 || memcmp(bytes + xingOffset, "Info", 4) == 0))
+        {
+            if (qFromBigEndian<quint32>(bytes + xingOffset + 4) & 0x01)
+                frames = qFromBigEndian<quint32>(bytes + xingOffset + 8);
+        }
+        else if (vbriOffset + 18 <= data.size() && memcmp(bytes + vbriOffset, "VBRI", 4) == 0)
+        {
+            frames = qFromBigEndian<quint32>(bytes + vbriOffset + 14);
+        }
+        if (frames > 0)
+            return clampToInt(frames * header.samplesPerFrame * 1000 / header.sampleRate);
+
+        // Constant bitrate, everything from here on is audio except an ID3v1 tag at the end
+        qint64 audioBytes = file.size() - audioStart - i;
+        if (file.seek(file.size() - 128) && file.read(3) == "TAG")
+            audioBytes -= 128;
+        return clampToInt(audioBytes * 8 / header.bitrate);
+    }
+    return 0;
+}
+
+int DurationProbe::mp4Duration(QFile &file)
+{
+    qint64 start = 0;
+    qint64 end = file.size();
+    if (!findMp4Box(file, start, end, "moov") || !findMp4Box(file, start, end, "mvhd") || !file.seek(start))
+        return 0;
+    auto mvhd = file.read(32);
+    if (mvhd.size() < 20)
+        return 0;
+    auto bytes = reinterpret_cast<const uchar*>(mvhd.constData());
+    quint64 timescale;
+    quint64 duration;
+    if (bytes[0] == 1)
+    {
+        if (mvhd.size() < 32)
+            return 0;
+        timescale = qFromBigEndian<quint32>(bytes + 20);
+        duration = qFromBigEndian<quint64>(bytes + 24);
+    }
+    else
+    {
+        timescale = qFromBigEndian<quint32>(bytes + 12);
+        duration = qFromBigEndian<quint32>(bytes + 16);
+        if (duration == 0xFFFFFFFF)
+            return 0;
+    }
+    if (timescale == 0)
+        return 0;
+    return clampToInt(static_cast<qint64>(duration / timescale * 1000 + duration % timescale * 1000 / timescale));
+}
+
+int DurationProbe::mkvDuration(QFile &file)
+{
+    qint64 id;
+    qint64 size;
+    if (!readEbmlVint(file, true, id) || id != EBML_HEADER_ID || !readEbmlVint(file, false, size) || size < 0 ||
+            !file.seek(file.pos() + size))
+        return 0;
+    if (!readEbmlVint(file, true, id) || id != EBML_SEGMENT_ID || !readEbmlVint(file, false, size))
+        return 0;
+    qint64 segmentEnd = size < 0 ? file.size() : std::min(file.pos() + size, file.size());
+
+    // The segment info comes before the first cluster, usually right after the seek head
+    while (file.pos() < segmentEnd)
+    {
+        if (!readEbmlVint(file, true, id) || !readEbmlVint(file, false, size) || size < 0 || id == EBML_CLUSTER_ID)
+            return 0;
+        if (id != EBML_INFO_ID)
+        {
+            if (!file.seek(file.pos() + size))
+                return 0;
+            continue;
+        }
+        qint64 infoEnd = file.pos() + size;
+        quint64 timecodeScale = 1000000;
+        double duration = 0.0;
+        while (file.pos() < infoEnd)
+        {
+            if (!readEbmlVint(file, true, id) || !readEbmlVint(file, false, size) || size < 0)
+                return 0;
+            if (id == EBML_TIMECODE_SCALE_ID && size <= 8)
+            {
+                auto data = file.read(size);
+                timecodeScale = 0;
+                for (auto byte : data)
+                    timecodeScale = (timecodeScale << 8) | static_cast<uchar>(byte);
+            }
+            else if (id == EBML_DURATION_ID && (size == 4 || size == 8))
+            {
+                auto data = file.read(size);
+                if (data.size() != size)
+                    return 0;
+                if (size == 4)
+                {
+                    auto bits = qFromBigEndian<quint32>(data.constData());
+                    float value;
+                    memcpy(&value, &bits, sizeof(value));
+                    duration = value;
+                }
+                else
+                {
+                    auto bits = qFromBigEndian<quint64>(data.constData());
+                    memcpy(&duration, &bits, sizeof(duration));
+                }
+            }
+            else if (!file.seek(file.pos() + size))
+            {
+                return 0;
+            }
+        }
+        return clampToInt(static_cast<qint64>(duration * static_cast<double>(timecodeScale) / 1000000.0));
+    }
+    return 0;
+}
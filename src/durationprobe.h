@@ -0,0 +1,29 @@
+#ifndef DURATIONPROBE_H
+#define DURATIONPROBE_H
+
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief Reads the duration of a media file straight from its headers, without decoding anything.
+ *
+ * CDG durations come from the packet count, MP3 from the Xing/Info or VBRI header or the bitrate of the first frame,
+ * MP4/MOV from the movie header and MKV/WebM from the segment info. Anything else, or a file whose headers don't
+ * give a duration, yields 0 and needs a full discovery instead.
+ */
+class DurationProbe
+{
+public:
+    /**
+     * @return Duration in ms, 0 if the headers of the file can't tell.
+     */
+    static int fromHeaders(const QString &path);
+
+private:
+    static int cdgDuration(const QFile &file);
+    static int mp3Duration(QFile &file);
+    static int mp4Duration(QFile &file);
+    static int mkvDuration(QFile &file);
+};
+
+#endif // DURATIONPROBE_H
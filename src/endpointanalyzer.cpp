@@ -0,0 +1,163 @@
+#include "endpointanalyzer.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSqlQuery>
+#include <algorithm>
+#include "cdg/cdgfilereader.h"
+#include "gstreamer/audioanalysis.h"
+#include "mzarchive.h"
+#include "okjutil.h"
+
+EndPointAnalyzerWorker::EndPointAnalyzerWorker()
+{
+    m_logger = spdlog::get("logger");
+}
+
+void EndPointAnalyzerWorker::analyze(const QStringList &files)
+{
+    if (files.isEmpty())
+        return;
+    m_logger->info("{} Starting analysis of {} songs", m_loggingPrefix, files.size());
+    QElapsedTimer timer;
+    timer.start();
+    int analyzed{0};
+    for (const auto &path : files)
+    {
+        if (!waitWhilePaused())
+            break;
+        QByteArray cdgData;
+        QByteArray audioData;
+        QString audioPath;
+        if (path.endsWith(".zip", Qt::CaseInsensitive))
+        {
+            MzArchive archive(path);
+            if (archive.checkCDG() && archive.checkAudio())
+            {
+                cdgData = archive.readCdgData();
+                audioData = archive.readAudioData();
+            }
+        }
+        else
+        {
+            audioPath = findMatchingAudioFile(path);
+            QFile cdgFile(path);
+            if (cdgFile.open(QIODevice::ReadOnly))
+                cdgData = cdgFile.readAll();
+        }
+
+        AudioAnalysis::Result audio;
+        int cdgEnd{0};
+        if (!cdgData.isEmpty() && (!audioData.isEmpty() || !audioPath.isEmpty()))
+        {
+            audio = AudioAnalysis::analyze(audioPath, audioData, AudioAnalysis::AudioEnd | AudioAnalysis::ReplayGain, [] () {
+                return QThread::currentThread()->isInterruptionRequested();
+            });
+            cdgEnd = std::max(CdgFileReader(cdgData).positionOfFinalFrameMS(), 0);
+        }
+        const int audioEnd = audio.audioEndMs;
+        if (QThread::currentThread()->isInterruptionRequested())
+        {
+            m_logger->info("{} Analysis interrupt requested", m_loggingPrefix);
+            break;
+        }
+        if (audio.stalled)
+        {
+            // Left without end points, the next analysis run tries again
+            m_logger->warn("{} Decoding stalled, skipping file for now: {}", m_loggingPrefix, path);
+            continue;
+        }
+        if (audioEnd == 0)
+            m_logger->warn("{} Unable to find end point for file {}. - File is likely corrupted or invalid", m_loggingPrefix, path);
+        else
+            m_logger->trace("{} Audio ends at {}ms, cdg at {}ms, gain {}dB, peak {} for file: {}", m_loggingPrefix, audioEnd,
+                            cdgEnd, audio.gain, audio.peak, path);
+        emit analyzed(path, audioEnd, cdgEnd, audio.gain, audio.peak);
+        analyzed++;
+    }
+    m_logger->info("{} Analysis complete, {} songs in {}s", m_loggingPrefix, analyzed, timer.elapsed() / 1000);
+}
+
+bool EndPointAnalyzerWorker::waitWhilePaused()
+{
+    while (m_paused)
+    {
+        if (QThread::currentThread()->isInterruptionRequested())
+            return false;
+        QThread::msleep(500);
+    }
+    return !QThread::currentThread()->isInterruptionRequested();
+}
+
+EndPointAnalyzerController::EndPointAnalyzerController(QObject *parent) : QObject(parent)
+{
+    m_logger = spdlog::get("logger");
+    m_worker = new EndPointAnalyzerWorker;
+    workerThread.setObjectName("EndPointAnalyzer");
+    m_worker->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(this, &EndPointAnalyzerController::operate, m_worker, &EndPointAnalyzerWorker::analyze);
+    connect(m_worker, &EndPointAnalyzerWorker::analyzed, this, &EndPointAnalyzerController::updateDbEndPoints);
+    workerThread.start();
+    workerThread.setPriority(QThread::IdlePriority);
+}
+
+EndPointAnalyzerController::~EndPointAnalyzerController()
+{
+    workerThread.requestInterruption();
+    workerThread.quit();
+    workerThread.wait();
+}
+
+void EndPointAnalyzerController::stopWork()
+{
+    workerThread.requestInterruption();
+}
+
+void EndPointAnalyzerController::setPaused(bool paused)
+{
+    m_worker->setPaused(paused);
+}
+
+int EndPointAnalyzerController::endPoint(const QString &path)
+{
+    QSqlQuery query;
+    query.prepare("SELECT audioend, cdgend FROM dbsongs WHERE path = :path");
+    query.bindValue(":path", path);
+    if (!query.exec() || !query.first() || query.value(0).toInt() <= 0)
+        return 0;
+    return std::max(query.value(0).toInt(), query.value(1).toInt());
+}
+
+void EndPointAnalyzerController::analyzeSongs()
+{
+    m_logger->info("{} Finding songs without end points", m_loggingPrefix);
+    QStringList files;
+    QSqlQuery query;
+    query.exec("SELECT path, filesize, filemtime FROM dbsongs WHERE audioend IS NULL AND (path LIKE '%.zip' OR path LIKE '%.cdg') ORDER BY artist, title");
+    m_fileStamps.clear();
+    while (query.next())
+    {
+        files.append(query.value(0).toString());
+        m_fileStamps.insert(files.last(), {query.value(1), query.value(2)});
+    }
+    m_logger->info("{} Done, found {} songs without end points", m_loggingPrefix, files.size());
+    emit operate(files);
+}
+
+void EndPointAnalyzerController::updateDbEndPoints(const QString &path, int audioEndMs, int cdgEndMs, double gain, double peak)
+{
+    // A song imported again while it was being decoded has different stamps now and gets analyzed again next time
+    const auto stamps = m_fileStamps.take(path);
+    QSqlQuery query;
+    query.prepare("UPDATE dbsongs SET audioend = :audioend, cdgend = :cdgend, rggain = :gain, rgpeak = :peak "
+                  "WHERE path = :path AND filesize IS :filesize AND filemtime IS :filemtime");
+    query.bindValue(":path", path);
+    query.bindValue(":audioend", audioEndMs);
+    query.bindValue(":cdgend", cdgEndMs);
+    query.bindValue(":gain", gain);
+    query.bindValue(":peak", peak);
+    query.bindValue(":filesize", stamps.first);
+    query.bindValue(":filemtime", stamps.second);
+    query.exec();
+}
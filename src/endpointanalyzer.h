@@ -0,0 +1,78 @@
+#ifndef ENDPOINTANALYZER_H
+#define ENDPOINTANALYZER_H
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QThread>
+#include <QVariant>
+#include <atomic>
+#include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
+#include <spdlog/fmt/ostr.h>
+
+std::ostream& operator<<(std::ostream& os, const QString& s);
+
+/**
+ * @brief Decodes karaoke songs to find where they actually end.
+ *
+ * The audio end is where the trailing silence starts, the cdg end is the time of the last frame that changes the
+ * image. Both are in ms, 0 if the song couldn't be decoded. The ReplayGain gain and peak are measured in the same
+ * pass, LoudnessScanner leaves these songs alone.
+ */
+class EndPointAnalyzerWorker : public QObject
+{
+    Q_OBJECT
+    std::atomic<bool> m_paused{false};
+    std::string m_loggingPrefix{"[EndPointAnalyzerThread]"};
+    std::shared_ptr<spdlog::logger> m_logger;
+
+    bool waitWhilePaused();
+
+public:
+    EndPointAnalyzerWorker();
+    // Thread safe, songs already being decoded are finished first
+    void setPaused(bool paused) { m_paused = paused; }
+
+public slots:
+    void analyze(const QStringList &files);
+signals:
+    void analyzed(const QString &path, int audioEndMs, int cdgEndMs, double gain, double peak);
+};
+
+/**
+ * @brief Runs the EndPointAnalyzerWorker over every CDG song in dbsongs that hasn't been analyzed yet, in an idle
+ * priority thread, and stores the results in the audioend, cdgend, rggain and rgpeak columns.
+ */
+class EndPointAnalyzerController : public QObject
+{
+    Q_OBJECT
+    QThread workerThread;
+    EndPointAnalyzerWorker *m_worker;
+    std::string m_loggingPrefix{"[EndPointAnalyzerController]"};
+    std::shared_ptr<spdlog::logger> m_logger;
+    // filesize and filemtime of the songs handed to the worker, results for a file replaced since are dropped
+    QHash<QString, QPair<QVariant, QVariant>> m_fileStamps;
+
+public:
+    explicit EndPointAnalyzerController(QObject *parent = nullptr);
+    ~EndPointAnalyzerController() override;
+    void stopWork();
+    /**
+     * @brief Hold off on decoding while the machine has better things to do, like playing a song.
+     */
+    void setPaused(bool paused);
+
+    /**
+     * @brief Position the song is known to end at, the later of its audio and cdg end, 0 if not analyzed.
+     */
+    static int endPoint(const QString &path);
+
+public slots:
+    void analyzeSongs();
+    void updateDbEndPoints(const QString &path, int audioEndMs, int cdgEndMs, double gain, double peak);
+signals:
+    void operate(const QStringList &files);
+};
+
+#endif // ENDPOINTANALYZER_H
@@ -0,0 +1,165 @@
+#define GLIB_DISABLE_DEPRECATION_WARNINGS
+#include "audioanalysis.h"
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QUrl>
+#include <cmath>
+#include <gst/gst.h>
+#include <spdlog/spdlog.h>
+#include "bufferappsrc.h"
+
+namespace {
+
+// Same level MediaBackend::isSilent() considers silent
+constexpr double SILENCE_RMS_THRESHOLD = 0.001;
+// Give up on a file if the decoded position doesn't move for this long
+constexpr qint64 DECODE_STALL_TIMEOUT_MS = 30000;
+// playbin's GST_PLAY_FLAG_AUDIO, the flags enum isn't part of the public headers
+constexpr guint PLAY_FLAG_AUDIO = 1 << 1;
+
+void sourceSetup_cb([[maybe_unused]] GstElement *element, GstElement *source, gpointer audioData)
+{
+    if (GST_IS_APP_SRC(source))
+        BufferAppSrc::attach(GST_APP_SRC(source), *reinterpret_cast<QByteArray*>(audioData));
+}
+
+}
+
+AudioAnalysis::Result AudioAnalysis::analyze(const QString &path, const QByteArray &audioData, Measurements measurements,
+                                             const std::function<bool()> &cancelled)
+{
+    const std::string loggingPrefix{"[AudioAnalysis]"};
+    auto logger = spdlog::get("logger");
+    if (!gst_is_initialized())
+        gst_init(nullptr, nullptr);
+
+    // level reports the loudness of every 100ms of audio, rganalysis posts the gain and peak once it saw the end
+    QStringList elements{"audioconvert"};
+    if (measurements.testFlag(AudioEnd))
+        elements.append("level interval=100000000");
+    if (measurements.testFlag(ReplayGain))
+        elements.append({"audioresample", "rganalysis name=rganalysis"});
+    elements.append("fakesink sync=false");
+
+    auto pipeline = gst_element_factory_make("playbin", nullptr);
+    auto audioSink = gst_parse_bin_from_description(elements.join(" ! ").toUtf8().constData(), true, nullptr);
+    if (!pipeline || !audioSink)
+    {
+        logger->error("{} Unable to create analysis pipeline", loggingPrefix);
+        if (pipeline)
+            gst_object_unref(pipeline);
+        return {};
+    }
+    auto rgAnalysis = gst_bin_get_by_name(GST_BIN(audioSink), "rganalysis");
+    g_object_set(pipeline, "audio-sink", audioSink, "flags", PLAY_FLAG_AUDIO, nullptr);
+    if (!audioData.isEmpty())
+    {
+        g_signal_connect(pipeline, "source-setup", G_CALLBACK(sourceSetup_cb), const_cast<QByteArray*>(&audioData));
+        g_object_set(pipeline, "uri", "appsrc://", nullptr);
+    }
+    else
+    {
+        g_object_set(pipeline, "uri", QUrl::fromLocalFile(path).toEncoded().constData(), nullptr);
+    }
+
+    auto bus = gst_element_get_bus(pipeline);
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+
+    Result result;
+    GstClockTime audioEnd{0};
+    bool done{false};
+    bool failed{false};
+    // Without level nothing is posted on the bus until the end, progress is measured by the decoded position instead
+    gint64 lastPosition{-1};
+    QElapsedTimer stallTimer;
+    stallTimer.start();
+    while (!done && !failed)
+    {
+        if (cancelled())
+        {
+            failed = true;
+            break;
+        }
+        if (gint64 position; gst_element_query_position(pipeline, GST_FORMAT_TIME, &position) && position > lastPosition)
+        {
+            lastPosition = position;
+            stallTimer.restart();
+        }
+        else if (stallTimer.elapsed() > DECODE_STALL_TIMEOUT_MS)
+        {
+            logger->debug("{} Decoding stalled, giving up on {}", loggingPrefix, path.toStdString());
+            result.stalled = true;
+            failed = true;
+            break;
+        }
+        auto msg = gst_bus_timed_pop_filtered(bus, 100 * GST_MSECOND,
+                                              static_cast<GstMessageType>(GST_MESSAGE_ELEMENT | GST_MESSAGE_TAG | GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (!msg)
+            continue;
+        switch (GST_MESSAGE_TYPE(msg))
+        {
+            case GST_MESSAGE_EOS:
+                done = true;
+                break;
+            case GST_MESSAGE_ERROR:
+            {
+                GError *err;
+                gst_message_parse_error(msg, &err, nullptr);
+                logger->debug("{} [GStreamer] {}", loggingPrefix, err->message);
+                g_error_free(err);
+                failed = true;
+                break;
+            }
+            case GST_MESSAGE_ELEMENT:
+            {
+                auto msgStructure = gst_message_get_structure(msg);
+                if (std::string(gst_structure_get_name(msgStructure)) != "level")
+                    break;
+                GstClockTime streamTime, duration;
+                if (!gst_structure_get_clock_time(msgStructure, "stream-time", &streamTime) ||
+                        !gst_structure_get_clock_time(msgStructure, "duration", &duration))
+                    break;
+                auto rms_arr = reinterpret_cast<GValueArray*>(g_value_get_boxed(gst_structure_get_value(msgStructure, "rms")));
+                if (rms_arr->n_values == 0)
+                    break;
+                double rmsValues = 0.0;
+                for (unsigned int i{0}; i < rms_arr->n_values; ++i)
+                    rmsValues += pow(10, g_value_get_double(g_value_array_get_nth(rms_arr, i)) / 20);
+                if (rmsValues / rms_arr->n_values > SILENCE_RMS_THRESHOLD)
+                    audioEnd = streamTime + duration;
+                break;
+            }
+            case GST_MESSAGE_TAG:
+            {
+                // The file's own tags are posted too, only the ones from the analyzer count
+                if (!rgAnalysis || GST_MESSAGE_SRC(msg) != GST_OBJECT_CAST(rgAnalysis))
+                    break;
+                GstTagList *tags;
+                gst_message_parse_tag(msg, &tags);
+                gdouble gain, peak;
+                if (gst_tag_list_get_double(tags, GST_TAG_TRACK_GAIN, &gain) && gst_tag_list_get_double(tags, GST_TAG_TRACK_PEAK, &peak))
+                {
+                    result.gain = gain;
+                    result.peak = peak;
+                }
+                gst_tag_list_unref(tags);
+                break;
+            }
+            default:
+                break;
+        }
+        gst_message_unref(msg);
+    }
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    if (rgAnalysis)
+        gst_object_unref(rgAnalysis);
+    gst_object_unref(bus);
+    gst_object_unref(pipeline);
+    if (failed)
+        return { false, result.stalled };
+    result.decoded = true;
+    result.audioEndMs = static_cast<int>(audioEnd / GST_MSECOND);
+    return result;
+}
@@ -0,0 +1,48 @@
+#ifndef AUDIOANALYSIS_H
+#define AUDIOANALYSIS_H
+
+#include <QByteArray>
+#include <QFlags>
+#include <QString>
+#include <functional>
+
+/**
+ * @brief Decodes the audio of a song as fast as possible and measures it on the way.
+ *
+ * Used by the background analyzers, so a song that needs several measurements is decoded only once.
+ */
+class AudioAnalysis
+{
+public:
+    enum Measurement {
+        // Where the trailing silence starts
+        AudioEnd = 0x1,
+        // ReplayGain track gain and peak
+        ReplayGain = 0x2
+    };
+    Q_DECLARE_FLAGS(Measurements, Measurement)
+
+    struct Result {
+        // The whole file was decoded, the measurements are meaningless otherwise
+        bool decoded{false};
+        // Decoding stopped making progress, unlike a decode error this may well work out another time
+        bool stalled{false};
+        int audioEndMs{0};
+        // dB to apply to reach the ReplayGain reference level
+        double gain{0.0};
+        // Highest sample amplitude, 1.0 is full scale, 0 if not measured
+        double peak{0.0};
+    };
+
+    /**
+     * @param path Audio file to decode, ignored if audioData is set
+     * @param audioData Encoded audio, e.g. read from a zip
+     * @param cancelled Polled while decoding, gives up on the file once it returns true
+     */
+    static Result analyze(const QString &path, const QByteArray &audioData, Measurements measurements,
+                          const std::function<bool()> &cancelled);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(AudioAnalysis::Measurements)
+
+#endif // AUDIOANALYSIS_H
@@ -0,0 +1,75 @@
+#include "bufferappsrc.h"
+
+#include <algorithm>
+#include <utility>
+
+constexpr guint DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+BufferAppSrc::BufferAppSrc(QByteArray data) :
+    m_data(std::move(data))
+{
+}
+
+void BufferAppSrc::attach(GstAppSrc *appsrc, const QByteArray &data)
+{
+    auto instance = new BufferAppSrc(data);
+
+    g_object_set(appsrc,
+                 "stream-type", GST_APP_STREAM_TYPE_RANDOM_ACCESS,
+                 "format", GST_FORMAT_BYTES,
+                 "size", static_cast<gint64>(data.size()),
+                 NULL);
+
+    GstAppSrcCallbacks callbacks {};
+    callbacks.need_data = &BufferAppSrc::cb_need_data;
+    callbacks.seek_data = &BufferAppSrc::cb_seek_data;
+    gst_app_src_set_callbacks(appsrc, &callbacks, instance, &BufferAppSrc::cb_destroy);
+}
+
+void BufferAppSrc::cb_need_data(GstAppSrc *appsrc, guint length, gpointer user_data)
+{
+    auto instance = reinterpret_cast<BufferAppSrc *>(user_data);
+    auto size = static_cast<guint64>(instance->m_data.size());
+    auto offset = instance->m_offset.load();
+
+    if (offset >= size)
+    {
+        gst_app_src_end_of_stream(appsrc);
+        return;
+    }
+
+    if (length == 0 || length == G_MAXUINT)
+        length = DEFAULT_BLOCK_SIZE;
+    auto blockSize = std::min<guint64>(length, size - offset);
+
+    // The buffer keeps a shallow copy of the QByteArray alive until GStreamer is done with it.
+    auto dataRef = new QByteArray(instance->m_data);
+    auto buffer = gst_buffer_new_wrapped_full(
+                GST_MEMORY_FLAG_READONLY,
+                const_cast<char*>(dataRef->constData()),
+                dataRef->size(),
+                offset,
+                blockSize,
+                dataRef,
+                [] (gpointer ref) { delete reinterpret_cast<QByteArray*>(ref); }
+                );
+    GST_BUFFER_OFFSET(buffer) = offset;
+    GST_BUFFER_OFFSET_END(buffer) = offset + blockSize;
+    instance->m_offset = offset + blockSize;
+
+    gst_app_src_push_buffer(appsrc, buffer);
+}
+
+gboolean BufferAppSrc::cb_seek_data([[maybe_unused]]GstAppSrc *appsrc, guint64 offset, gpointer user_data)
+{
+    auto instance = reinterpret_cast<BufferAppSrc *>(user_data);
+    if (offset > static_cast<guint64>(instance->m_data.size()))
+        return false;
+    instance->m_offset = offset;
+    return true;
+}
+
+void BufferAppSrc::cb_destroy(gpointer user_data)
+{
+    delete reinterpret_cast<BufferAppSrc *>(user_data);
+}
@@ -0,0 +1,36 @@
+#ifndef BUFFERAPPSRC_H
+#define BUFFERAPPSRC_H
+
+#include <QByteArray>
+#include <gst/app/gstappsrc.h>
+#include <atomic>
+
+/**
+ * Feeds an in-memory media file (e.g. an mp3 decompressed from a zip) to a GStreamer appsrc in
+ * random access mode, so decodebin can typefind, demux and seek it as if it was read from disk.
+ * Buffers wrap the QByteArray data directly, no copies are made.
+ */
+class BufferAppSrc
+{
+
+private:
+    QByteArray m_data;
+    std::atomic<guint64> m_offset { 0 };
+
+    explicit BufferAppSrc(QByteArray data);
+
+    // AppSrc callbacks
+    static void cb_need_data(GstAppSrc *appsrc, guint length, gpointer user_data);
+    static gboolean cb_seek_data(GstAppSrc *appsrc, guint64 offset, gpointer user_data);
+    static void cb_destroy(gpointer user_data);
+
+public:
+    /**
+     * @brief Configure appsrc to serve data. Intended to be called from uridecodebin's "source-setup" signal
+     * when playing the "appsrc://" uri.
+     * @note The feeder is owned by the appsrc element and released together with it.
+     */
+    static void attach(GstAppSrc *appsrc, const QByteArray &data);
+};
+
+#endif // BUFFERAPPSRC_H
@@ -0,0 +1,143 @@
+#include "gstbuswatcher.h"
+
+#include <cmath>
+#include <utility>
+
+GstBusWatcher::GstBusWatcher(GstBus *bus, GstElement *pipeline, std::string loggingPrefix) :
+    m_bus(reinterpret_cast<GstBus*>(gst_object_ref(bus))),
+    m_pipeline(GST_OBJECT_CAST(pipeline)),
+    m_context(g_main_context_new()),
+    m_loop(g_main_loop_new(m_context, false)),
+    m_loggingPrefix(std::move(loggingPrefix))
+{
+    m_logger = spdlog::get("logger");
+    qRegisterMetaType<GstState>();
+    setObjectName("GstBusWatcher");
+
+    auto source = gst_bus_create_watch(m_bus);
+    g_source_set_callback(source, reinterpret_cast<GSourceFunc>(&GstBusWatcher::busCallback), this, nullptr);
+    g_source_attach(source, m_context);
+    g_source_unref(source);
+}
+
+GstBusWatcher::~GstBusWatcher()
+{
+    stop();
+    g_main_loop_unref(m_loop);
+    g_main_context_unref(m_context);
+    gst_object_unref(m_bus);
+}
+
+void GstBusWatcher::stop()
+{
+    if (!isRunning())
+        return;
+    // A quit before the thread got to g_main_loop_run() would be lost, the loop runs this as soon as it starts
+    g_main_context_invoke(m_context, [] (gpointer loop) -> gboolean {
+        g_main_loop_quit(static_cast<GMainLoop*>(loop));
+        return G_SOURCE_REMOVE;
+    }, m_loop);
+    wait();
+}
+
+void GstBusWatcher::run()
+{
+    m_logger->debug("{} Bus watch thread started", m_loggingPrefix);
+    g_main_context_push_thread_default(m_context);
+    g_main_loop_run(m_loop);
+    g_main_context_pop_thread_default(m_context);
+    m_logger->debug("{} Bus watch thread stopped", m_loggingPrefix);
+}
+
+gboolean GstBusWatcher::busCallback([[maybe_unused]] GstBus *bus, GstMessage *message, gpointer user_data)
+{
+    reinterpret_cast<GstBusWatcher*>(user_data)->handleMessage(message);
+    return G_SOURCE_CONTINUE;
+}
+
+void GstBusWatcher::handleMessage(GstMessage *message)
+{
+    const quint64 generation = m_generation;
+    switch (GST_MESSAGE_TYPE(message))
+    {
+        case GST_MESSAGE_ERROR:
+        {
+            GError *err;
+            gchar *debug;
+            gst_message_parse_error(message, &err, &debug);
+            emit error(QString(err->message), QString(debug), generation);
+            g_error_free(err);
+            g_free(debug);
+            break;
+        }
+        case GST_MESSAGE_WARNING:
+        {
+            GError *err;
+            gchar *debug;
+            gst_message_parse_warning(message, &err, &debug);
+            emit warning(QString(err->message), QString(debug));
+            g_error_free(err);
+            g_free(debug);
+            break;
+        }
+        case GST_MESSAGE_STATE_CHANGED:
+        {
+            // This will fire for all elements in the pipeline.
+            // We only want to react once: on the actual pipeline element.
+            if (message->src != m_pipeline)
+                break;
+            GstState oldState, state, pending;
+            gst_message_parse_state_changed(message, &oldState, &state, &pending);
+            // we are only interested in final states
+            if (pending != GST_STATE_VOID_PENDING || oldState == state)
+                break;
+            emit stateChanged(oldState, state, generation);
+            break;
+        }
+        case GST_MESSAGE_EOS:
+            if (message->src == m_pipeline)
+                emit endOfStream(g_get_monotonic_time(), generation);
+            break;
+        case GST_MESSAGE_ELEMENT:
+        {
+            auto msgStructure = gst_message_get_structure(message);
+            if (std::string(gst_structure_get_name(msgStructure)) != "level")
+                break;
+            auto array_val = gst_structure_get_value(msgStructure, "rms");
+            auto rms_arr = reinterpret_cast<GValueArray*>(g_value_get_boxed (array_val));
+            if (rms_arr->n_values == 0)
+                break;
+            double rmsValues = 0.0;
+            for (unsigned int i{0}; i < rms_arr->n_values; ++i)
+            {
+                auto value = g_value_array_get_nth (rms_arr, i);
+                auto rms_dB = g_value_get_double (value);
+                rmsValues += pow (10, rms_dB / 20);
+            }
+            emit levelChanged(rmsValues / rms_arr->n_values);
+            break;
+        }
+        case GST_MESSAGE_DURATION_CHANGED:
+            emit durationChanged(generation);
+            break;
+        case GST_MESSAGE_ASYNC_DONE:
+            emit asyncDone(generation);
+            break;
+        case GST_MESSAGE_STREAM_START:
+            m_logger->debug("{} GStreamer reported stream started", m_loggingPrefix);
+        case GST_MESSAGE_NEED_CONTEXT:
+        case GST_MESSAGE_TAG:
+        case GST_MESSAGE_STREAM_STATUS:
+        case GST_MESSAGE_LATENCY:
+        case GST_MESSAGE_NEW_CLOCK:
+            break;
+
+        default:
+            m_logger->debug("{} Unhandled GStreamer message received - element: {} - type: {} - name: {}",
+                          m_loggingPrefix,
+                          message->src->name,
+                          gst_message_type_get_name(message->type),
+                          message->type);
+            break;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef GSTBUSWATCHER_H
+#define GSTBUSWATCHER_H
+
+#include <QThread>
+#include <QString>
+#include <gst/gst.h>
+#include <spdlog/spdlog.h>
+#include <atomic>
+
+Q_DECLARE_METATYPE(GstState)
+
+/**
+ * Watches a pipeline bus from a dedicated thread running its own GMainContext, so messages are handled
+ * as soon as they are posted instead of whenever the GUI thread gets around to polling the bus.
+ *
+ * Messages are parsed on the watcher thread and delivered as typed signals. Receivers on other threads
+ * get them queued, in the order they were posted. Only messages from the pipeline element itself are
+ * reported for state changes and end of stream.
+ *
+ * Queued signals outlive the bus flush of a pipeline going to NULL, so the media related ones carry the generation
+ * they were picked up in. Bump it with newGeneration() whenever the pipeline is stopped or gets new media, and drop
+ * whatever arrives with a generation isCurrent() rejects.
+ */
+class GstBusWatcher : public QThread
+{
+Q_OBJECT
+
+private:
+    GstBus *m_bus;
+    GstObject *m_pipeline;
+    GMainContext *m_context;
+    GMainLoop *m_loop;
+    std::string m_loggingPrefix;
+    std::shared_ptr<spdlog::logger> m_logger;
+    std::atomic<quint64> m_generation{0};
+
+    void run() override;
+    void handleMessage(GstMessage *message);
+    static gboolean busCallback(GstBus *bus, GstMessage *message, gpointer user_data);
+
+public:
+    GstBusWatcher(GstBus *bus, GstElement *pipeline, std::string loggingPrefix);
+    ~GstBusWatcher() override;
+
+    /**
+     * @brief Stops watching and waits for the thread to exit, messages still on the bus are left there.
+     */
+    void stop();
+
+    /**
+     * @brief Starts a new generation, signals sent for messages picked up before this are stale from now on.
+     */
+    void newGeneration() { m_generation++; }
+    [[nodiscard]] bool isCurrent(quint64 generation) const { return generation == m_generation; }
+
+signals:
+    void error(const QString &message, const QString &debug, quint64 generation);
+    void warning(const QString &message, const QString &debug);
+    // Final pipeline states only, transitions still pending are not reported
+    void stateChanged(GstState oldState, GstState newState, quint64 generation);
+    // receivedUs is the g_get_monotonic_time() the message was picked up from the bus at
+    void endOfStream(qint64 receivedUs, quint64 generation);
+    void durationChanged(quint64 generation);
+    // A state change or flushing seek completed
+    void asyncDone(quint64 generation);
+    // Average RMS over all channels as reported by a level element, several times a second, so best connected directly
+    void levelChanged(double rms);
+};
+
+#endif // GSTBUSWATCHER_H
@@ -55,6 +55,15 @@ PadInfo getPadInfo(GstElement *element, GstPad *pad)
     return result;
 }
 
+GstPad* gsthlp_request_pad(GstElement *element, const gchar *templateName)
+{
+#if GST_CHECK_VERSION(1,20,0)
+    return gst_element_request_pad_simple(element, templateName);
+#else
+    return gst_element_get_request_pad(element, templateName);
+#endif
+}
+
 void iterater_set_ts_offset (const GValue *item, gpointer p_offset)
 {
     gint64 offset = *(gint64*)p_offset;
@@ -20,6 +20,8 @@ void gsthlp_bin_try_remove(GstBin *bin, std::vector<GstElement *> elements);
 
 PadInfo getPadInfo(GstElement *element, GstPad *pad);
 
+GstPad* gsthlp_request_pad(GstElement *element, const gchar *templateName);
+
 void set_sink_ts_offset(GstBin *bin, gint64 offset);
 
 void optimize_scaleTempo_for_rate(GstElement *scaleTempo, double playBackRate);
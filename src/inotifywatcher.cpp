@@ -0,0 +1,235 @@
+#include "inotifywatcher.h"
+
+#ifdef Q_OS_LINUX
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "directorylistingcache.h"
+
+namespace {
+
+// Files are journaled once they are complete, a file that is still being copied in only shows up as created
+constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+QString childPath(const QString &dirPath, const QString &name)
+{
+    return dirPath.endsWith('/') ? dirPath + name : dirPath + '/' + name;
+}
+
+}
+
+InotifyWatcher::InotifyWatcher()
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+        qWarning() << "Unable to initialize inotify:" << qt_error_string(errno);
+}
+
+InotifyWatcher::~InotifyWatcher()
+{
+    m_notifier.reset();
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+bool InotifyWatcher::watchTrees(const QStringList &rootPaths)
+{
+    for (const auto &rootPath : rootPaths)
+        addTree(QDir(rootPath).absolutePath(), false);
+    return !m_watchLimitReached;
+}
+
+void InotifyWatcher::start(const std::function<void()> &onChange, const std::function<void()> &onOverflow)
+{
+    m_onChange = onChange;
+    m_onOverflow = onOverflow;
+    m_notifier = std::make_unique<QSocketNotifier>(m_fd, QSocketNotifier::Read);
+    QObject::connect(m_notifier.get(), &QSocketNotifier::activated, [this] () { readEvents(); });
+    // Events that came in while the watches were being added are already waiting
+    readEvents();
+}
+
+QVector<DbUpdater::FileChange> InotifyWatcher::takeJournal()
+{
+    QVector<DbUpdater::FileChange> journal;
+    journal.swap(m_journal);
+    return journal;
+}
+
+// Watches a directory and everything below it. Directories that show up while watching need their files journaled,
+// anything put in them before their watch was added would be missed otherwise.
+void InotifyWatcher::addTree(const QString &rootPath, bool journalFiles)
+{
+    QStringList pendingDirs { rootPath };
+    while (!pendingDirs.isEmpty())
+    {
+        const QString dirPath = pendingDirs.takeLast();
+        if (!m_watchLimitReached)
+        {
+            int wd = inotify_add_watch(m_fd, QFile::encodeName(dirPath).constData(), WATCH_MASK);
+            if (wd >= 0)
+            {
+                m_watchPaths.insert(wd, dirPath);
+                m_watchDescriptors.insert(dirPath, wd);
+            }
+            else if (errno == ENOSPC)
+            {
+                qWarning() << "inotify watch limit reached at" << dirPath << "- raise fs.inotify.max_user_watches to watch the whole library";
+                m_watchLimitReached = true;
+                if (!journalFiles)
+                    return;
+            }
+        }
+        const auto listing = DirectoryListingCache::listDirectory(dirPath);
+        if (journalFiles)
+        {
+            for (const auto &fileName : listing.files)
+                m_journal.append({DbUpdater::FileChange::Added, false, childPath(dirPath, fileName), {}});
+        }
+        for (const auto &subdir : listing.subdirs)
+            pendingDirs.append(childPath(dirPath, subdir));
+    }
+}
+
+void InotifyWatcher::removeTree(const QString &rootPath)
+{
+    const QString prefix = rootPath + '/';
+    for (auto it = m_watchDescriptors.begin(); it != m_watchDescriptors.end();)
+    {
+        if (it.key() != rootPath && !it.key().startsWith(prefix))
+        {
+            ++it;
+            continue;
+        }
+        inotify_rm_watch(m_fd, it.value());
+        m_watchPaths.remove(it.value());
+        it = m_watchDescriptors.erase(it);
+    }
+}
+
+// Watches stay on a directory that is renamed, only the paths they stand for change
+void InotifyWatcher::renameTree(const QString &oldPath, const QString &newPath)
+{
+    const QString prefix = oldPath + '/';
+    QHash<QString, int> renamed;
+    for (auto it = m_watchDescriptors.begin(); it != m_watchDescriptors.end();)
+    {
+        if (it.key() != oldPath && !it.key().startsWith(prefix))
+        {
+            ++it;
+            continue;
+        }
+        QString path = newPath + it.key().mid(oldPath.length());
+        m_watchPaths.insert(it.value(), path);
+        renamed.insert(path, it.value());
+        it = m_watchDescriptors.erase(it);
+    }
+    m_watchDescriptors.insert(renamed);
+}
+
+// Files moved out of the watched trees are removals, journaled where the move happened so that a file put in their
+// place afterwards isn't removed along with them
+void InotifyWatcher::journalUnpairedMoves()
+{
+    for (const auto &move : qAsConst(m_pendingMoves))
+    {
+        m_journal.append(move);
+        if (move.isDir)
+            removeTree(move.path);
+    }
+    m_pendingMoves.clear();
+}
+
+void InotifyWatcher::readEvents()
+{
+    alignas(inotify_event) char buffer[64 * 1024];
+    const int journalSize = m_journal.size();
+    bool overflowed{false};
+    ssize_t length;
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *ptr = buffer; ptr < buffer + length;)
+        {
+            const auto event = reinterpret_cast<const inotify_event *>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            if (!(event->mask & IN_MOVED_TO) || !m_pendingMoves.contains(event->cookie))
+                journalUnpairedMoves();
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                overflowed = true;
+                continue;
+            }
+            auto watch = m_watchPaths.constFind(event->wd);
+            if (watch == m_watchPaths.cend())
+                continue;
+            if (event->mask & IN_IGNORED)
+            {
+                // The directory is gone, or its watch was removed
+                if (m_watchDescriptors.value(*watch, -1) == event->wd)
+                    m_watchDescriptors.remove(*watch);
+                m_watchPaths.erase(watch);
+                continue;
+            }
+            if (event->len == 0)
+                continue;
+            const QString name = QFile::decodeName(event->name);
+            // Hidden entries aren't part of the library, the scanner skips them too
+            if (name.startsWith('.'))
+                continue;
+            const QString path = childPath(*watch, name);
+            const bool isDir = event->mask & IN_ISDIR;
+
+            if (event->mask & IN_MOVED_FROM)
+            {
+                m_pendingMoves.insert(event->cookie, {DbUpdater::FileChange::Removed, isDir, path, {}});
+            }
+            else if (event->mask & IN_MOVED_TO)
+            {
+                if (m_pendingMoves.contains(event->cookie))
+                {
+                    auto from = m_pendingMoves.take(event->cookie);
+                    m_journal.append({DbUpdater::FileChange::Moved, isDir, from.path, path});
+                    if (isDir)
+                        renameTree(from.path, path);
+                }
+                else if (isDir)
+                {
+                    addTree(path, true);
+                }
+                else
+                {
+                    m_journal.append({DbUpdater::FileChange::Added, false, path, {}});
+                }
+            }
+            else if (event->mask & IN_CREATE)
+            {
+                // Symlinks are never written to, they're complete as soon as they're created
+                if (isDir)
+                    addTree(path, true);
+                else if (QFileInfo(path).isSymLink())
+                    m_journal.append({DbUpdater::FileChange::Added, false, path, {}});
+            }
+            else if (event->mask & IN_CLOSE_WRITE)
+            {
+                m_journal.append({DbUpdater::FileChange::Added, false, path, {}});
+            }
+            else if (event->mask & IN_DELETE)
+            {
+                m_journal.append({DbUpdater::FileChange::Removed, isDir, path, {}});
+            }
+        }
+    }
+    // Both halves of a rename are queued by the same syscall, a move without its other half by now never gets one
+    journalUnpairedMoves();
+    if (overflowed && m_onOverflow)
+        m_onOverflow();
+    if (m_journal.size() != journalSize && m_onChange)
+        m_onChange();
+}
+
+#endif // Q_OS_LINUX
@@ -0,0 +1,71 @@
+#ifndef INOTIFYWATCHER_H
+#define INOTIFYWATCHER_H
+
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+
+#include <QHash>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "dbupdater.h"
+
+/**
+ * @brief Watches directory trees through inotify and journals what happens to the files in them.
+ *
+ * inotify has no recursive watches, so every directory still takes a watch of its own, but unlike QFileSystemWatcher
+ * its events name the file that changed. A file is journaled as added once it is closed after writing or moved in, and
+ * as removed once it is deleted or moved out. A rename within the watched trees is journaled as a move of the file or
+ * directory, the two halves of it are paired up by their cookie.
+ */
+class InotifyWatcher
+{
+public:
+    InotifyWatcher();
+    ~InotifyWatcher();
+
+    bool isValid() const { return m_fd >= 0; }
+    /**
+     * @brief Adds a watch to every directory of the trees, may be called from another thread before start().
+     *
+     * @return false if the inotify watch limit was reached, some of the directories are unwatched then
+     */
+    bool watchTrees(const QStringList &rootPaths);
+    /**
+     * @brief Starts reading events on the calling thread.
+     *
+     * @param onChange Called whenever the journal grows
+     * @param onOverflow Called when the kernel dropped events, the journal is incomplete from then on
+     */
+    void start(const std::function<void()> &onChange, const std::function<void()> &onOverflow);
+    /**
+     * @brief Takes the journal so far.
+     */
+    QVector<DbUpdater::FileChange> takeJournal();
+
+private:
+    int m_fd{-1};
+    bool m_watchLimitReached{false};
+    QHash<int, QString> m_watchPaths;
+    QHash<QString, int> m_watchDescriptors;
+    // IN_MOVED_FROM events waiting for their IN_MOVED_TO, by cookie. The kernel queues the two halves of a rename
+    // back to back, a move still waiting when any other event is read went out of the watched trees.
+    QHash<quint32, DbUpdater::FileChange> m_pendingMoves;
+    QVector<DbUpdater::FileChange> m_journal;
+    std::unique_ptr<QSocketNotifier> m_notifier;
+    std::function<void()> m_onChange;
+    std::function<void()> m_onOverflow;
+
+    void addTree(const QString &rootPath, bool journalFiles);
+    void removeTree(const QString &rootPath);
+    void renameTree(const QString &oldPath, const QString &newPath);
+    void journalUnpairedMoves();
+    void readEvents();
+};
+
+#endif // Q_OS_LINUX
+
+#endif // INOTIFYWATCHER_H
@@ -2,7 +2,7 @@
 #include <QRegularExpression>
 #include <QTemporaryDir>
 #include "tagreader.h"
-#include "okarchive.h"
+#include "mzarchive.h"
 #include <QSqlQuery>
 
 KaraokeFileInfo::KaraokeFileInfo(QObject *parent, std::shared_ptr<KaraokeFilePatternResolver> patternResolver) : QObject(parent), m_patternResolver(patternResolver) {
@@ -43,13 +43,30 @@ void KaraokeFileInfo::readTags()
     }
     else if (m_filename.endsWith(".zip", Qt::CaseInsensitive))
     {
-        OkArchive archive;
-        QTemporaryDir dir;
-        archive.setArchiveFile(m_filename);
+        MzArchive archive(m_filename);
         archive.checkAudio();
-        QString audioFile = "temp" + archive.audioExtension();
-        archive.extractAudio(dir.path(), audioFile);
-        tagReader->setMedia(dir.path() + QDir::separator() + audioFile);
+        if (archive.audioExtension() == ".mp3" && archive.canReadAudio())
+        {
+            // Only the ID3v2 tag at the start of the mp3 gets inflated. Getting to the ID3v1 tag at the end means
+            // inflating the whole entry, that only happens when the ID3v2 tag is missing or has no artist or title.
+            // taglib merges the two like it does for a file, fields the ID3v2 tag leaves empty come from ID3v1.
+            const QByteArray id3v2Tag = archive.readAudioId3v2Tag();
+            if (!id3v2Tag.isEmpty())
+                tagReader->taglibTags(id3v2Tag);
+            if (tagReader->getArtist().isEmpty() || tagReader->getTitle().isEmpty())
+            {
+                const QByteArray id3v1Tag = archive.readAudioId3v1Tag();
+                if (!id3v1Tag.isEmpty())
+                    tagReader->taglibTags(id3v2Tag + id3v1Tag);
+            }
+        }
+        else
+        {
+            QTemporaryDir dir;
+            QString audioFile = "temp" + archive.audioExtension();
+            archive.extractAudio(dir.path(), audioFile);
+            tagReader->setMedia(dir.path() + QDir::separator() + audioFile);
+        }
         tagArtist = tagReader->getArtist();
         tagTitle = tagReader->getTitle();
         tagSongid = tagReader->getAlbum();
@@ -126,8 +143,7 @@ const int& KaraokeFileInfo::getDuration()
         return duration;
     if (m_filename.endsWith(".zip", Qt::CaseInsensitive))
     {
-        OkArchive archive;
-        archive.setArchiveFile(m_filename);
+        MzArchive archive(m_filename);
         duration = archive.getSongDuration();
     }
     else if (m_filename.endsWith(".cdg", Qt::CaseInsensitive))
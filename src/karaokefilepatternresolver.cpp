@@ -40,11 +40,16 @@ void KaraokeFilePatternResolver::InitializeData()
     m_initialized = true;
 }
 
-const KaraokeFilePatternResolver::KaraokeFilePattern& KaraokeFilePatternResolver::getPattern(const QString &filename)
+void KaraokeFilePatternResolver::initialize()
 {
     if (!m_initialized) {
         InitializeData();
     }
+}
+
+const KaraokeFilePatternResolver::KaraokeFilePattern& KaraokeFilePatternResolver::getPattern(const QString &filename)
+{
+    initialize();
 
     // The map is ordered by paths.
     // Enumerate backwards so '/media/abc' is matched before '/media/a' in the case of filename '/media/abc/somefile.zip'
@@ -19,6 +19,10 @@ public:
 
     const KaraokeFilePattern& getPattern(const QString &filename);
 
+    // Loads the source dir patterns from the database up front. Call this on the database
+    // thread before sharing the resolver with worker threads; lookups are read-only afterwards.
+    void initialize();
+
     static const KaraokeFilePattern& getDefaultPattern();
 
 private:
@@ -0,0 +1,244 @@
+#include "karaokesongcatalog.h"
+#include <algorithm>
+#include <cstddef>
+
+void KaraokeSongCatalog::clear()
+{
+    m_records.clear();
+    m_records.shrink_to_fit();
+    m_text.clear();
+    m_text.shrink_to_fit();
+    m_interned.clear();
+    m_rowById.clear();
+    m_pathHashes.clear();
+    m_sortedPathHashes = 0;
+}
+
+void KaraokeSongCatalog::reserve(size_t rows)
+{
+    m_records.reserve(rows);
+    m_pathHashes.reserve(rows);
+    // Title, song id and filename are what is usually left after interning and deriving the rest
+    m_text.reserve(rows * 80);
+}
+
+KaraokeSongCatalog::Row KaraokeSongCatalog::append(const okj::KaraokeSong &song)
+{
+    auto row = static_cast<Row>(m_records.size());
+    Record record;
+    record.id = song.id;
+    record.artist = intern(song.artist);
+    record.title = store(song.title);
+    record.songId = store(song.songid);
+    record.filename = store(song.filename);
+    record.duration = song.duration;
+    record.plays = song.plays;
+    record.lastPlay = song.lastPlay.isValid() ? song.lastPlay.toMSecsSinceEpoch() : 0;
+    if (song.bad)
+        record.flags |= FlagBad;
+    if (song.dropped)
+        record.flags |= FlagDropped;
+
+    QString leaf = song.path;
+    if (int slash = song.path.lastIndexOf('/'); slash >= 0)
+    {
+        record.flags |= FlagHasDir;
+        record.dir = intern(song.path.left(slash));
+        leaf = song.path.mid(slash + 1);
+    }
+    if (!song.filename.isEmpty() && leaf.startsWith(song.filename))
+    {
+        record.flags |= FlagLeafAfterFilename;
+        record.leaf = intern(leaf.mid(song.filename.size()));
+    }
+    else
+        record.leaf = store(leaf);
+
+    if (song.searchString == deriveSearchString(song.filename, song.artist, song.title, song.songid))
+        record.flags |= FlagDerivedSearch;
+    else
+        record.searchString = store(song.searchString);
+
+    m_records.push_back(record);
+    if (song.id >= 0)
+    {
+        if (static_cast<size_t>(song.id) >= m_rowById.size())
+            m_rowById.resize(song.id + 1, InvalidRow);
+        m_rowById[song.id] = row;
+    }
+    m_pathHashes.emplace_back(qHash(song.path), row);
+    return row;
+}
+
+KaraokeSongCatalog::Row KaraokeSongCatalog::rowForId(int songId) const
+{
+    if (songId < 0 || static_cast<size_t>(songId) >= m_rowById.size())
+        return InvalidRow;
+    return m_rowById[songId];
+}
+
+KaraokeSongCatalog::Row KaraokeSongCatalog::rowForPath(const QString &path) const
+{
+    mergePathHashes();
+    auto hash = qHash(path);
+    auto range = std::equal_range(m_pathHashes.begin(), m_pathHashes.end(), std::pair<uint, Row>{hash, 0},
+                                  [](const auto &a, const auto &b) { return a.first < b.first; });
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (this->path(it->second) == path)
+            return it->second;
+    }
+    return InvalidRow;
+}
+
+void KaraokeSongCatalog::mergePathHashes() const
+{
+    if (m_sortedPathHashes == m_pathHashes.size())
+        return;
+    auto sortedEnd = m_pathHashes.begin() + static_cast<std::ptrdiff_t>(m_sortedPathHashes);
+    std::sort(sortedEnd, m_pathHashes.end());
+    std::inplace_merge(m_pathHashes.begin(), sortedEnd, m_pathHashes.end());
+    m_sortedPathHashes = m_pathHashes.size();
+}
+
+okj::KaraokeSong KaraokeSongCatalog::song(Row row) const
+{
+    auto artist = this->artist(row);
+    auto title = this->title(row);
+    auto songId = this->songId(row);
+    return okj::KaraokeSong{
+            id(row),
+            artist,
+            artist.toLower(),
+            title,
+            title.toLower(),
+            songId,
+            songId.toLower(),
+            duration(row),
+            filename(row),
+            path(row),
+            searchString(row),
+            plays(row),
+            lastPlay(row),
+            isBad(row),
+            isDropped(row)
+    };
+}
+
+QString KaraokeSongCatalog::path(Row row) const
+{
+    const auto &record = m_records[row];
+    QString path;
+    if (record.flags & FlagHasDir)
+        path = text(record.dir) + '/';
+    if (record.flags & FlagLeafAfterFilename)
+        path += text(record.filename);
+    path += text(record.leaf);
+    return path;
+}
+
+QString KaraokeSongCatalog::searchString(Row row) const
+{
+    const auto &record = m_records[row];
+    if (record.flags & FlagDerivedSearch)
+        return deriveSearchString(filename(row), artist(row), title(row), songId(row));
+    return text(record.searchString);
+}
+
+QDateTime KaraokeSongCatalog::lastPlay(Row row) const
+{
+    if (m_records[row].lastPlay == 0)
+        return {};
+    return QDateTime::fromMSecsSinceEpoch(m_records[row].lastPlay);
+}
+
+int KaraokeSongCatalog::compare(Row a, Row b, TextField field) const
+{
+    return this->field(a, field).compare(this->field(b, field), Qt::CaseInsensitive);
+}
+
+bool KaraokeSongCatalog::pathEndsWith(Row row, const QString &suffix) const
+{
+    const auto &record = m_records[row];
+    QStringView end = view(record.leaf);
+    if (end.size() < suffix.size() && (record.flags & FlagLeafAfterFilename))
+        return path(row).endsWith(suffix, Qt::CaseInsensitive);
+    return end.endsWith(suffix, Qt::CaseInsensitive);
+}
+
+void KaraokeSongCatalog::recordPlay(Row row, const QDateTime &timestamp)
+{
+    m_records[row].plays++;
+    m_records[row].lastPlay = timestamp.toMSecsSinceEpoch();
+}
+
+void KaraokeSongCatalog::remove(Row row)
+{
+    auto &record = m_records[row];
+    if (record.flags & FlagRemoved)
+        return;
+    record.flags |= FlagRemoved;
+    if (rowForId(record.id) == row)
+        m_rowById[record.id] = InvalidRow;
+    auto isRow = [row](const auto &entry) { return entry.second == row; };
+    // Removing keeps the order, the sorted part only gets shorter
+    m_sortedPathHashes -= std::count_if(m_pathHashes.begin(), m_pathHashes.begin() + static_cast<std::ptrdiff_t>(m_sortedPathHashes), isRow);
+    m_pathHashes.erase(std::remove_if(m_pathHashes.begin(), m_pathHashes.end(), isRow), m_pathHashes.end());
+}
+
+KaraokeSongCatalog::TextRef KaraokeSongCatalog::store(const QString &str)
+{
+    TextRef ref{static_cast<quint32>(m_text.size()), static_cast<quint32>(str.size())};
+    m_text.insert(m_text.end(), str.constBegin(), str.constEnd());
+    return ref;
+}
+
+KaraokeSongCatalog::TextRef KaraokeSongCatalog::intern(const QString &str)
+{
+    auto hash = qHash(str);
+    for (auto it = m_interned.constFind(hash); it != m_interned.constEnd() && it.key() == hash; ++it)
+    {
+        if (view(it.value()).compare(str) == 0)
+            return it.value();
+    }
+    auto ref = store(str);
+    m_interned.insert(hash, ref);
+    return ref;
+}
+
+QStringView KaraokeSongCatalog::view(const TextRef &ref) const
+{
+    if (ref.size == 0)
+        return {};
+    return {m_text.data() + ref.offset, static_cast<qsizetype>(ref.size)};
+}
+
+QString KaraokeSongCatalog::text(const TextRef &ref) const
+{
+    if (ref.size == 0)
+        return {};
+    return {m_text.data() + ref.offset, static_cast<int>(ref.size)};
+}
+
+QStringView KaraokeSongCatalog::field(Row row, TextField field) const
+{
+    const auto &record = m_records[row];
+    switch (field)
+    {
+    case Artist:
+        return view(record.artist);
+    case Title:
+        return view(record.title);
+    case SongId:
+        return view(record.songId);
+    case Filename:
+        return view(record.filename);
+    }
+    return {};
+}
+
+QString KaraokeSongCatalog::deriveSearchString(const QString &filename, const QString &artist, const QString &title, const QString &songId)
+{
+    // Same text DbUpdater stores in dbsongs.searchstring, as loaded by TableModelKaraokeSongs
+    return QString(filename + " " + artist + " " + title + " " + songId).replace('&', " and ").toLower();
+}
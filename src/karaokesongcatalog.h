@@ -0,0 +1,126 @@
+#ifndef KARAOKESONGCATALOG_H
+#define KARAOKESONGCATALOG_H
+
+#include <QDateTime>
+#include <QMultiHash>
+#include <QString>
+#include <QStringView>
+#include <limits>
+#include <vector>
+#include "okjtypes.h"
+
+/**
+ * @brief Compact in-memory copy of the dbSongs table.
+ *
+ * All text lives in one UTF-16 arena and rows are fixed size records holding offsets into it.
+ * Artists, directories and file extensions are interned since they repeat across many songs, and
+ * nothing is stored twice just to have a lowercase copy, comparisons are done case insensitively instead.
+ * The search string is only stored when it differs from the one DbUpdater derives from the other fields.
+ *
+ * Rows are never moved or reused, removing a song only flags it, so a row number stays valid as a handle.
+ * QStrings are only created when a field is asked for.
+ */
+class KaraokeSongCatalog
+{
+public:
+    using Row = quint32;
+    static constexpr Row InvalidRow = std::numeric_limits<Row>::max();
+
+    enum TextField {
+        Artist,
+        Title,
+        SongId,
+        Filename
+    };
+
+    void clear();
+    void reserve(size_t rows);
+
+    /**
+     * @brief Append a song, the searchString is expected to be lowercase already.
+     */
+    Row append(const okj::KaraokeSong &song);
+
+    [[nodiscard]] size_t size() const { return m_records.size(); }
+    [[nodiscard]] size_t textSize() const { return m_text.size(); }
+    [[nodiscard]] Row rowForId(int songId) const;
+    [[nodiscard]] Row rowForPath(const QString &path) const;
+
+    [[nodiscard]] okj::KaraokeSong song(Row row) const;
+    [[nodiscard]] int id(Row row) const { return m_records[row].id; }
+    [[nodiscard]] QString artist(Row row) const { return text(m_records[row].artist); }
+    [[nodiscard]] QString title(Row row) const { return text(m_records[row].title); }
+    [[nodiscard]] QString songId(Row row) const { return text(m_records[row].songId); }
+    [[nodiscard]] QString filename(Row row) const { return text(m_records[row].filename); }
+    [[nodiscard]] QString path(Row row) const;
+    [[nodiscard]] QString searchString(Row row) const;
+    [[nodiscard]] int duration(Row row) const { return m_records[row].duration; }
+    [[nodiscard]] int plays(Row row) const { return m_records[row].plays; }
+    [[nodiscard]] QDateTime lastPlay(Row row) const;
+    [[nodiscard]] bool isBad(Row row) const { return m_records[row].flags & FlagBad; }
+    [[nodiscard]] bool isDropped(Row row) const { return m_records[row].flags & FlagDropped; }
+    [[nodiscard]] bool isRemoved(Row row) const { return m_records[row].flags & FlagRemoved; }
+
+    /**
+     * @brief Case insensitive comparison of a text field without copying it out of the arena.
+     */
+    [[nodiscard]] int compare(Row a, Row b, TextField field) const;
+    [[nodiscard]] bool pathEndsWith(Row row, const QString &suffix) const;
+
+    void setDuration(Row row, int duration) { m_records[row].duration = duration; }
+    void recordPlay(Row row, const QDateTime &timestamp);
+    void setBad(Row row) { m_records[row].flags |= FlagBad; }
+    void remove(Row row);
+
+private:
+    struct TextRef {
+        quint32 offset{0};
+        quint32 size{0};
+    };
+
+    enum Flags : quint8 {
+        FlagBad = 0x01,
+        FlagDropped = 0x02,
+        FlagRemoved = 0x04,
+        // searchString is filename + artist + title + songid, not stored
+        FlagDerivedSearch = 0x08,
+        // leaf only holds what follows the filename in the path, usually the extension
+        FlagLeafAfterFilename = 0x10,
+        FlagHasDir = 0x20
+    };
+
+    struct Record {
+        int id{0};
+        TextRef artist;
+        TextRef title;
+        TextRef songId;
+        TextRef filename;
+        TextRef dir;
+        TextRef leaf;
+        TextRef searchString;
+        int duration{0};
+        int plays{0};
+        qint64 lastPlay{0};
+        quint8 flags{0};
+    };
+
+    std::vector<Record> m_records;
+    std::vector<QChar> m_text;
+    QMultiHash<uint, TextRef> m_interned;
+    std::vector<Row> m_rowById;
+    // (qHash(path), row). The first m_sortedPathHashes are sorted, rows appended since then are merged in by the
+    // next lookup, so a bulk load is sorted once and a single append only costs a merge.
+    mutable std::vector<std::pair<uint, Row>> m_pathHashes;
+    mutable size_t m_sortedPathHashes{0};
+
+    void mergePathHashes() const;
+
+    TextRef store(const QString &str);
+    TextRef intern(const QString &str);
+    [[nodiscard]] QStringView view(const TextRef &ref) const;
+    [[nodiscard]] QString text(const TextRef &ref) const;
+    [[nodiscard]] QStringView field(Row row, TextField field) const;
+    static QString deriveSearchString(const QString &filename, const QString &artist, const QString &title, const QString &songId);
+};
+
+#endif // KARAOKESONGCATALOG_H
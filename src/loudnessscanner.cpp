@@ -0,0 +1,144 @@
+#include "loudnessscanner.h"
+
+#include <QSqlQuery>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include "mzarchive.h"
+#include "okjutil.h"
+
+LoudnessScanner::LoudnessScanner(QObject *parent) : QObject(parent)
+{
+    m_logger = spdlog::get("logger");
+    // Decoding is cpu bound, leave half the cores to playback and the GUI
+    m_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() / 2));
+    connect(this, &LoudnessScanner::scanned, this, &LoudnessScanner::updateDb);
+}
+
+LoudnessScanner::~LoudnessScanner()
+{
+    stopWork();
+    m_pool.waitForDone();
+}
+
+void LoudnessScanner::scanSongs()
+{
+    m_logger->info("{} Finding songs without loudness measurements", m_loggingPrefix);
+    QStringList files;
+    QSqlQuery query;
+    // Same condition EndPointAnalyzerController::analyzeSongs() picks its songs by, those get their gain from it
+    query.exec("SELECT path, filesize, filemtime FROM dbsongs WHERE rgpeak IS NULL "
+               "AND NOT (audioend IS NULL AND (path LIKE '%.zip' OR path LIKE '%.cdg')) ORDER BY artist, title");
+    m_fileStamps.clear();
+    while (query.next())
+    {
+        files.append(query.value(0).toString());
+        m_fileStamps.insert(files.last(), {query.value(1), query.value(2)});
+    }
+    m_logger->info("{} Done, found {} songs without loudness measurements", m_loggingPrefix, files.size());
+    if (files.isEmpty())
+        return;
+
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_queue = files;
+    }
+    m_stop = false;
+    m_scanned = 0;
+    // Workers still busy with a previous queue carry on with this one, the extra ones exit when they find it empty
+    for (int i = 0; i < m_pool.maxThreadCount(); i++)
+        QtConcurrent::run(&m_pool, [this] () { scanQueue(); });
+}
+
+void LoudnessScanner::stopWork()
+{
+    m_stop = true;
+    QMutexLocker locker(&m_queueMutex);
+    m_queue.clear();
+}
+
+LoudnessScanner::ReplayGain LoudnessScanner::replayGain(const QString &path)
+{
+    QSqlQuery query;
+    query.prepare("SELECT rggain, rgpeak FROM dbsongs WHERE path = :path");
+    query.bindValue(":path", path);
+    if (!query.exec() || !query.first() || query.value(1).toDouble() <= 0.0)
+        return {};
+    return { query.value(0).toDouble(), query.value(1).toDouble() };
+}
+
+void LoudnessScanner::scanQueue()
+{
+    QThread::currentThread()->setPriority(QThread::IdlePriority);
+    QString path;
+    while (nextFile(path))
+    {
+        auto replayGain = scanFile(path);
+        if (m_stop)
+            break;
+        if (replayGain.stalled)
+        {
+            // Left unmeasured, the next scan tries again
+            m_logger->warn("{} Decoding stalled, skipping file for now: {}", m_loggingPrefix, path);
+            continue;
+        }
+        if (replayGain.peak <= 0.0)
+            m_logger->warn("{} Unable to measure loudness of file {}. - File is likely corrupted or invalid", m_loggingPrefix, path);
+        else
+            m_logger->trace("{} Gain {}dB, peak {} for file: {}", m_loggingPrefix, replayGain.gain, replayGain.peak, path);
+        emit scanned(path, replayGain.gain, replayGain.peak);
+        if (auto count = ++m_scanned; count % 100 == 0)
+            m_logger->info("{} Scanned {} songs", m_loggingPrefix, count);
+    }
+}
+
+bool LoudnessScanner::nextFile(QString &path)
+{
+    while (m_paused && !m_stop)
+        QThread::msleep(500);
+    if (m_stop)
+        return false;
+    QMutexLocker locker(&m_queueMutex);
+    if (m_queue.isEmpty())
+        return false;
+    path = m_queue.takeFirst();
+    return true;
+}
+
+AudioAnalysis::Result LoudnessScanner::scanFile(const QString &path)
+{
+    QByteArray audioData;
+    QString audioPath = path;
+    if (path.endsWith(".zip", Qt::CaseInsensitive))
+    {
+        MzArchive archive(path);
+        if (!archive.checkAudio())
+            return {};
+        audioData = archive.readAudioData();
+        if (audioData.isEmpty())
+            return {};
+    }
+    else if (path.endsWith(".cdg", Qt::CaseInsensitive))
+    {
+        audioPath = findMatchingAudioFile(path);
+        if (audioPath.isEmpty())
+            return {};
+    }
+
+    return AudioAnalysis::analyze(audioPath, audioData, AudioAnalysis::ReplayGain, [this] () { return m_stop.load(); });
+}
+
+void LoudnessScanner::updateDb(const QString &path, double gain, double peak)
+{
+    // Dropped if the song was replaced on disk while it was being decoded, the next scan picks it up again
+    const auto stamps = m_fileStamps.take(path);
+    QSqlQuery query;
+    query.prepare("UPDATE dbsongs SET rggain = :gain, rgpeak = :peak "
+                  "WHERE path = :path AND filesize IS :filesize AND filemtime IS :filemtime");
+    query.bindValue(":path", path);
+    query.bindValue(":gain", gain);
+    query.bindValue(":peak", peak);
+    query.bindValue(":filesize", stamps.first);
+    query.bindValue(":filemtime", stamps.second);
+    query.exec();
+}
@@ -0,0 +1,75 @@
+#ifndef LOUDNESSSCANNER_H
+#define LOUDNESSSCANNER_H
+
+#include <QHash>
+#include <QObject>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVariant>
+#include <atomic>
+#include "gstreamer/audioanalysis.h"
+#include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
+#include <spdlog/fmt/ostr.h>
+
+std::ostream& operator<<(std::ostream& os, const QString& s);
+
+/**
+ * @brief Measures the ReplayGain track gain and peak of every karaoke song in dbsongs.
+ *
+ * Songs are decoded through rganalysis on several idle priority threads at once and the results are written to the
+ * rggain and rgpeak columns one song at a time, so a scan that is stopped picks up where it left off the next time.
+ * Songs that can't be decoded are stored with a peak of 0 and not retried, songs whose decoding stalled are retried
+ * by the next scan. CDG songs still waiting for their end
+ * points are left to EndPointAnalyzerController, which measures them in the same pass.
+ */
+class LoudnessScanner : public QObject
+{
+    Q_OBJECT
+public:
+    struct ReplayGain {
+        // dB to apply to reach the ReplayGain reference level
+        double gain{0.0};
+        // Highest sample amplitude, 1.0 is full scale, 0 if not measured
+        double peak{0.0};
+    };
+
+    explicit LoudnessScanner(QObject *parent = nullptr);
+    ~LoudnessScanner() override;
+
+    void scanSongs();
+    void stopWork();
+    /**
+     * @brief Hold off on decoding while the machine has better things to do, like playing a song.
+     */
+    void setPaused(bool paused) { m_paused = paused; }
+
+    /**
+     * @brief Measured gain and peak of a song, a zero gain and peak if it hasn't been scanned.
+     */
+    static ReplayGain replayGain(const QString &path);
+
+signals:
+    void scanned(const QString &path, double gain, double peak);
+
+private:
+    QThreadPool m_pool;
+    QMutex m_queueMutex;
+    QStringList m_queue;
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_paused{false};
+    std::atomic<int> m_scanned{0};
+    std::string m_loggingPrefix{"[LoudnessScanner]"};
+    std::shared_ptr<spdlog::logger> m_logger;
+    // filesize and filemtime of the queued songs, only used on the GUI thread
+    QHash<QString, QPair<QVariant, QVariant>> m_fileStamps;
+
+    void scanQueue();
+    bool nextFile(QString &path);
+    AudioAnalysis::Result scanFile(const QString &path);
+    void updateDb(const QString &path, double gain, double peak);
+};
+
+#endif // LOUDNESSSCANNER_H
@@ -34,6 +34,7 @@
 #include "soundfxbutton.h"
 #include "src/models/tableviewtooltipfilter.h"
 #include "dbupdater.h"
+#include "dbsongsfts.h"
 #include "okjutil.h"
 #include <algorithm>
 #include <memory>
@@ -586,6 +587,7 @@ MainWindow::MainWindow(QWidget *parent) :
     setMouseTracking(true);
     m_songShop = std::make_unique<SongShop>(this);
     m_lazyDurationUpdater = std::make_unique<LazyDurationUpdateController>(this);
+    m_endPointAnalyzer = std::make_unique<EndPointAnalyzerController>(this);
     ui->tableViewBmPlaylist->setMouseTracking(true);
     m_historyTabWidget = ui->tabWidgetQueue->widget(1);
     ui->actionShow_Debug_Log->setChecked(m_settings.logShow());
@@ -711,13 +713,17 @@ MainWindow::MainWindow(QWidget *parent) :
     updateRotationDuration();
     if (m_settings.dbLazyLoadDurations())
         m_lazyDurationUpdater->getDurations();
+    m_endPointAnalyzer->analyzeSongs();
+    m_loudnessScanner.scanSongs();
     ui->labelVolume->setPixmap(QIcon::fromTheme("player-volume").pixmap(QSize(22, 22)));
     ui->labelVolumeBm->setPixmap(QIcon::fromTheme("player-volume").pixmap(QSize(22, 22)));
     updateIcons();
 
     std::vector<QWidget *> videoWidgets{cdgWindow->getVideoDisplay(), ui->videoPreview};
-    m_mediaBackendBm.setVideoOutputWidgets({cdgWindow->getVideoDisplayBm(), ui->videoPreviewBm});
-    m_mediaBackendKar.setVideoOutputWidgets(videoWidgets);
+    // The main window preview is a thumbnail, it doesn't need the frame rate or resolution of the video window
+    const std::vector<MediaBackend::VideoOutputPolicy> videoPolicies{{}, {10, 2}};
+    m_mediaBackendBm.setVideoOutputWidgets({cdgWindow->getVideoDisplayBm(), ui->videoPreviewBm}, videoPolicies);
+    m_mediaBackendKar.setVideoOutputWidgets(videoWidgets, videoPolicies);
     m_settings.setStartupOk(true);
     m_mediaBackendBm.stop(true);
 
@@ -725,6 +731,9 @@ MainWindow::MainWindow(QWidget *parent) :
     setupShortcuts();
     setupConnections();
     m_timerSlowUiUpdate.start(10000);
+    m_timerStageNextSong.setSingleShot(true);
+    m_timerStageNextSong.setInterval(1000);
+    m_timerStageNextSong.start();
 }
 
 void MainWindow::loadSettings() {
@@ -895,6 +904,7 @@ void MainWindow::setupConnections() {
     connect(&m_mediaBackendBm, &MediaBackend::stateChanged, this, &MainWindow::bmMediaStateChanged);
     connect(&m_mediaBackendBm, &MediaBackend::positionChanged, this, &MainWindow::bmMediaPositionChanged);
     connect(&m_mediaBackendBm, &MediaBackend::durationChanged, this, &MainWindow::bmMediaDurationChanged);
+    connect(&m_mediaBackendBm, &MediaBackend::currentMediaChanged, this, &MainWindow::bmCurrentMediaChanged);
     connect(&m_mediaBackendBm, &MediaBackend::volumeChanged, ui->sliderBmVolume, &QSlider::setValue);
     connect(bmDbDialog.get(), &BmDbDialog::bmDbUpdated, this, &MainWindow::bmDbUpdated);
     connect(bmDbDialog.get(), &BmDbDialog::bmDbCleared, this, &MainWindow::bmDbCleared);
@@ -922,10 +932,18 @@ void MainWindow::setupConnections() {
     });
     connect(&m_qModel, &TableModelQueueSongs::queueModified, &m_dlgRegularSingers, &DlgRegularSingers::regularsChanged);
     connect(&m_timerSlowUiUpdate, &QTimer::timeout, this, &MainWindow::updateRotationDuration);
-    connect(&m_qModel, &TableModelQueueSongs::queueModified, [&]() {
+    connect(&m_qModel, &TableModelQueueSongs::queueSummaryChanged, &m_rotModel, &TableModelRotation::setQueueSummary);
+    connect(&m_qModel, &TableModelQueueSongs::queueModified, [&](int singerId) {
+        // Songs added to a queue that isn't loaded don't come with a summary
+        if (singerId != m_qModel.getSingerId())
+            m_rotModel.refreshQueueSummary(singerId);
         updateRotationDuration();
         m_rotModel.layoutChanged();
     });
+    // Re-resolve the staged next song once rotation or queue edits settle down
+    connect(&m_timerStageNextSong, &QTimer::timeout, this, &MainWindow::stageNextSong);
+    connect(&m_qModel, &TableModelQueueSongs::queueModified, &m_timerStageNextSong, qOverload<>(&QTimer::start));
+    connect(&m_rotModel, &TableModelRotation::rotationModified, &m_timerStageNextSong, qOverload<>(&QTimer::start));
     connect(m_lazyDurationUpdater.get(), &LazyDurationUpdateController::gotDuration, &m_karaokeSongsModel,
             &TableModelKaraokeSongs::setSongDuration);
     connect(ui->tableViewRotation->selectionModel(), &QItemSelectionModel::selectionChanged, this,
@@ -1192,6 +1210,9 @@ void MainWindow::dbInit(const QDir &okjDataDir) {
     query.exec(
             "CREATE TABLE IF NOT EXISTS bmplsongs ( plsongid INTEGER PRIMARY KEY AUTOINCREMENT, playlist INT, position INT, Artist INT, Title INT, Filename INT, Duration INT, path INT)");
     query.exec("CREATE TABLE IF NOT EXISTS bmsrcdirs ( path NOT NULL)");
+    // Rotation changes are written on their own connection while the GUI waits for them. With the write-ahead log
+    // open read cursors of other connections don't hold that write up, only other writers do.
+    query.exec("PRAGMA journal_mode=WAL");
     query.exec("PRAGMA synchronous=OFF");
     query.exec("PRAGMA cache_size=300000");
     query.exec("PRAGMA temp_store=2");
@@ -1276,11 +1297,53 @@ void MainWindow::dbInit(const QDir &okjDataDir) {
                            singersQuery.value("name").toString().toStdString());
         }
     }
+    if (schemaVersion < 107) {
+        m_logger->info("{} Updating database schema to version 107", m_loggingPrefix);
+        // Filled in by EndPointAnalyzerController, NULL until a song has been analyzed
+        query.exec("ALTER TABLE dbsongs ADD COLUMN audioend INT");
+        query.exec("ALTER TABLE dbsongs ADD COLUMN cdgend INT");
+        query.exec("PRAGMA user_version = 107");
+        m_logger->info("{} DB Schema update to v107 completed", m_loggingPrefix);
+    }
+    if (schemaVersion < 108) {
+        m_logger->info("{} Updating database schema to version 108", m_loggingPrefix);
+        // Filled in by LoudnessScanner, NULL until a song has been scanned
+        query.exec("ALTER TABLE dbsongs ADD COLUMN rggain REAL");
+        query.exec("ALTER TABLE dbsongs ADD COLUMN rgpeak REAL");
+        query.exec("PRAGMA user_version = 108");
+        m_logger->info("{} DB Schema update to v108 completed", m_loggingPrefix);
+    }
+    if (schemaVersion < 109) {
+        m_logger->info("{} Updating database schema to version 109", m_loggingPrefix);
+        // Filled in by DirectoryListingCache during library scans
+        query.exec("CREATE TABLE dirListingCache (path TEXT PRIMARY KEY, mtime INTEGER, entries INTEGER, files TEXT, subdirs TEXT)");
+        query.exec("PRAGMA user_version = 109");
+        m_logger->info("{} DB Schema update to v109 completed", m_loggingPrefix);
+    }
+    if (schemaVersion < 110) {
+        m_logger->info("{} Updating database schema to version 110", m_loggingPrefix);
+        // The full text index now drops apostrophes, it's rebuilt below if it is enabled
+        DbSongsFts::drop();
+        query.exec("PRAGMA user_version = 110");
+        m_logger->info("{} DB Schema update to v110 completed", m_loggingPrefix);
+    }
+    if (schemaVersion < 111) {
+        m_logger->info("{} Updating database schema to version 111", m_loggingPrefix);
+        // Size and mtime in ms of the file when it was imported, a file replaced at the same path has its
+        // end points and ReplayGain values cleared when it's imported again
+        query.exec("ALTER TABLE dbsongs ADD COLUMN filesize INT");
+        query.exec("ALTER TABLE dbsongs ADD COLUMN filemtime INT");
+        query.exec("PRAGMA user_version = 111");
+        m_logger->info("{} DB Schema update to v111 completed", m_loggingPrefix);
+    }
+    if (m_settings.dbFullTextSearch())
+        m_karaokeSongsModel.setFullTextSearch(DbSongsFts::create());
+    else
+        DbSongsFts::drop();
 }
 
 
 void MainWindow::play(const QString &karaokeFilePath, const bool &k2k) {
-    m_mediaTempDir = std::make_unique<QTemporaryDir>();
     if (m_mediaBackendKar.state() != MediaBackend::PausedState) {
         m_logger->info("{} Playing file: {}", m_loggingPrefix, karaokeFilePath.toStdString());
         if (m_mediaBackendKar.state() == MediaBackend::PlayingState) {
@@ -1293,31 +1356,52 @@ void MainWindow::play(const QString &karaokeFilePath, const bool &k2k) {
                 m_rotModel.singerMove(0, static_cast<int>(m_rotModel.singerCount() - 1));
             ui->spinBoxTempo->setValue(100);
         }
-        if (karaokeFilePath.endsWith(".zip", Qt::CaseInsensitive)) {
+        // Songs without ReplayGain tags get the gain measured by the loudness scanner, if it got to them yet
+        auto replayGain = LoudnessScanner::replayGain(karaokeFilePath);
+        m_mediaBackendKar.setReplayGain(replayGain.gain, replayGain.peak);
+        if (auto staged = m_nextSongStager.take(karaokeFilePath); staged.has_value()) {
+            m_logger->info("{} Playing pre-staged song from memory: {}", m_loggingPrefix, karaokeFilePath.toStdString());
+            m_mediaBackendKar.setMediaCdg(staged->cdgData, staged->audioData, karaokeFilePath, staged->cdgReader);
+            if (!k2k)
+                m_mediaBackendBm.fadeOut(!m_settings.bmKCrossFade());
+            m_mediaBackendKar.play();
+            m_mediaBackendKar.fadeInImmediate();
+        } else if (karaokeFilePath.endsWith(".zip", Qt::CaseInsensitive)) {
             MzArchive archive(karaokeFilePath);
             if ((archive.checkCDG()) && (archive.checkAudio())) {
                 if (archive.checkAudio()) {
-                    if (!archive.extractAudio(m_mediaTempDir->path(), "tmp" + archive.audioExtension())) {
-                        m_timerTest.stop();
-                        QMessageBox::warning(this, tr("Bad karaoke file"), tr("Failed to extract audio file."),
-                                             QMessageBox::Ok);
-                        return;
-                    }
-                    if (!archive.extractCdg(m_mediaTempDir->path(), "tmp.cdg")) {
-                        m_timerTest.stop();
-                        QMessageBox::warning(this, tr("Bad karaoke file"), tr("Failed to extract CDG file."),
-                                             QMessageBox::Ok);
-                        return;
+                    // Decompress straight into memory, only fall back to extracting into a temp dir
+                    // for archives that need the external infozip handling.
+                    QByteArray audioData = archive.readAudioData();
+                    QByteArray cdgData = archive.readCdgData();
+                    if (!audioData.isEmpty() && !cdgData.isEmpty()) {
+                        m_logger->info("{} Decompressed audio ({} bytes) and cdg ({} bytes) into memory", m_loggingPrefix,
+                                       audioData.size(), cdgData.size());
+                        m_mediaBackendKar.setMediaCdg(cdgData, audioData, karaokeFilePath);
+                    } else {
+                        m_mediaTempDir = std::make_unique<QTemporaryDir>();
+                        if (!archive.extractAudio(m_mediaTempDir->path(), "tmp" + archive.audioExtension())) {
+                            m_timerTest.stop();
+                            QMessageBox::warning(this, tr("Bad karaoke file"), tr("Failed to extract audio file."),
+                                                 QMessageBox::Ok);
+                            return;
+                        }
+                        if (!archive.extractCdg(m_mediaTempDir->path(), "tmp.cdg")) {
+                            m_timerTest.stop();
+                            QMessageBox::warning(this, tr("Bad karaoke file"), tr("Failed to extract CDG file."),
+                                                 QMessageBox::Ok);
+                            return;
+                        }
+                        QString audioFile = m_mediaTempDir->path() + QDir::separator() + "tmp" + archive.audioExtension();
+                        QString cdgFile = m_mediaTempDir->path() + QDir::separator() + "tmp.cdg";
+                        m_logger->info("{} Extracted audio file size: {}", m_loggingPrefix, QFileInfo(audioFile).size());
+                        m_logger->info("{} Setting karaoke backend source file to: {}", m_loggingPrefix,
+                                       audioFile.toStdString());
+                        m_mediaBackendKar.setMediaCdg(cdgFile, audioFile);
                     }
-                    QString audioFile = m_mediaTempDir->path() + QDir::separator() + "tmp" + archive.audioExtension();
-                    QString cdgFile = m_mediaTempDir->path() + QDir::separator() + "tmp.cdg";
-                    m_logger->info("{} Extracted audio file size: {}", m_loggingPrefix, QFileInfo(audioFile).size());
-                    m_logger->info("{} Setting karaoke backend source file to: {}", m_loggingPrefix,
-                                   audioFile.toStdString());
-                    m_mediaBackendKar.setMediaCdg(cdgFile, audioFile);
                     if (!k2k)
                         m_mediaBackendBm.fadeOut(!m_settings.bmKCrossFade());
-                    m_logger->info("{} Beginning playback of file: {}", m_loggingPrefix, audioFile.toStdString());
+                    m_logger->info("{} Beginning playback of file: {}", m_loggingPrefix, karaokeFilePath.toStdString());
                     QApplication::setOverrideCursor(Qt::WaitCursor);
                     m_mediaBackendKar.play();
                     QApplication::restoreOverrideCursor();
@@ -1330,8 +1414,6 @@ void MainWindow::play(const QString &karaokeFilePath, const bool &k2k) {
                 return;
             }
         } else if (karaokeFilePath.endsWith(".cdg", Qt::CaseInsensitive)) {
-            QString cdgTmpFile = "tmp.cdg";
-            QString audTmpFile = "tmp.mp3";
             QFile cdgFile(karaokeFilePath);
             if (!cdgFile.exists()) {
                 m_timerTest.stop();
@@ -1354,10 +1436,7 @@ void MainWindow::play(const QString &karaokeFilePath, const bool &k2k) {
                 QMessageBox::warning(this, tr("Bad karaoke file"), tr("Audio file contains no data"), QMessageBox::Ok);
                 return;
             }
-            cdgFile.copy(m_mediaTempDir->path() + QDir::separator() + cdgTmpFile);
-            QFile::copy(audioFilename, m_mediaTempDir->path() + QDir::separator() + audTmpFile);
-            m_mediaBackendKar.setMediaCdg(m_mediaTempDir->path() + QDir::separator() + cdgTmpFile,
-                                          m_mediaTempDir->path() + QDir::separator() + audTmpFile);
+            m_mediaBackendKar.setMediaCdg(karaokeFilePath, audioFilename);
             if (!k2k)
                 m_mediaBackendBm.fadeOut(!m_settings.bmKCrossFade());
             QApplication::setOverrideCursor(Qt::WaitCursor);
@@ -1367,16 +1446,13 @@ void MainWindow::play(const QString &karaokeFilePath, const bool &k2k) {
         } else {
             // Close CDG if open to avoid double video playback
             m_logger->info("{} Playing non-CDG video file: {}", m_loggingPrefix, karaokeFilePath.toStdString());
-            QString tmpFilePath = m_mediaTempDir->path() + QDir::separator() + "tmpvid." + karaokeFilePath.right(4);
-            QFile::copy(karaokeFilePath, tmpFilePath);
-            m_logger->info("{} Playing temporary copy to avoid bad filename stuff w/ gstreamer: {}", m_loggingPrefix,
-                           tmpFilePath.toStdString());
-            m_mediaBackendKar.setMedia(tmpFilePath);
+            m_mediaBackendKar.setMedia(karaokeFilePath);
             if (!k2k)
                 m_mediaBackendBm.fadeOut();
             m_mediaBackendKar.play();
             m_mediaBackendKar.fadeInImmediate();
         }
+        m_mediaBackendKar.setEndPoint(EndPointAnalyzerController::endPoint(karaokeFilePath));
         m_mediaBackendKar.setTempo(ui->spinBoxTempo->value());
         if (m_settings.recordingEnabled()) {
             m_logger->info("{} Starting recording", m_loggingPrefix);
@@ -1403,6 +1479,8 @@ MainWindow::~MainWindow() {
     timeEndPeriod(1);
 #endif
     m_lazyDurationUpdater->stopWork();
+    m_endPointAnalyzer->stopWork();
+    m_loudnessScanner.stopWork();
     m_settings.bmSetVolume(ui->sliderBmVolume->value());
     m_settings.setAudioVolume(ui->sliderVolume->value());
     m_logger->info("{} Saving volumes - K: {} BM {}", m_loggingPrefix, m_settings.audioVolume(), m_settings.bmVolume());
@@ -1431,6 +1509,9 @@ void MainWindow::search() {
 
 void MainWindow::databaseUpdated() {
     m_karaokeSongsModel.loadData();
+    // The update can change durations of queued songs and drops queue entries for removed files
+    m_rotModel.loadQueueSummaries();
+    m_rotModel.layoutChanged();
     search();
     autosizeViews();
     m_settings.restoreColumnWidths(ui->tableViewDB);
@@ -1441,10 +1522,16 @@ void MainWindow::databaseUpdated() {
     connect(m_lazyDurationUpdater.get(), &LazyDurationUpdateController::gotDuration, &m_karaokeSongsModel,
             &TableModelKaraokeSongs::setSongDuration);
     m_lazyDurationUpdater->getDurations();
+    m_endPointAnalyzer = std::make_unique<EndPointAnalyzerController>(this);
+    m_endPointAnalyzer->setPaused(m_mediaBackendKar.state() != MediaBackend::StoppedState);
+    m_endPointAnalyzer->analyzeSongs();
+    m_loudnessScanner.scanSongs();
 }
 
 void MainWindow::databaseCleared() {
     m_lazyDurationUpdater->stopWork();
+    m_endPointAnalyzer->stopWork();
+    m_loudnessScanner.stopWork();
     m_karaokeSongsModel.loadData();
     m_rotModel.loadData();
     m_qModel.loadSinger(-1);
@@ -1753,6 +1840,20 @@ void MainWindow::actionSettingsTriggered() {
     connect(settingsDialog, &DlgSettings::requestServerEnableChanged, ui->pushButtonIncomingRequests,
             &QPushButton::setVisible);
     connect(settingsDialog, &DlgSettings::rotationShowNextSongChanged, [&]() { autosizeRotationCols(); });
+    connect(settingsDialog, &DlgSettings::dbFullTextSearchChanged, [&](bool enabled) {
+        if (!enabled) {
+            m_karaokeSongsModel.setFullTextSearch(false);
+            DbSongsFts::drop();
+            return;
+        }
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        bool created = DbSongsFts::create();
+        QApplication::restoreOverrideCursor();
+        m_karaokeSongsModel.setFullTextSearch(created);
+        if (!created)
+            QMessageBox::warning(this, tr("Full text search unavailable"),
+                                 tr("Unable to create the full text search index, the SQLite library in use may not support FTS5.  The regular search will be used."));
+    });
     connect(settingsDialog, &DlgSettings::rotationDurationSettingsModified, this, &MainWindow::updateRotationDuration);
     connect(settingsDialog, &DlgSettings::requestServerIntervalChanged, &m_songbookApi, &OKJSongbookAPI::setInterval);
     connect(settingsDialog, &DlgSettings::shortcutsChanged, this, &MainWindow::shortcutsUpdated);
@@ -1898,8 +1999,9 @@ void MainWindow::karaokeMediaBackend_positionChanged(const qint64 &position) {
             ui->sliderProgress->setValue((int) position);
         }
         ui->labelElapsedTime->setText(MediaBackend::msToMMSS(position));
-        ui->labelRemainTime->setText(MediaBackend::msToMMSS(m_mediaBackendKar.duration() - position));
-        m_rotModel.setCurRemainSecs((int) (m_mediaBackendKar.duration() - position) / 1000);
+        auto endPosition = m_mediaBackendKar.endPosition();
+        ui->labelRemainTime->setText(MediaBackend::msToMMSS(endPosition - position));
+        m_rotModel.setCurRemainSecs((int) (endPosition - position) / 1000);
     }
 }
 
@@ -1910,6 +2012,9 @@ void MainWindow::karaokeMediaBackend_durationChanged(const qint64 &duration) {
 void MainWindow::karaokeMediaBackend_stateChanged(const MediaBackend::State &state) {
     if (m_shuttingDown)
         return;
+    // Keep the disk and cpu to the show while a song is up
+    m_endPointAnalyzer->setPaused(state == MediaBackend::PlayingState || state == MediaBackend::PausedState);
+    m_loudnessScanner.setPaused(state == MediaBackend::PlayingState || state == MediaBackend::PausedState);
     if (state == MediaBackend::StoppedState) {
         m_logger->info("{} MainWindow - audio backend state is now STOPPED", m_loggingPrefix);
         if (ui->labelTotalTime->text() == "0:00") {
@@ -2738,17 +2843,9 @@ void MainWindow::bmMediaStateChanged(const MediaBackend::State &newState) {
             }
             break;
         }
-        case MediaBackend::PlayingState: {
-            auto plSong = m_tableModelPlaylistSongs.getCurrentSong();
-            if (plSong.has_value())
-                ui->labelBmPlaying->setText(plSong->get().artist + " - " + plSong->get().title);
-            auto plNextSong = m_tableModelPlaylistSongs.getNextPlSong();
-            if (!ui->checkBoxBmBreak->isChecked() && plNextSong.has_value())
-                ui->labelBmNext->setText(plNextSong->get().artist + " - " + plNextSong->get().title);
-            else
-                ui->labelBmNext->setText("None - Breaking after current song");
+        case MediaBackend::PlayingState:
+            updateBmPlayingLabels();
             break;
-        }
         case MediaBackend::PausedState:
             break;
         case MediaBackend::UnknownState:
@@ -2762,8 +2859,33 @@ void MainWindow::bmMediaPositionChanged(const qint64 &position) {
         ui->sliderBmPosition->setValue((int) position);
     }
     ui->labelBmPosition->setText(QTime(0, 0, 0, 0).addMSecs((int) position).toString("m:ss"));
-    ui->labelBmRemaining->setText(
-            QTime(0, 0, 0, 0).addMSecs((int) (m_mediaBackendBm.duration() - position)).toString("m:ss"));
+    auto remaining = m_mediaBackendBm.duration() - position;
+    ui->labelBmRemaining->setText(QTime(0, 0, 0, 0).addMSecs((int) remaining).toString("m:ss"));
+
+    // Hand the next song to the backend a few seconds before the crossfade, so it is decoding by the time it's mixed in
+    auto crossfadeMs = m_settings.bmCrossfadeMs();
+    if (remaining > crossfadeMs + 5000) {
+        m_bmQueueRejected = false;
+        return;
+    }
+    if (m_bmQueueRejected || m_mediaBackendBm.hasQueuedNext() || ui->checkBoxBmBreak->isChecked() ||
+        m_mediaBackendBm.state() != MediaBackend::PlayingState)
+        return;
+    auto plSong = m_tableModelPlaylistSongs.getNextPlSong();
+    if (plSong.has_value() && m_mediaBackendBm.queueNext(plSong->get().path, crossfadeMs)) {
+        m_bmQueuedPosition = plSong->get().position;
+        return;
+    }
+    // Not mixable, the song is started the usual way once the current one ends
+    m_bmQueueRejected = true;
+}
+
+void MainWindow::bmCurrentMediaChanged(const QString &filename) {
+    m_logger->info("{} Break music mixed into song: {}", m_loggingPrefix, filename.toStdString());
+    m_tableModelPlaylistSongs.setCurrentPosition(m_bmQueuedPosition);
+    m_bmQueuedPosition = -1;
+    m_bmQueueRejected = false;
+    updateBmPlayingLabels();
 }
 
 void MainWindow::bmMediaDurationChanged(const qint64 &duration) {
@@ -2815,6 +2937,7 @@ void MainWindow::comboBoxBmPlaylistsIndexChanged(const int &index) {
 }
 
 void MainWindow::checkBoxBmBreakToggled(const bool &checked) {
+    m_mediaBackendBm.cancelNext();
     if (!checked) {
         auto nextSong = m_tableModelPlaylistSongs.getNextPlSong();
         if (nextSong.has_value())
@@ -3624,6 +3747,22 @@ void MainWindow::updateRotationDuration() {
     m_labelRotationDuration.setText(text);
 }
 
+void MainWindow::stageNextSong() {
+    if (m_shuttingDown)
+        return;
+    QString nextSongPath;
+    int curSingerId{m_rotModel.currentSinger()};
+    int curPos{m_rotModel.getSinger(curSingerId).position};
+    if (curSingerId == -1)
+        curPos = static_cast<int>(m_rotModel.singerCount() - 1);
+    for (size_t loops = 0; nextSongPath.isEmpty() && loops < m_rotModel.singerCount(); loops++) {
+        if (++curPos >= m_rotModel.singerCount())
+            curPos = 0;
+        nextSongPath = m_rotModel.getSingerAtPosition(curPos).nextSongPath();
+    }
+    m_nextSongStager.stage(nextSongPath);
+}
+
 void MainWindow::rotationSelectionChanged(const QItemSelection &selected, const QItemSelection &deselected) {
     if (selected.empty()) {
         m_logger->trace("{} Rotation Selection Cleared!", m_loggingPrefix);
@@ -4332,6 +4471,17 @@ void MainWindow::resetBmLabels() {
     ui->sliderBmPosition->setValue(0);
 }
 
+void MainWindow::updateBmPlayingLabels() {
+    auto plSong = m_tableModelPlaylistSongs.getCurrentSong();
+    if (plSong.has_value())
+        ui->labelBmPlaying->setText(plSong->get().artist + " - " + plSong->get().title);
+    auto plNextSong = m_tableModelPlaylistSongs.getNextPlSong();
+    if (!ui->checkBoxBmBreak->isChecked() && plNextSong.has_value())
+        ui->labelBmNext->setText(plNextSong->get().artist + " - " + plNextSong->get().title);
+    else
+        ui->labelBmNext->setText("None - Breaking after current song");
+}
+
 void MainWindow::actionBurnInEosJump() {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 10, 0))
     m_testMode = true;
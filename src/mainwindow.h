@@ -55,6 +55,9 @@
 #include "dlgsongshop.h"
 #include "songshop.h"
 #include "durationlazyupdater.h"
+#include "endpointanalyzer.h"
+#include "loudnessscanner.h"
+#include "nextsongstager.h"
 #include "dlgvideopreview.h"
 #include "src/models/tablemodelhistorysongs.h"
 #include "src/models/tablemodelplaylistsongs.h"
@@ -87,6 +90,9 @@ private:
     bool m_kNeedAutoSize{false};
     bool m_bNeedAutoSize{true};
     bool m_testMode{false};
+    // Playlist position of the break music song queued to be mixed in after the current one
+    int m_bmQueuedPosition{-1};
+    bool m_bmQueueRejected{false};
     int m_rtClickQueueSongId{-1};
     int m_rtClickRotationSingerId{-1};
     int m_curSingerOriginalPosition{0};
@@ -127,6 +133,9 @@ private:
     QTimer m_timerSlowUiUpdate;
     QTimer m_timerTest;
     QTimer m_timerButtonFlash;
+    QTimer m_timerStageNextSong;
+    NextSongStager m_nextSongStager{this};
+    LoudnessScanner m_loudnessScanner{this};
     QShortcut m_scutAddSinger{this};
     QShortcut m_scutKSelectNextSinger{this};
     QShortcut m_scutKPlayNextUnsung{this};
@@ -154,6 +163,7 @@ private:
     QShortcut m_scutDeleteSong{nullptr};
     QShortcut m_scutDeletePlSong{nullptr};
     std::unique_ptr<LazyDurationUpdateController> m_lazyDurationUpdater;
+    std::unique_ptr<EndPointAnalyzerController> m_endPointAnalyzer;
     std::unique_ptr<QTemporaryDir> m_mediaTempDir;
     std::shared_ptr<SongShop> m_songShop;
     std::unique_ptr<UpdateChecker> m_updateChecker;
@@ -166,6 +176,7 @@ private:
     void setupConnections();
     void loadSettings();
     void resetBmLabels();
+    void updateBmPlayingLabels();
     void play(const QString &karaokeFilePath, const bool &k2k = false);
     void bmAddPlaylist(const QString& title);
     bool bmPlaylistExists(const QString& name);
@@ -227,6 +238,7 @@ private slots:
     void bmMediaStateChanged(const MediaBackend::State &newState);
     void bmMediaPositionChanged(const qint64 &position);
     void bmMediaDurationChanged(const qint64 &duration);
+    void bmCurrentMediaChanged(const QString &filename);
     void tableViewBmPlaylistClicked(const QModelIndex &index);
     void tableViewBmPlaylistDoubleClicked(const QModelIndex &index);
     void tableViewBmDbDoubleClicked(const QModelIndex &index);
@@ -268,6 +280,7 @@ private slots:
     static void showAlert(const QString &title, const QString &message);
     void tableViewRotationCurrentChanged(const QModelIndex &cur, const QModelIndex &prev);
     void updateRotationDuration();
+    void stageNextSong();
     void rotationSelectionChanged(const QItemSelection &selected, const QItemSelection &deselected);
     void lineEditBmSearchChanged(const QString &arg1);
     void btnRotTopClicked();
@@ -20,6 +20,7 @@
 
 #include "mediabackend.h"
 #include <QApplication>
+#include <algorithm>
 #include <cmath>
 #include <QFile>
 #include <gst/audio/streamvolume.h>
@@ -27,18 +28,45 @@
 #include "softwarerendervideosink.h"
 #include <QDir>
 #include <QProcess>
+#include <QResizeEvent>
 #include <functional>
 #include <utility>
 #include <gst/video/videooverlay.h>
 #include <gst/gstsegment.h>
 #include "gstreamer/gstreamerhelper.h"
+#include "gstreamer/bufferappsrc.h"
 #include <spdlog/async_logger.h>
 #include <QTextStream>
+#include <QUrl>
 
 
 Q_DECLARE_SMART_POINTER_METATYPE(std::shared_ptr);
 Q_DECLARE_METATYPE(std::shared_ptr<GstMessage>);
 
+// Removes the volume ramp set on a mixer input, if any, and puts it back at full volume
+static void clearVolumeRamp(GstPad *mixerPad)
+{
+    if (auto binding = gst_object_get_control_binding(GST_OBJECT(mixerPad), "volume"))
+    {
+        gst_object_remove_control_binding(GST_OBJECT(mixerPad), binding);
+        gst_object_unref(binding);
+    }
+    g_object_set(mixerPad, "volume", 1.0, nullptr);
+}
+
+// Ramps the volume of a mixer input linearly between two points of the stream time of the file it plays
+static void setVolumeRamp(GstPad *mixerPad, GstClockTime start, gdouble startVolume, GstClockTime end, gdouble endVolume)
+{
+    clearVolumeRamp(mixerPad);
+    auto controlSource = gst_interpolation_control_source_new();
+    g_object_set(controlSource, "mode", GST_INTERPOLATION_MODE_LINEAR, nullptr);
+    gst_timed_value_control_source_set(GST_TIMED_VALUE_CONTROL_SOURCE(controlSource), start, startVolume);
+    gst_timed_value_control_source_set(GST_TIMED_VALUE_CONTROL_SOURCE(controlSource), end, endVolume);
+    gst_object_add_control_binding(GST_OBJECT(mixerPad),
+                                   gst_direct_control_binding_new_absolute(GST_OBJECT(mixerPad), "volume", controlSource));
+    gst_object_unref(controlSource);
+}
+
 MediaBackend::MediaBackend(QObject *parent, QString objectName, const MediaType type) :
     QObject(parent), m_objName(std::move(objectName)), m_type(type), m_loadPitchShift(type == Karaoke)
 {
@@ -153,12 +181,16 @@ MediaBackend::~MediaBackend()
     resetPipeline();
     m_timerSlow.stop();
     m_timerFast.stop();
-    m_gstBusMsgHandlerTimer.stop();
+    delete m_busWatcher;
     gst_object_unref(m_bus);
     gst_caps_unref(m_audioCapsMono);
     gst_caps_unref(m_audioCapsStereo);
     gst_object_unref(m_pipeline);
     gst_object_unref(m_decoder);
+    if (m_nextDecoder)
+        gst_object_unref(m_nextDecoder);
+    if (m_audioMixer)
+        gst_object_unref(m_audioMixer);
     // these still have 2 refs each for some reason
     gst_object_unref(m_audioBin);
     gst_object_unref(m_audioBin);
@@ -184,18 +216,160 @@ qint64 MediaBackend::position()
 {
     gint64 pos;
     if (gst_element_query_position(m_pipeline, GST_FORMAT_TIME, &pos))
-        return pos / GST_MSECOND;
+        return std::max(pos - m_trackStartOffset, G_GINT64_CONSTANT(0)) / GST_MSECOND;
     return 0;
 }
 
 qint64 MediaBackend::duration()
 {
     gint64 duration;
+    if (m_mixerPad)
+    {
+        // The mixer reports the longest of its inputs, ask the current file's decoder instead
+        if (gst_pad_peer_query_duration(m_mixerPad, GST_FORMAT_TIME, &duration))
+            return duration / GST_MSECOND;
+        return 0;
+    }
     if (gst_element_query_duration(m_pipeline, GST_FORMAT_TIME, &duration))
         return duration / GST_MSECOND;
     return 0;
 }
 
+void MediaBackend::setReplayGain(double gainDb, double peak)
+{
+    if (peak > 0.0)
+        gainDb = std::min(gainDb, -20.0 * std::log10(peak));
+    m_logger->debug("{} Setting fallback ReplayGain to {}dB", m_loggingPrefix, gainDb);
+    g_object_set(m_rgVolume, "fallback-gain", gainDb, nullptr);
+}
+
+qint64 MediaBackend::endPosition()
+{
+    auto dur = duration();
+    if (m_silenceDetect && m_endPointMs > 0 && m_endPointMs < dur)
+        return m_endPointMs;
+    return dur;
+}
+
+bool MediaBackend::queueNext(const QString &filename, int crossfadeMs)
+{
+    if (!m_audioMixer || !m_mixerPad || m_hasVideo || state() != PlayingState || filename == m_nextRejected)
+        return false;
+    cancelNext();
+    if (!QFile::exists(filename))
+        return false;
+
+    auto durationMs = duration();
+    if (durationMs <= 0)
+        return false;
+    auto fadeMs = std::clamp<qint64>(crossfadeMs, 0, durationMs / 2);
+    // The next file needs a moment to start decoding, don't bother if the fade is about to start already
+    if (position() + 1000 > durationMs - fadeMs)
+        return false;
+    auto fadeStart = static_cast<GstClockTime>(durationMs - fadeMs) * GST_MSECOND;
+
+    // The mixer lines its inputs up by running time, work out the one the fade starts at from the current file's segment
+    auto segmentEvent = gst_pad_get_sticky_event(m_mixerPad, GST_EVENT_SEGMENT, 0);
+    if (!segmentEvent)
+        return false;
+    const GstSegment *segment;
+    gst_event_parse_segment(segmentEvent, &segment);
+    auto startRunningTime = gst_segment_to_running_time(segment, GST_FORMAT_TIME,
+                                                        gst_segment_position_from_stream_time(segment, GST_FORMAT_TIME, fadeStart));
+    gst_event_unref(segmentEvent);
+    if (!GST_CLOCK_TIME_IS_VALID(startRunningTime))
+        return false;
+
+    m_nextFilename = filename;
+    {
+        QMutexLocker locker(&m_nextMixerLock);
+        m_crossfadeStart = startRunningTime;
+        m_crossfadeDuration = fadeMs * GST_MSECOND;
+    }
+    if (fadeMs > 0)
+        setVolumeRamp(m_mixerPad, fadeStart, 1.0, fadeStart + m_crossfadeDuration, 0.0);
+
+    // Prerolls straight away, the mixer holds on to its first buffer until the running time it starts at
+    g_object_set(m_nextDecoder, "uri", QUrl::fromLocalFile(filename).toEncoded().constData(), nullptr);
+    gst_bin_add(m_pipelineAsBin, m_nextDecoder);
+    gst_element_sync_state_with_parent(m_nextDecoder);
+    m_logger->info("{} Queued media file to start {}ms before the end of the current one: {}", m_loggingPrefix, fadeMs,
+                   filename.toStdString());
+    return true;
+}
+
+void MediaBackend::cancelNext()
+{
+    if (m_nextFilename.isEmpty())
+        return;
+    m_logger->debug("{} Dropping queued media file: {}", m_loggingPrefix, m_nextFilename.toStdString());
+    gst_element_set_state(m_nextDecoder, GST_STATE_NULL);
+    gst_bin_remove(m_pipelineAsBin, m_nextDecoder);
+    GstPad *nextMixerPad;
+    {
+        QMutexLocker locker(&m_nextMixerLock);
+        nextMixerPad = std::exchange(m_nextMixerPad, nullptr);
+        m_crossfadeStart = GST_CLOCK_TIME_NONE;
+        m_crossfadeDuration = 0;
+    }
+    if (nextMixerPad)
+    {
+        gst_element_release_request_pad(m_audioMixer, nextMixerPad);
+        gst_object_unref(nextMixerPad);
+    }
+    if (m_mixerPad)
+        clearVolumeRamp(m_mixerPad);
+    m_nextFilename.clear();
+}
+
+void MediaBackend::mixerInputEnded(GstPad *mixerPad)
+{
+    // Only the end of the current file while the next one is mixed in is a change of media, otherwise the mixer ends too
+    {
+        QMutexLocker locker(&m_nextMixerLock);
+        if (mixerPad != m_mixerPad || !m_nextMixerPad)
+            return;
+    }
+    m_logger->info("{} Current media ended, continuing with queued media file: {}", m_loggingPrefix,
+                   m_nextFilename.toStdString());
+
+    gst_element_set_state(m_decoder, GST_STATE_NULL);
+    gst_element_release_request_pad(m_audioMixer, m_mixerPad);
+    gst_object_unref(m_mixerPad);
+    gst_bin_remove(m_pipelineAsBin, m_decoder);
+    GstClockTime crossfadeStart;
+    {
+        QMutexLocker locker(&m_nextMixerLock);
+        std::swap(m_decoder, m_nextDecoder);
+        m_mixerPad = std::exchange(m_nextMixerPad, nullptr);
+        crossfadeStart = std::exchange(m_crossfadeStart, GST_CLOCK_TIME_NONE);
+        m_crossfadeDuration = 0;
+    }
+    m_filename = m_nextFilename;
+    m_nextFilename.clear();
+
+    // Positions of the new file count from where it was mixed in
+    m_trackStartOffset = 0;
+    auto mixerSrcPad = gst_element_get_static_pad(m_audioMixer, "src");
+    if (auto segmentEvent = gst_pad_get_sticky_event(mixerSrcPad, GST_EVENT_SEGMENT, 0))
+    {
+        const GstSegment *segment;
+        gst_event_parse_segment(segmentEvent, &segment);
+        auto start = gst_segment_to_stream_time(segment, GST_FORMAT_TIME,
+                                                gst_segment_position_from_running_time(segment, GST_FORMAT_TIME, crossfadeStart));
+        if (GST_CLOCK_TIME_IS_VALID(start))
+            m_trackStartOffset = static_cast<gint64>(start);
+        gst_event_unref(segmentEvent);
+    }
+    gst_object_unref(mixerSrcPad);
+    m_endPointMs = 0;
+    m_silenceDuration = 0;
+
+    anchorPosition();
+    emit currentMediaChanged(m_filename);
+    emit durationChanged(duration());
+}
+
 MediaBackend::State MediaBackend::state()
 {
     switch (m_currentState)
@@ -221,6 +395,12 @@ void MediaBackend::play()
 {
     m_logger->debug("{} Play called", m_loggingPrefix);
     m_videoOffsetMs = m_settings.videoOffsetMs();
+    if (m_endOfMediaUs > 0)
+    {
+        m_logger->debug("{} Play called {}ms after the previous media ended", m_loggingPrefix,
+                        (g_get_monotonic_time() - m_endOfMediaUs) / 1000);
+        m_endOfMediaUs = 0;
+    }
 
     if (m_currentlyFadedOut)
     {
@@ -242,7 +422,7 @@ void MediaBackend::play()
     if (m_cdgMode)
     {
         // Check if cdg file exists
-        if (!QFile::exists(m_cdgFilename))
+        if (m_cdgData.isEmpty() && !QFile::exists(m_cdgFilename))
         {
             m_logger->error("{} Missing CDG file!  Aborting playback", m_loggingPrefix);
             emit stateChanged(PlayingState);
@@ -251,28 +431,45 @@ void MediaBackend::play()
             return;
         }
 
+        // Hardware sinks smooth when scaling, hand them frames that are already upscaled so the pixel art stays sharp
         if (m_settings.cdgPrescalingEnabled() && m_settings.hardwareAccelEnabled())
-        {
-            gst_element_unlink(m_queueMainVideo, m_videoTee);
-            gst_element_link_many(m_queueMainVideo, m_prescalerVideoConvert, m_prescaler, m_prescalerCapsFilter, m_videoTee, nullptr);
-        } else {
-            gst_element_unlink_many(m_queueMainVideo, m_prescalerVideoConvert, m_prescaler, m_prescalerCapsFilter, m_videoTee, nullptr);
-            gst_element_link(m_queueMainVideo, m_videoTee);
-        }
+            m_cdgSrc->setPrescaleFactor(cdgPrescaleFactor());
+        else
+            m_cdgSrc->setPrescaleFactor(1);
 
         // Use m_cdgAppSrc as source for video. m_decoder will still be used for audio file
         gst_bin_add(reinterpret_cast<GstBin*>(m_pipeline), m_cdgSrc->getSrcElement());
         m_videoSrcPad = new PadInfo { m_cdgSrc->getSrcElement(), "src" };
         patchPipelineSinks();
         allowMissingAudio = m_type == VideoPreview;
-        m_cdgSrc->load(m_cdgFilename);
-        m_logger->info("{} Playing CDG graphics from file: {}", m_loggingPrefix, m_cdgFilename.toStdString());
-    } else {
-        gst_element_unlink_many(m_queueMainVideo, m_prescalerVideoConvert, m_prescaler, m_prescalerCapsFilter, m_videoTee, nullptr);
-        gst_element_link(m_queueMainVideo, m_videoTee);
+        if (m_cdgReader)
+        {
+            m_cdgSrc->load(std::move(m_cdgReader));
+            m_logger->info("{} Playing pre-parsed CDG graphics from memory: {}", m_loggingPrefix, m_cdgFilename.toStdString());
+        }
+        else if (!m_cdgData.isEmpty())
+        {
+            m_cdgSrc->load(m_cdgData);
+            m_logger->info("{} Playing CDG graphics from memory: {}", m_loggingPrefix, m_cdgFilename.toStdString());
+        }
+        else
+        {
+            m_cdgSrc->load(m_cdgFilename);
+            m_logger->info("{} Playing CDG graphics from file: {}", m_loggingPrefix, m_cdgFilename.toStdString());
+        }
     }
 
-    if (!QFile::exists(m_filename))
+    if (m_audioMixer)
+        gst_bin_add(m_pipelineAsBin, m_audioMixer);
+
+    if (!m_audioData.isEmpty())
+    {
+        // Served from memory by a BufferAppSrc, see sourceSetup_cb()
+        gst_bin_add(reinterpret_cast<GstBin*>(m_pipeline), m_decoder);
+        m_logger->info("{} Playing media from memory: {}", m_loggingPrefix, m_filename.toStdString());
+        g_object_set(m_decoder, "uri", "appsrc://", nullptr);
+    }
+    else if (!QFile::exists(m_filename))
     {
         if (!allowMissingAudio)
         {
@@ -287,9 +484,8 @@ void MediaBackend::play()
     {
         gst_bin_add(reinterpret_cast<GstBin*>(m_pipeline), m_decoder);
         m_logger->info("{} Playing media file: {}", m_loggingPrefix, m_filename.toStdString());
-        auto uri = gst_filename_to_uri(m_filename.toLocal8Bit(), nullptr);
-        g_object_set(m_decoder, "uri", uri, nullptr);
-        g_free(uri);
+        // QUrl percent-encodes the path as UTF-8, so files can be played in place whatever their name
+        g_object_set(m_decoder, "uri", QUrl::fromLocalFile(m_filename).toEncoded().constData(), nullptr);
     }
 
     resetVideoSinks();
@@ -303,13 +499,29 @@ void MediaBackend::resetPipeline()
 {
     // Stop pipeline
     gst_element_set_state(m_pipeline, GST_STATE_NULL);
+    m_busWatcher->newGeneration();
+    logVideoSinkStats();
+    m_anchorPosition = -1;
 
     m_hasVideo = false;
     gst_element_unlink(m_decoder, m_audioBin);
     gst_element_unlink(m_decoder, m_videoBin);
     gst_element_unlink(m_cdgSrc->getSrcElement(), m_videoBin);
 
-    gsthlp_bin_try_remove(m_pipelineAsBin, {m_cdgSrc->getSrcElement(), m_decoder, m_audioBin, m_videoBin});
+    if (m_audioMixer)
+    {
+        cancelNext();
+        if (m_mixerPad)
+        {
+            gst_element_release_request_pad(m_audioMixer, m_mixerPad);
+            gst_object_unref(m_mixerPad);
+            m_mixerPad = nullptr;
+        }
+        gst_element_unlink(m_audioMixer, m_audioBin);
+        m_trackStartOffset = 0;
+    }
+
+    gsthlp_bin_try_remove(m_pipelineAsBin, {m_cdgSrc->getSrcElement(), m_decoder, m_audioMixer, m_audioBin, m_videoBin});
 
     m_cdgSrc->reset();
 
@@ -383,6 +595,11 @@ void MediaBackend::setMedia(const QString &filename)
 {
     m_cdgMode = false;
     m_filename = filename;
+    m_endPointMs = 0;
+    m_audioData.clear();
+    m_cdgData.clear();
+    m_cdgReader.reset();
+    m_busWatcher->newGeneration();
 }
 
 void MediaBackend::setMediaCdg(const QString &cdgFilename, const QString &audioFilename)
@@ -390,6 +607,24 @@ void MediaBackend::setMediaCdg(const QString &cdgFilename, const QString &audioF
     m_cdgMode = true;
     m_filename = audioFilename;
     m_cdgFilename = cdgFilename;
+    m_endPointMs = 0;
+    m_audioData.clear();
+    m_cdgData.clear();
+    m_cdgReader.reset();
+    m_busWatcher->newGeneration();
+}
+
+void MediaBackend::setMediaCdg(const QByteArray &cdgData, const QByteArray &audioData, const QString &sourceName,
+                               std::shared_ptr<CdgFileReader> cdgReader)
+{
+    m_cdgMode = true;
+    m_filename = sourceName;
+    m_cdgFilename = sourceName;
+    m_endPointMs = 0;
+    m_audioData = audioData;
+    m_cdgData = cdgData;
+    m_cdgReader = std::move(cdgReader);
+    m_busWatcher->newGeneration();
 }
 
 void MediaBackend::setMuted(const bool &muted)
@@ -406,10 +641,25 @@ void MediaBackend::setPosition(const qint64 &position)
 {
     if (position > 1000 && position > duration() - 1000)
     {
+        m_endOfMediaUs = g_get_monotonic_time();
         emit stateChanged(EndOfMediaState);
         return;
     }
+    if (m_mixerPad)
+    {
+        // The seek reaches every mixer input, drop the queued file and let the current one start at running time 0 again
+        cancelNext();
+        if (auto decoderPad = gst_pad_get_peer(m_mixerPad))
+        {
+            gst_pad_set_offset(decoderPad, 0);
+            gst_object_unref(decoderPad);
+        }
+        m_trackStartOffset = 0;
+    }
     gst_element_send_event(m_pipeline, gst_event_new_seek(m_playbackRate, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, position * GST_MSECOND, GST_SEEK_TYPE_NONE, 0));
+    // Hold the displayed position at the target until the seek completes and the position is anchored again
+    m_anchorPosition = position * GST_MSECOND;
+    m_anchorClockTime = GST_CLOCK_TIME_NONE;
     emit positionChanged(position);
     forceVideoExpose();
 }
@@ -471,26 +721,63 @@ void MediaBackend::timerFast_timeout()
         emit positionChanged(0);
         return;
     }
+    auto mspos = interpolatedPosition();
+    if (m_lastPosition != mspos)
+    {
+        m_lastPosition = mspos;
+        emit positionChanged(mspos);
+    }
+    if (m_silenceDetect && m_endPointMs > 0 && mspos >= m_endPointMs && m_currentState == GST_STATE_PLAYING)
+    {
+        m_logger->info("{} Reached known end point at {}ms, reporting silence", m_loggingPrefix, m_endPointMs);
+        m_endPointMs = 0;
+        m_endOfMediaUs = g_get_monotonic_time();
+        emit silenceDetected();
+    }
+}
+
+qint64 MediaBackend::interpolatedPosition()
+{
+    if (m_anchorPosition < 0)
+        return 0;
+    auto pos = m_anchorPosition;
+    if (GST_CLOCK_TIME_IS_VALID(m_anchorClockTime))
+    {
+        if (auto clock = gst_element_get_clock(m_pipeline))
+        {
+            pos += static_cast<gint64>(GST_CLOCK_DIFF(m_anchorClockTime, gst_clock_get_time(clock)) * m_playbackRate);
+            gst_object_unref(clock);
+        }
+    }
+    return pos / GST_MSECOND;
+}
+
+void MediaBackend::anchorPosition()
+{
     gint64 pos;
-    if (!gst_element_query_position (m_audioBin, GST_FORMAT_TIME, &pos))
+    m_anchorClockTime = GST_CLOCK_TIME_NONE;
+    if (!gst_element_query_position(m_audioBin, GST_FORMAT_TIME, &pos))
     {
-        m_lastPosition = 0;
-        emit positionChanged(0);
+        m_anchorPosition = -1;
         return;
     }
-    auto mspos = pos / GST_MSECOND;
-    if (m_lastPosition != mspos)
+    m_anchorPosition = std::max(pos - m_trackStartOffset, G_GINT64_CONSTANT(0));
+    if (m_currentState != GST_STATE_PLAYING)
+        return;
+    if (auto clock = gst_element_get_clock(m_pipeline))
     {
-        m_lastPosition = mspos;
-        emit positionChanged(mspos);
+        m_anchorClockTime = gst_clock_get_time(clock);
+        gst_object_unref(clock);
     }
 }
 
 void MediaBackend::timerSlow_timeout()
 {
-    auto currPos = m_lastPosition; // local copy
-    // Detect silence (if enabled)
-    if (m_silenceDetect)
+    // Correct the interpolated position for drift, the watchdogs need the position the pipeline actually reached
+    anchorPosition();
+    auto currPos = m_anchorPosition < 0 ? 0 : m_anchorPosition / GST_MSECOND;
+    // Detect silence (if enabled), media with a known end point is cut there by timerFast_timeout() instead
+    if (m_silenceDetect && m_endPointMs <= 0)
     {
         if (isSilent() && state() == MediaBackend::PlayingState)
         {
@@ -498,6 +785,7 @@ void MediaBackend::timerSlow_timeout()
             {
                 if (m_type != Karaoke)
                 {
+                    m_endOfMediaUs = g_get_monotonic_time();
                     emit silenceDetected();
                     m_silenceDuration = 0;
                 }
@@ -507,6 +795,7 @@ void MediaBackend::timerSlow_timeout()
                     int last_frame_pos = m_cdgSrc->positionOfFinalFrameMS();
                     if (last_frame_pos > 0 && last_frame_pos <= currPos)
                     {
+                        m_endOfMediaUs = g_get_monotonic_time();
                         emit silenceDetected();
                         m_silenceDuration = 0;
                     }
@@ -528,6 +817,7 @@ void MediaBackend::timerSlow_timeout()
             if (hungCycles >= 5)
             {
                 m_logger->warn("{} Playback has been hung for {} seconds, giving up!", m_loggingPrefix, hungCycles);
+                m_endOfMediaUs = g_get_monotonic_time();
                 emit stateChanged(EndOfMediaState);
                 hungCycles = 0;
             }
@@ -564,138 +854,87 @@ void MediaBackend::setPitchShift(const int &pitchShift)
     emit pitchChanged(pitchShift); // NOLINT(readability-misleading-indentation)
 }
 
-void MediaBackend::gstBusFunc(GstMessage *message)
+void MediaBackend::busError(const QString &message, const QString &debug, quint64 generation)
 {
-    switch (GST_MESSAGE_TYPE(message))
+    m_logger->error("{} [GStreamer] {}", m_loggingPrefix, message.toStdString());
+    m_logger->debug("{} [GStreamer] {}", m_loggingPrefix, debug.toStdString());
+    // Raised by media that has been stopped since, don't take it out on what's playing now
+    if (!m_busWatcher->isCurrent(generation))
+        return;
+    if (message == "Your GStreamer installation is missing a plug-in.")
     {
-        case GST_MESSAGE_ERROR:
-        {
-            GError *err;
-            gchar *debug;
-            gst_message_parse_error(message, &err, &debug);
-            m_logger->error("{} [GStreamer] {}", m_loggingPrefix, err->message);
-            m_logger->debug("{} [GStreamer] {}", m_loggingPrefix, debug);
-            if (QString(err->message) == "Your GStreamer installation is missing a plug-in.")
-            {
-                QString player = (m_objName == "KAR") ? "karaoke" : "break music";
-                m_logger->error("{} Unable to play file, missing media codec", m_loggingPrefix);
-                emit audioError("Unable to play " + player + " file, missing gstreamer plugin");
-                stop(true);
-            }
-            g_error_free(err);
-            g_free(debug);
-            break;
-        }
-        case GST_MESSAGE_WARNING:
-        {
-            GError *err;
-            gchar *debug;
-            gst_message_parse_warning(message, &err, &debug);
-            m_logger->warn("{} [GStreamer] {}", m_loggingPrefix, err->message);
-            m_logger->debug("{} [GStreamer] {}", m_loggingPrefix, debug);
-            g_error_free(err);
-            g_free(debug);
-            break;
-        }
-        case GST_MESSAGE_STATE_CHANGED:
-        {
-            // This will fire for all elements in the pipeline.
-            // We only want to react once: on the actual pipeline element.
-            if (message->src != (GstObject *)m_pipeline) break;
+        QString player = (m_objName == "KAR") ? "karaoke" : "break music";
+        m_logger->error("{} Unable to play file, missing media codec", m_loggingPrefix);
+        emit audioError("Unable to play " + player + " file, missing gstreamer plugin");
+        stop(true);
+    }
+}
 
-            // Avoid doing anything while audio outputs are changing
-            if (m_changingAudioOutputs)
-                break;
+void MediaBackend::busWarning(const QString &message, const QString &debug)
+{
+    m_logger->warn("{} [GStreamer] {}", m_loggingPrefix, message.toStdString());
+    m_logger->debug("{} [GStreamer] {}", m_loggingPrefix, debug.toStdString());
+}
 
-            GstState oldState, state, pending;
-            gst_message_parse_state_changed(message, &oldState, &state, &pending);
+void MediaBackend::busStateChanged([[maybe_unused]] GstState oldState, GstState state, quint64 generation)
+{
+    // Avoid doing anything while audio outputs are changing
+    if (m_changingAudioOutputs || !m_busWatcher->isCurrent(generation))
+        return;
 
-            // we are only interested in final states
-            if (pending != GST_STATE_VOID_PENDING || oldState == state)
-                break;
+    m_currentState = state;
 
-            m_currentState = state;
+    if (m_currentlyFadedOut)
+        g_object_set(m_faderVolumeElement, "volume", 0.0, nullptr);
 
+    switch (state)
+    {
+        case GST_STATE_PLAYING:
+            m_logger->debug("{} GStreamer reported state change to Playing", m_loggingPrefix);
+            anchorPosition();
+            emit stateChanged(MediaBackend::PlayingState);
             if (m_currentlyFadedOut)
-                g_object_set(m_faderVolumeElement, "volume", 0.0, nullptr);
-
-            switch (state)
-            {
-                case GST_STATE_PLAYING:
-                    m_logger->debug("{} GStreamer reported state change to Playing", m_loggingPrefix);
-                    emit stateChanged(MediaBackend::PlayingState);
-                    if (m_currentlyFadedOut)
-                        m_fader->immediateOut();
-                    break;
-
-                case GST_STATE_PAUSED:
-                    m_logger->debug("{} GStreamer reported state change to Paused", m_loggingPrefix);
-                    emit stateChanged(MediaBackend::PausedState);
-                    break;
-
-                default:
-                    break;
-            }
+                m_fader->immediateOut();
             break;
-        }
-        case GST_MESSAGE_EOS:
-        {
-            if (message->src != (GstObject *)m_pipeline) break;
-            m_logger->debug("{} GStreamer reported state change to EndOfMedia", m_loggingPrefix);
-            emit stateChanged(EndOfMediaState);
-            m_currentState = GST_STATE_NULL;
-            break;
-        }
-        case GST_MESSAGE_ELEMENT:
-        {
-            auto msgStructure = gst_message_get_structure(message);
-            if (std::string(gst_structure_get_name(msgStructure)) == "level")
-            {
-                auto array_val = gst_structure_get_value(msgStructure, "rms");
-                auto rms_arr = reinterpret_cast<GValueArray*>(g_value_get_boxed (array_val));
-                double rmsValues = 0.0;
-                for (unsigned int i{0}; i < rms_arr->n_values; ++i)
-                {
-                    auto value = g_value_array_get_nth (rms_arr, i);
-                    auto rms_dB = g_value_get_double (value);
-                    auto rms = pow (10, rms_dB / 20);
-                    rmsValues += rms;
-                }
-                m_currentRmsLevel = rmsValues / rms_arr->n_values;
-            }
-            break;
-        }
-        case GST_MESSAGE_DURATION_CHANGED:
-        {
-            gint64 dur, msdur;
-            if (gst_element_query_duration(m_pipeline,GST_FORMAT_TIME,&dur))
-                msdur = dur / 1000000;
-            else
-                msdur = 0;
-            m_logger->debug("{} GStreamer reported duration change to {}ms", m_loggingPrefix, msdur);
-            emit durationChanged(msdur);
-            break;
-        }
-        case GST_MESSAGE_STREAM_START:
-            m_logger->debug("{} GStreamer reported stream started", m_loggingPrefix);
-        case GST_MESSAGE_NEED_CONTEXT:
-        case GST_MESSAGE_TAG:
-        case GST_MESSAGE_STREAM_STATUS:
-        case GST_MESSAGE_LATENCY:
-        case GST_MESSAGE_ASYNC_DONE:
-        case GST_MESSAGE_NEW_CLOCK:
+
+        case GST_STATE_PAUSED:
+            m_logger->debug("{} GStreamer reported state change to Paused", m_loggingPrefix);
+            anchorPosition();
+            emit stateChanged(MediaBackend::PausedState);
             break;
 
         default:
-            m_logger->debug("{} Unhandled GStreamer message received - element: {} - type: {} - name: {}",
-                          m_loggingPrefix,
-                          message->src->name,
-                          gst_message_type_get_name(message->type),
-                          message->type);
             break;
     }
 }
 
+void MediaBackend::busEndOfStream(qint64 receivedUs, quint64 generation)
+{
+    // The end of a song that was stopped or replaced after the message was picked up
+    if (!m_busWatcher->isCurrent(generation))
+    {
+        m_logger->debug("{} Dropping stale GStreamer EndOfMedia", m_loggingPrefix);
+        return;
+    }
+    m_endOfMediaUs = receivedUs;
+    m_logger->debug("{} GStreamer reported state change to EndOfMedia, delivered after {}us", m_loggingPrefix,
+                    g_get_monotonic_time() - receivedUs);
+    emit stateChanged(EndOfMediaState);
+    m_currentState = GST_STATE_NULL;
+    m_anchorPosition = -1;
+    // Whatever was queued never made it into the mix
+    cancelNext();
+}
+
+void MediaBackend::busDurationChanged(quint64 generation)
+{
+    if (!m_busWatcher->isCurrent(generation))
+        return;
+    auto msdur = duration();
+    m_logger->debug("{} GStreamer reported duration change to {}ms", m_loggingPrefix, msdur);
+    emit durationChanged(msdur);
+}
+
 void gstDebugFunction(GstDebugCategory * category, GstDebugLevel level, [[maybe_unused]] const gchar * file,
                       [[maybe_unused]] const gchar * function, [[maybe_unused]] gint line, [[maybe_unused]] GObject * object, GstDebugMessage * message, gpointer user_data) {
     auto *backend = (MediaBackend*)user_data;
@@ -758,25 +997,50 @@ void MediaBackend::buildPipeline()
 
     m_decoder = gst_element_factory_make("uridecodebin", "uridecodebin");
     g_signal_connect(m_decoder, "pad-added", G_CALLBACK(padAddedToDecoder_cb), this);
+    g_signal_connect(m_decoder, "source-setup", G_CALLBACK(sourceSetup_cb), this);
     g_object_ref(m_decoder);
 
+    if (m_type == BackgroundMusic)
+    {
+        // Break music goes through a mixer so the next file can be mixed in as the current one ends, see queueNext()
+        if ((m_audioMixer = gst_element_factory_make("audiomixer", "audioMixer")))
+        {
+            g_object_ref(m_audioMixer);
+            m_nextDecoder = gst_element_factory_make("uridecodebin", "uridecodebinNext");
+            g_signal_connect(m_nextDecoder, "pad-added", G_CALLBACK(padAddedToDecoder_cb), this);
+            g_signal_connect(m_nextDecoder, "source-setup", G_CALLBACK(sourceSetup_cb), this);
+            g_object_ref(m_nextDecoder);
+            // The decoders take turns being added to the pipeline while it plays, keep their preroll to themselves so
+            // the pipeline doesn't drop back to paused for it
+            g_object_set(m_decoder, "async-handling", TRUE, nullptr);
+            g_object_set(m_nextDecoder, "async-handling", TRUE, nullptr);
+        }
+        else
+        {
+            m_logger->warn("{} audiomixer element not available, break music will not be crossfaded", m_loggingPrefix);
+        }
+    }
+
     m_cdgSrc = new CdgAppSrc();
 
     buildVideoSinkBin();
     buildAudioSinkBin();
 
 
-    m_gstBusMsgHandlerTimer.start(40);
-    connect(&m_gstBusMsgHandlerTimer, &QTimer::timeout, [&] () {
-        while (gst_bus_have_pending(m_bus))
-        {
-            auto msg = gst_bus_pop(m_bus);
-            if (!msg)
-                continue;
-            gstBusFunc(msg);
-            gst_message_unref(msg);
-        }
+    m_busWatcher = new GstBusWatcher(m_bus, m_pipeline, m_loggingPrefix);
+    connect(m_busWatcher, &GstBusWatcher::error, this, &MediaBackend::busError);
+    connect(m_busWatcher, &GstBusWatcher::warning, this, &MediaBackend::busWarning);
+    connect(m_busWatcher, &GstBusWatcher::stateChanged, this, &MediaBackend::busStateChanged);
+    connect(m_busWatcher, &GstBusWatcher::endOfStream, this, &MediaBackend::busEndOfStream);
+    connect(m_busWatcher, &GstBusWatcher::durationChanged, this, &MediaBackend::busDurationChanged);
+    connect(m_busWatcher, &GstBusWatcher::asyncDone, this, [this] (quint64 generation) {
+        if (m_busWatcher->isCurrent(generation))
+            anchorPosition();
     });
+    connect(m_busWatcher, &GstBusWatcher::levelChanged, this, [this] (double rms) {
+        m_currentRmsLevel = rms;
+    }, Qt::DirectConnection);
+    m_busWatcher->start();
 
     m_logger->debug("{} Gstreamer pipeline build completed", m_loggingPrefix);
     //setEnforceAspectRatio(m_settings.enforceAspectRatio());
@@ -789,18 +1053,6 @@ void MediaBackend::buildVideoSinkBin()
 
     m_queueMainVideo = gst_element_factory_make("queue", "m_queueMainVideo");
     gst_bin_add(reinterpret_cast<GstBin *>(m_videoBin), m_queueMainVideo);
-    m_prescalerVideoConvert = gst_element_factory_make("videoconvert", "m_prescalerVideoConvert");
-    m_prescaler = gst_element_factory_make("videoscale", "m_prescaler");
-    g_object_set(m_prescaler, "method", 0, nullptr);
-    m_prescalerCapsFilter = gst_element_factory_make("capsfilter", "m_prescalerCapsFilter");
-    auto cdgPreScaleCaps = gst_caps_new_simple(
-            "video/x-raw",
-            "format", G_TYPE_STRING, "RGB",
-            "width",  G_TYPE_INT, 1152,
-            "height", G_TYPE_INT, 768,
-            NULL);
-    g_object_set(G_OBJECT(m_prescalerCapsFilter), "caps", cdgPreScaleCaps, nullptr);
-    gst_caps_unref(cdgPreScaleCaps);
 
     auto queuePad = gst_element_get_static_pad(m_queueMainVideo, "sink");
     auto ghostVideoPad = gst_ghost_pad_new("sink", queuePad);
@@ -809,7 +1061,7 @@ void MediaBackend::buildVideoSinkBin()
     gst_object_unref(queuePad);
 
     m_videoTee = gst_element_factory_make("tee", "videoTee");
-    gst_bin_add_many(reinterpret_cast<GstBin *>(m_videoBin), m_prescalerVideoConvert, m_prescaler, m_prescalerCapsFilter, m_videoTee, nullptr);
+    gst_bin_add(reinterpret_cast<GstBin *>(m_videoBin), m_videoTee);
     gst_element_link(m_queueMainVideo, m_videoTee);
 
 
@@ -826,7 +1078,7 @@ void MediaBackend::buildAudioSinkBin()
     m_fader->setVolumeElement(m_faderVolumeElement);
     auto aConvInput = gst_element_factory_make("audioconvert", "aConvInput");
     m_audioSink = gst_element_factory_make("autoaudiosink", "autoAudioSink");
-    auto rgVolume = gst_element_factory_make("rgvolume", "rgVolume");
+    m_rgVolume = gst_element_factory_make("rgvolume", "rgVolume");
     auto level = gst_element_factory_make("level", "level");
     m_equalizer = gst_element_factory_make("equalizer-10bands", "equalizer");
     m_bus = gst_element_get_bus(m_pipeline);
@@ -848,8 +1100,8 @@ void MediaBackend::buildAudioSinkBin()
 
     GstElement *audioBinLastElement;
 
-    gst_bin_add_many(GST_BIN(m_audioBin), queueMainAudio, audioResample, m_audioPanorama, level, m_scaleTempo, aConvInput, rgVolume, /*rgLimiter,*/ m_volumeElement, m_equalizer, aConvPostPanorama, m_fltrPostPanorama, m_faderVolumeElement, nullptr);
-    gst_element_link_many(queueMainAudio, aConvInput, audioResample, rgVolume, /*rgLimiter,*/ m_scaleTempo, level, m_equalizer, m_audioPanorama, aConvPostPanorama, audioBinLastElement = m_fltrPostPanorama, nullptr);
+    gst_bin_add_many(GST_BIN(m_audioBin), queueMainAudio, audioResample, m_audioPanorama, level, m_scaleTempo, aConvInput, m_rgVolume, /*rgLimiter,*/ m_volumeElement, m_equalizer, aConvPostPanorama, m_fltrPostPanorama, m_faderVolumeElement, nullptr);
+    gst_element_link_many(queueMainAudio, aConvInput, audioResample, m_rgVolume, /*rgLimiter,*/ m_scaleTempo, level, m_equalizer, m_audioPanorama, aConvPostPanorama, audioBinLastElement = m_fltrPostPanorama, nullptr);
 
     if (m_loadPitchShift)
     {
@@ -898,7 +1150,7 @@ void MediaBackend::buildAudioSinkBin()
     gst_element_add_pad(m_audioBin, ghostPad);
     gst_object_unref(pad);
 
-    g_object_set(rgVolume, "album-mode", false, nullptr);
+    g_object_set(m_rgVolume, "album-mode", false, nullptr);
     g_object_set(level, "message", TRUE, nullptr);
     setVolume(m_volume);
     m_timerSlow.start(1000);
@@ -930,9 +1182,23 @@ void MediaBackend::padAddedToDecoder_cb(GstElement *element,  GstPad *pad, gpoin
 
     bool doPatch = false;
 
+    if (backend->nextDecoderPadAdded(element, pad, new_pad_type))
+    {
+        gst_caps_unref (new_pad_caps);
+        return;
+    }
+
     if (!backend->m_audioSrcPad && g_str_has_prefix (new_pad_type, "audio/x-raw"))
     {
-        backend->m_audioSrcPad = new PadInfo(getPadInfo(element, pad));
+        if (backend->m_audioMixer)
+        {
+            backend->m_mixerPad = backend->linkToMixer(pad, 0, 0);
+            backend->m_audioSrcPad = new PadInfo { backend->m_audioMixer, "src" };
+        }
+        else
+        {
+            backend->m_audioSrcPad = new PadInfo(getPadInfo(element, pad));
+        }
         doPatch = true;
     }
 
@@ -949,15 +1215,98 @@ void MediaBackend::padAddedToDecoder_cb(GstElement *element,  GstPad *pad, gpoin
     }
 }
 
+bool MediaBackend::nextDecoderPadAdded(GstElement *element, GstPad *pad, const gchar *padType)
+{
+    QMutexLocker locker(&m_nextMixerLock);
+    if (element != m_nextDecoder)
+        return false;
+    // Only the audio of the next file is mixed in, files with video have to be played the usual way. There is no
+    // crossfade start once cancelNext() dropped the file.
+    if (!m_nextMixerPad && GST_CLOCK_TIME_IS_VALID(m_crossfadeStart) && g_str_has_prefix(padType, "audio/x-raw"))
+    {
+        m_nextMixerPad = linkToMixer(pad, m_crossfadeStart, m_crossfadeDuration);
+    }
+    else if (g_str_has_prefix(padType, "video/x-raw"))
+    {
+        QMetaObject::invokeMethod(this, [this] () {
+            m_logger->info("{} Queued media has video, it will be played separately", m_loggingPrefix);
+            m_nextRejected = m_nextFilename;
+            cancelNext();
+        }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+GstPad* MediaBackend::linkToMixer(GstPad *decoderPad, GstClockTime startRunningTime, GstClockTime fadeIn)
+{
+    auto mixerPad = gsthlp_request_pad(m_audioMixer, "sink_%u");
+    if (fadeIn > 0)
+        setVolumeRamp(mixerPad, 0, 0.0, fadeIn, 1.0);
+    gst_pad_add_probe(mixerPad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, mixerPadEvent_cb, this, nullptr);
+    // Shift the file's running time so its first sample lands exactly where it's meant to be mixed in
+    gst_pad_set_offset(decoderPad, static_cast<gint64>(startRunningTime));
+    if (gst_pad_link(decoderPad, mixerPad) != GST_PAD_LINK_OK)
+        m_logger->error("{} Unable to link decoder to the audio mixer", m_loggingPrefix);
+    return mixerPad;
+}
+
+GstPadProbeReturn MediaBackend::mixerPadEvent_cb(GstPad *pad, GstPadProbeInfo *info, gpointer caller)
+{
+    if (GST_EVENT_TYPE(GST_PAD_PROBE_INFO_EVENT(info)) == GST_EVENT_EOS)
+    {
+        auto *backend = (MediaBackend*)caller;
+        QMetaObject::invokeMethod(backend, [backend, pad] () { backend->mixerInputEnded(pad); }, Qt::QueuedConnection);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void MediaBackend::sourceSetup_cb([[maybe_unused]]GstElement *element, GstElement *source, gpointer caller)
+{
+    auto *backend = (MediaBackend*)caller;
+
+    if (GST_IS_APP_SRC(source) && !backend->m_audioData.isEmpty())
+    {
+        BufferAppSrc::attach(GST_APP_SRC(source), backend->m_audioData);
+    }
+}
+
 void MediaBackend::stopPipeline()
 {
     gst_element_set_state(m_pipeline, GST_STATE_NULL);
+    m_busWatcher->newGeneration();
+    cancelNext();
+    logVideoSinkStats();
     m_currentState = GST_STATE_NULL;
+    m_anchorPosition = -1;
     m_hasVideo = false;
     emit stateChanged(MediaBackend::StoppedState);
     emit hasActiveVideoChanged(false);
 }
 
+void MediaBackend::updateVideoSinkSize(const VideoSinkData &videoSink)
+{
+    // Even sizes keep the subsampled formats happy
+    const QSize deviceSize = videoSink.surface->size() * videoSink.surface->devicePixelRatioF() / videoSink.resolutionDivisor;
+    const int width = std::max(2, deviceSize.width() & ~1);
+    const int height = std::max(2, deviceSize.height() & ~1);
+    auto caps = gst_caps_new_simple("video/x-raw", "width", G_TYPE_INT, width, "height", G_TYPE_INT, height, nullptr);
+    g_object_set(videoSink.sizeFilter, "caps", caps, nullptr);
+    gst_caps_unref(caps);
+}
+
+bool MediaBackend::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Resize)
+    {
+        for (const auto &vs : m_videoSinks)
+        {
+            if (vs.surface == watched && vs.sizeFilter)
+                updateVideoSinkSize(vs);
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
 void MediaBackend::resetVideoSinks()
 {
     if (!m_videoAccelEnabled)
@@ -969,6 +1318,21 @@ void MediaBackend::resetVideoSinks()
     }
 }
 
+void MediaBackend::logVideoSinkStats()
+{
+    for (size_t i = 0; i < m_videoSinks.size(); i++)
+    {
+        if (!m_videoSinks[i].softwareRenderVideoSink)
+            continue;
+        auto stats = m_videoSinks[i].softwareRenderVideoSink->takeStats();
+        if (stats.paintedFrames == 0 && stats.droppedFrames == 0)
+            continue;
+        m_logger->debug("{} Video output {}: {} frames painted, {} dropped, {} late, avg present latency {}us",
+                        m_loggingPrefix, i + 1, stats.paintedFrames, stats.droppedFrames, stats.lateFrames,
+                        stats.avgPresentLatencyUs);
+    }
+}
+
 void MediaBackend::forceVideoExpose()
 {
     if (!m_videoAccelEnabled)
@@ -1083,6 +1447,7 @@ void MediaBackend::setTempo(const int &percent)
     if (!m_cdgMode)
     {
         gst_element_send_event(m_pipeline, gst_event_new_seek(m_playbackRate, GST_FORMAT_TIME, (GstSeekFlags)(GST_SEEK_FLAG_INSTANT_RATE_CHANGE), GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE, GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE));
+        anchorPosition();
         return;
     }
 #endif
@@ -1113,6 +1478,7 @@ void MediaBackend::setAudioOutputDevice(const AudioOutputDevice &device)
         playAfter = true;
         m_changingAudioOutputs = true;
         gst_element_set_state(m_pipeline, GST_STATE_NULL);
+        m_busWatcher->newGeneration();
         m_logger->debug("{} Waiting for media to enter stopped state", m_loggingPrefix);
         GstState curState;
         gst_element_get_state(m_pipeline, &curState, nullptr, GST_CLOCK_TIME_NONE);
@@ -1138,10 +1504,6 @@ void MediaBackend::setAudioOutputDevice(const AudioOutputDevice &device)
     if (playAfter)
     {
         m_logger->debug("{} Resuming playback after audio output device change", m_loggingPrefix);
-        if (m_cdgMode)
-            setMediaCdg(m_cdgFilename, m_filename);
-        else
-            setMedia(m_filename);
         play();
         m_logger->debug("{} Waiting or pipeline to enter playing state", m_loggingPrefix);
         GstState curState;
@@ -1170,17 +1532,32 @@ void MediaBackend::setAudioOutputDevice(const QString &deviceName)
     }
 }
 
-void MediaBackend::setVideoOutputWidgets(const std::vector<QWidget*>& surfaces)
+void MediaBackend::setVideoOutputWidgets(const std::vector<QWidget*>& surfaces, const std::vector<VideoOutputPolicy>& policies)
 {
     if (!m_videoSinks.empty())
     {
         throw std::runtime_error(("Video output widget(s) already set."));
     }
 
+    if (!m_videoAccelEnabled && surfaces.size() > 1)
+    {
+        // Software rendered outputs all take BGRx, convert once ahead of the tee instead of once per output.
+        // The per output videoconvert elements are then passthrough and only the scaling differs.
+        auto sharedConvert = gst_element_factory_make("videoconvert", "sharedVideoConvert");
+        auto sharedCapsFilter = gst_element_factory_make("capsfilter", "sharedVideoCapsFilter");
+        auto sharedCaps = gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "BGRx", nullptr);
+        g_object_set(sharedCapsFilter, "caps", sharedCaps, nullptr);
+        gst_caps_unref(sharedCaps);
+        gst_bin_add_many(GST_BIN(m_videoBin), sharedConvert, sharedCapsFilter, nullptr);
+        gst_element_unlink(m_queueMainVideo, m_videoTee);
+        gst_element_link_many(m_queueMainVideo, sharedConvert, sharedCapsFilter, m_videoTee, nullptr);
+    }
+
     int i = 0;
 
     for (auto &surface : surfaces)
     {
+        const auto policy = static_cast<size_t>(i) < policies.size() ? policies[i] : VideoOutputPolicy();
         i++;
         VideoSinkData vd;
 
@@ -1201,8 +1578,31 @@ void MediaBackend::setVideoOutputWidgets(const std::vector<QWidget*>& surfaces)
         auto videoConv = gst_element_factory_make("videoconvert", QString("preOutVideoConvert%1").arg(i).toLocal8Bit());
         vd.videoScale = gst_element_factory_make("videoscale", QString("videoScale%1").arg(i).toLocal8Bit());
 
-        gst_bin_add_many(GST_BIN(m_videoBin), videoQueue, videoConv, vd.videoScale, vd.videoSink, nullptr);
-        gst_element_link_many(m_videoTee, videoQueue, videoConv, vd.videoScale, vd.videoSink, nullptr);
+        std::vector<GstElement*> branch{videoQueue};
+        if (policy.maxFramerate > 0)
+        {
+            auto videoRate = gst_element_factory_make("videorate", QString("videoRate%1").arg(i).toLocal8Bit());
+            g_object_set(videoRate, "drop-only", TRUE, "max-rate", policy.maxFramerate, nullptr);
+            branch.push_back(videoRate);
+        }
+        branch.insert(branch.end(), {videoConv, vd.videoScale});
+        if (m_videoAccelEnabled && policy.resolutionDivisor > 1)
+        {
+            vd.resolutionDivisor = policy.resolutionDivisor;
+            vd.sizeFilter = gst_element_factory_make("capsfilter", QString("videoSizeFilter%1").arg(i).toLocal8Bit());
+            branch.push_back(vd.sizeFilter);
+            updateVideoSinkSize(vd);
+            surface->installEventFilter(this);
+        }
+        branch.push_back(vd.videoSink);
+
+        GstElement *upstream = m_videoTee;
+        for (auto element : branch)
+        {
+            gst_bin_add(GST_BIN(m_videoBin), element);
+            gst_element_link(upstream, element);
+            upstream = element;
+        }
 
         m_videoSinks.push_back(vd);
     }
@@ -1210,6 +1610,20 @@ void MediaBackend::setVideoOutputWidgets(const std::vector<QWidget*>& surfaces)
     resetVideoSinks();
 }
 
+int MediaBackend::cdgPrescaleFactor()
+{
+    // Smallest factor that covers the largest output, the sink only has to scale down from there
+    double factor{2.0};
+    for (const auto &vd : m_videoSinks)
+    {
+        const auto ratio = vd.surface->devicePixelRatioF();
+        factor = std::max({factor,
+                           vd.surface->width() * ratio / cdg::FRAME_DIM_CROPPED.width(),
+                           vd.surface->height() * ratio / cdg::FRAME_DIM_CROPPED.height()});
+    }
+    return std::min(static_cast<int>(std::ceil(factor)), 4);
+}
+
 const char* MediaBackend::getVideoSinkElementNameForFactory()
 {
 #if defined(Q_OS_LINUX)
@@ -44,6 +44,7 @@
 #include "cdg/cdgfilereader.h"
 #include "settings.h"
 #include "gstreamer/gstreamerhelper.h"
+#include "gstreamer/gstbuswatcher.h"
 #include <spdlog/spdlog.h>
 #include <spdlog/async_logger.h>
 #include <spdlog/fmt/ostr.h>
@@ -88,6 +89,14 @@ public:
         size_t index{0};
     };
 
+    struct VideoOutputPolicy {
+        // Frames above this rate are dropped before they are converted, 0 for no limit
+        int maxFramerate{0};
+        // Scale to 1/n of the surface width and height in the pipeline, the sink stretches it to the surface on the GPU.
+        // Accelerated sinks only, software rendered outputs already get frames scaled to the size they're painted at.
+        int resolutionDivisor{1};
+    };
+
     explicit MediaBackend(QObject *parent, QString objectName, MediaType type);
     ~MediaBackend() override;
 
@@ -99,7 +108,10 @@ public:
     void setAccelType(const accel &type=accel::XVideo) { m_accelMode = type; }
     void setAudioOutputDevice(const AudioOutputDevice &device);
     void setAudioOutputDevice(const QString &deviceName);
-    void setVideoOutputWidgets(const std::vector<QWidget*>& surfaces);
+    /**
+     * @param policies Quality policy for the surface at the same index, surfaces without one get the full quality.
+     */
+    void setVideoOutputWidgets(const std::vector<QWidget*>& surfaces, const std::vector<VideoOutputPolicy>& policies = {});
     void setVideoEnabled(const bool &enabled);
     [[nodiscard]] bool isVideoEnabled() const { return m_videoEnabled; }
     bool hasActiveVideo();
@@ -110,6 +122,29 @@ public:
 
     qint64 position();
     qint64 duration();
+    /**
+     * @brief Position the current media is known to end at, e.g. from EndPointAnalyzerController::endPoint(), 0 if
+     * unknown. With silence detection on, playback is cut there instead of after seconds of detected silence.
+     * Setting new media clears it.
+     */
+    void setEndPoint(qint64 ms) { m_endPointMs = ms; }
+    /**
+     * @brief Gain applied to media without ReplayGain tags of its own, e.g. from LoudnessScanner::replayGain().
+     * @param peak Measured peak, the gain is limited so it doesn't push the peak past full scale. 0 if unknown.
+     */
+    void setReplayGain(double gainDb, double peak = 0.0);
+    // Where playback is expected to stop, the end point when it will be cut there, the duration otherwise
+    qint64 endPosition();
+    /**
+     * @brief Start decoding the file that follows the current one, so it is mixed in as the current one ends.
+     *
+     * Break music only. The next file starts crossfadeMs before the end of the current one, or right at its end if
+     * crossfadeMs is 0, and currentMediaChanged() is emitted once the current one has finished. Only audio is mixed,
+     * nothing is queued while the current media has video and the queued file is dropped if it turns out to have any.
+     * @return false if the next file can't be mixed in, it has to be played with setMedia() and play() instead.
+     */
+    bool queueNext(const QString &filename, int crossfadeMs);
+    [[nodiscard]] bool hasQueuedNext() const { return !m_nextFilename.isEmpty(); }
     State state();
     QStringList getOutputDevices();
     static QString msToMMSS(const qint64 &msec)
@@ -135,6 +170,9 @@ private:
         QWidget *surface { nullptr };
         GstElement *videoSink { nullptr };
         GstElement *videoScale { nullptr };
+        // Capsfilter behind videoScale that holds the reduced output size, only set for a resolutionDivisor above 1
+        GstElement *sizeFilter { nullptr };
+        int resolutionDivisor { 1 };
         SoftwareRenderVideoSink *softwareRenderVideoSink { nullptr };
     };
 
@@ -142,6 +180,7 @@ private:
     MediaType m_type;
     Settings m_settings;
     GstBus *m_bus{nullptr};
+    GstBusWatcher *m_busWatcher{nullptr};
 
     /* PIPELINE */
     GstElement *m_pipeline { nullptr };  // Pipeline
@@ -162,13 +201,28 @@ private:
     GstElement *m_pitchShifterRubberBand { nullptr };
     GstElement *m_pitchShifterSoundtouch { nullptr };
     GstElement *m_volumeElement { nullptr };
+    GstElement *m_rgVolume { nullptr };
     GstElement *m_faderVolumeElement { nullptr };
     GstElement *m_equalizer { nullptr };
     GstElement *m_audioSink { nullptr };
-    GstElement *m_prescalerCapsFilter { nullptr };
     GstElement *m_queueMainVideo { nullptr };
-    GstElement *m_prescaler { nullptr };
-    GstElement *m_prescalerVideoConvert { nullptr };
+
+    /* BREAK MUSIC MIXER */
+    GstElement *m_audioMixer { nullptr };
+    GstElement *m_nextDecoder { nullptr };
+    GstPad     *m_mixerPad { nullptr };      // Mixer input m_decoder is linked to
+    GstPad     *m_nextMixerPad { nullptr };  // Mixer input m_nextDecoder is linked to
+    QString m_nextFilename;
+    // Last queued file that turned out to have video
+    QString m_nextRejected;
+    // Running time the next file starts at and how long it takes to fade in
+    GstClockTime m_crossfadeStart { GST_CLOCK_TIME_NONE };
+    GstClockTime m_crossfadeDuration { 0 };
+    // Guards the next decoder, its mixer input and the crossfade times, its pad-added handler links the mixer input on a
+    // streaming thread. Never held while the next decoder changes state, that waits for the streaming threads.
+    QMutex m_nextMixerLock;
+    // Mixer output position the current file started at, positions reported for the file are relative to this
+    gint64 m_trackStartOffset { 0 };
 
     GstCaps *m_audioCapsStereo { nullptr };
     GstCaps *m_audioCapsMono { nullptr };
@@ -189,18 +243,28 @@ private:
 
     QString m_filename;
     QString m_cdgFilename;
+    QByteArray m_audioData;
+    QByteArray m_cdgData;
+    // Parsed ahead of time from m_cdgData, handed to m_cdgSrc by the next play()
+    std::shared_ptr<CdgFileReader> m_cdgReader;
     QStringList m_outputDeviceNames;
-    QTimer m_gstBusMsgHandlerTimer;
     QTimer m_timerFast;
     QTimer m_timerSlow;
     int m_silenceDuration{0};
+    qint64 m_endPointMs{0};
     long m_positionWatchdogLastPos{0};
 
     double m_playbackRate{1.0};
     int m_volume{0};
     int m_lastPosition{0};
+    // Position read from the pipeline and the clock time it was read at, the displayed position is interpolated from
+    // these. The clock time is invalid while not playing, -1 position while nothing is loaded.
+    gint64 m_anchorPosition{-1};
+    GstClockTime m_anchorClockTime{GST_CLOCK_TIME_NONE};
+    // When the last media ended (or was considered ended), to measure how long it takes to start the next one
+    qint64 m_endOfMediaUs{0};
     AudioOutputDevice m_outputDevice;
-    double m_currentRmsLevel{0.0};
+    std::atomic<double> m_currentRmsLevel{0.0};
     bool m_cdgMode{false};
     bool m_fade{false};
     bool m_currentlyFadedOut{false};
@@ -219,20 +283,37 @@ private:
     void buildVideoSinkBin();
     void buildAudioSinkBin();
     void resetVideoSinks();
+    void updateVideoSinkSize(const VideoSinkData &videoSink);
+    void logVideoSinkStats();
     const char* getVideoSinkElementNameForFactory();
+    int cdgPrescaleFactor();
     void getAudioOutputDevices();
     void writePipelineGraphToFile(GstBin *bin, const QString& filePath, QString fileName);
     static double getPitchForSemitone(const int &semitone);
 
-    void gstBusFunc(GstMessage *message);
+    qint64 interpolatedPosition();
     static void padAddedToDecoder_cb(GstElement *element,  GstPad *pad, gpointer caller);
+    static void sourceSetup_cb(GstElement *element, GstElement *source, gpointer caller);
+    static GstPadProbeReturn mixerPadEvent_cb(GstPad *pad, GstPadProbeInfo *info, gpointer caller);
+    bool nextDecoderPadAdded(GstElement *element, GstPad *pad, const gchar *padType);
+    GstPad* linkToMixer(GstPad *decoderPad, GstClockTime startRunningTime, GstClockTime fadeIn);
+    void mixerInputEnded(GstPad *mixerPad);
     void stopPipeline();
     void resetPipeline();
     void patchPipelineSinks();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private slots:
     void timerFast_timeout();
     void timerSlow_timeout();
+    void anchorPosition();
+    void busError(const QString &message, const QString &debug, quint64 generation);
+    void busWarning(const QString &message, const QString &debug);
+    void busStateChanged(GstState oldState, GstState state, quint64 generation);
+    void busEndOfStream(qint64 receivedUs, quint64 generation);
+    void busDurationChanged(quint64 generation);
 
 
 public slots:
@@ -241,6 +322,8 @@ public slots:
     void pause();
     void setMedia(const QString &filename);
     void setMediaCdg(const QString &cdgFilename, const QString &audioFilename);
+    void setMediaCdg(const QByteArray &cdgData, const QByteArray &audioData, const QString &sourceName,
+                     std::shared_ptr<CdgFileReader> cdgReader = nullptr);
     void setMuted(const bool &muted);
     bool isMuted();
     void setPosition(const qint64 &position);
@@ -260,6 +343,7 @@ public slots:
     void fadeInImmediate();
     void fadeOutImmediate();
     void setEnforceAspectRatio(const bool &enforce);
+    void cancelNext();
 
 signals:
     void audioAvailableChanged(const bool audioAvailable);
@@ -273,6 +357,7 @@ signals:
     void silenceDetected();
     void pitchChanged(const int key);
     void audioError(const QString &msg);
+    void currentMediaChanged(const QString &filename);
 
 };
 
@@ -1,4 +1,5 @@
 #include "tablemodelkaraokesongs.h"
+#include "dbsongsfts.h"
 
 #include <QApplication>
 #include <QSqlQuery>
@@ -9,7 +10,10 @@
 #include <QDirIterator>
 #include <QSvgRenderer>
 #include <QMimeData>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <unordered_set>
 
 std::ostream & operator<<(std::ostream& os, const QString& s);
 
@@ -105,7 +109,7 @@ QVariant TableModelKaraokeSongs::data(const QModelIndex &index, int role) const
             return m_itemFontMetrics.size(Qt::TextSingleLine, getItemDisplayData(index).toString());
         case Qt::UserRole: {
             QVariant retVal;
-            retVal.setValue(m_filteredSongs.at(index.row()));
+            retVal.setValue(std::make_shared<okj::KaraokeSong>(m_catalog.song(m_filteredSongs.at(index.row()))));
             return retVal;
         }
         default:
@@ -116,9 +120,9 @@ QVariant TableModelKaraokeSongs::data(const QModelIndex &index, int role) const
 QVariant TableModelKaraokeSongs::getColumnDecorationRole(const QModelIndex &index) const {
     switch (index.column()) {
         case COL_SONGID:
-            if (m_filteredSongs.at(index.row())->path.endsWith("cdg", Qt::CaseInsensitive))
+            if (m_catalog.pathEndsWith(m_filteredSongs.at(index.row()), "cdg"))
                 return m_iconCdg;
-            else if (m_filteredSongs.at(index.row())->path.endsWith("zip", Qt::CaseInsensitive))
+            else if (m_catalog.pathEndsWith(m_filteredSongs.at(index.row()), "zip"))
                 return m_iconZip;
             else
                 return m_iconVid;
@@ -139,27 +143,28 @@ QVariant TableModelKaraokeSongs::getColumnTextAlignmentHint(int column) {
 }
 
 QVariant TableModelKaraokeSongs::getItemDisplayData(const QModelIndex &index) const {
+    auto row = m_filteredSongs.at(index.row());
     switch (index.column()) {
         case COL_ID:
-            return m_filteredSongs.at(index.row())->id;
+            return m_catalog.id(row);
         case COL_ARTIST:
-            return m_filteredSongs.at(index.row())->artist;
+            return m_catalog.artist(row);
         case COL_TITLE:
-            return m_filteredSongs.at(index.row())->title;
+            return m_catalog.title(row);
         case COL_SONGID:
-            return m_filteredSongs.at(index.row())->songid;
+            return m_catalog.songId(row);
         case COL_FILENAME:
-            return m_filteredSongs.at(index.row())->filename;
+            return m_catalog.filename(row);
         case COL_DURATION:
-            if (m_filteredSongs.at(index.row())->duration < 1)
+            if (m_catalog.duration(row) < 1)
                 return {};
-            return QTime(0, 0, 0, 0).addSecs(m_filteredSongs.at(index.row())->duration / 1000).toString(
+            return QTime(0, 0, 0, 0).addSecs(m_catalog.duration(row) / 1000).toString(
                     "m:ss");
         case COL_PLAYS:
-            return m_filteredSongs.at(index.row())->plays;
+            return m_catalog.plays(row);
         case COL_LASTPLAY: {
             QLocale locale;
-            return m_filteredSongs.at(index.row())->lastPlay.toString(
+            return m_catalog.lastPlay(row).toString(
                     locale.dateTimeFormat(QLocale::ShortFormat));
         }
         default:
@@ -168,22 +173,30 @@ QVariant TableModelKaraokeSongs::getItemDisplayData(const QModelIndex &index) co
 }
 
 void TableModelKaraokeSongs::loadData() {
+    auto st = std::chrono::high_resolution_clock::now();
     emit layoutAboutToBeChanged();
     m_allSongs.clear();
     m_filteredSongs.clear();
+    m_searchIndex.clear();
+    m_catalog.clear();
     QSqlQuery query;
+    // SQLite doesn't report result sizes, count first so the catalog is allocated once
+    if (query.exec("SELECT COUNT(*) FROM dbsongs") && query.next()) {
+        auto count = query.value(0).toULongLong();
+        m_catalog.reserve(count);
+        m_allSongs.reserve(count);
+        m_searchIndex.reserve(count);
+    }
     query.exec("SELECT songid,artist,title,discid,duration,filename,path,searchstring,plays,lastplay FROM dbsongs");
-    if (query.size() > 0)
-        m_filteredSongs.reserve(query.size());
     while (query.next()) {
-        auto song = m_allSongs.emplace_back(std::make_shared<okj::KaraokeSong>(okj::KaraokeSong{
+        auto row = m_catalog.append(okj::KaraokeSong{
                 query.value(0).toInt(),
                 query.value(1).toString(),
-                query.value(1).toString().toLower(),
+                QString(),
                 query.value(2).toString(),
-                query.value(2).toString().toLower(),
+                QString(),
                 query.value(3).toString(),
-                query.value(3).toString().toLower(),
+                QString(),
                 query.value(4).toInt(),
                 query.value(5).toString(),
                 query.value(6).toString(),
@@ -192,19 +205,59 @@ void TableModelKaraokeSongs::loadData() {
                 query.value(9).toDateTime(),
                 (query.value(3).toString() == "!!BAD!!"),
                 (query.value(3).toString() == "!!DROPPED!!")
-        }));
+        });
+        m_allSongs.emplace_back(row);
+        if (!m_catalog.isBad(row) && !m_catalog.isDropped(row))
+            indexSong(row);
     }
-    m_logger->info("{} Loaded {} karaoke songs from the db on disk", m_loggingPrefix, m_filteredSongs.size());
+    m_logger->info("{} Loaded {} karaoke songs from the db on disk in {}ms, {}KiB of song text", m_loggingPrefix,
+                   m_allSongs.size(),
+                   std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - st).count(),
+                   m_catalog.textSize() * sizeof(QChar) / 1024);
     search(m_lastSearch);
     emit layoutChanged();
 }
 
+QString TableModelKaraokeSongs::searchHaystack(KaraokeSongCatalog::Row row, SearchType type) const {
+    QString haystack;
+    switch (type) {
+        case SEARCH_TYPE_ALL:
+            return m_catalog.searchString(row);
+        case SEARCH_TYPE_ARTIST:
+            haystack = m_catalog.artist(row).toLower();
+            break;
+        case SEARCH_TYPE_TITLE:
+            haystack = m_catalog.title(row).toLower();
+            break;
+    }
+    return haystack.replace('&', " and ");
+}
+
+void TableModelKaraokeSongs::indexSong(KaraokeSongCatalog::Row row) {
+    m_searchIndex.addSong(row, {
+            searchHaystack(row, SEARCH_TYPE_ALL),
+            searchHaystack(row, SEARCH_TYPE_ARTIST),
+            searchHaystack(row, SEARCH_TYPE_TITLE)
+    });
+}
+
+int TableModelKaraokeSongs::filteredRowForId(int songId) const {
+    auto it = std::find_if(m_filteredSongs.begin(), m_filteredSongs.end(), [&](KaraokeSongCatalog::Row row) {
+        return m_catalog.id(row) == songId;
+    });
+    if (it == m_filteredSongs.end())
+        return -1;
+    return (int) std::distance(m_filteredSongs.begin(), it);
+}
+
 void TableModelKaraokeSongs::search(const QString &searchString) {
+    QString previousSearch = m_lastSearch;
     m_lastSearch = searchString.toLower();
     m_lastSearch.replace(',', ' ');
     m_lastSearch.replace('&', " and ");
-    if (m_settings.ignoreAposInSearch())
-        m_lastSearch.replace('\'', ' ');
+    // New search terms show full text results by relevance until the user picks a sort column
+    if (m_lastSearch != previousSearch)
+        m_relevanceOrder = true;
     if (searchTimer.isActive())
         searchTimer.stop();
     searchTimer.start(100);
@@ -212,56 +265,98 @@ void TableModelKaraokeSongs::search(const QString &searchString) {
 
 void TableModelKaraokeSongs::searchExec() {
     searchTimer.stop();
+    auto st = std::chrono::high_resolution_clock::now();
     emit layoutAboutToBeChanged();
-    std::vector<std::string> searchTerms;
-    std::string s = m_lastSearch.toLower().toStdString();
-    std::string::size_type prev_pos = 0, pos = 0;
-    while ((pos = s.find(' ', pos)) != std::string::npos) {
-        searchTerms.emplace_back(s.substr(prev_pos, pos - prev_pos));
-        prev_pos = ++pos;
-    }
-    searchTerms.emplace_back(s.substr(prev_pos, pos - prev_pos));
     m_filteredSongs.clear();
-    m_filteredSongs.reserve(m_allSongs.size());
+    auto splitTerms = [](const QString &text) {
 #if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
-    auto needles = m_lastSearch.split(' ', QString::SplitBehavior::SkipEmptyParts);
+        return text.split(' ', QString::SplitBehavior::SkipEmptyParts);
 #else
-    auto needles = m_lastSearch.split(' ', Qt::SplitBehavior(Qt::SkipEmptyParts));
+        return text.split(' ', Qt::SplitBehavior(Qt::SkipEmptyParts));
 #endif
-    for (const auto &song : m_allSongs) {
-        if (song->dropped)
-            continue;
-        if (song->bad)
-            continue;
-        QString haystack;
-        switch (m_searchType) {
-            case TableModelKaraokeSongs::SEARCH_TYPE_ALL: {
-                haystack = song->searchString;
-                break;
-            }
-            case TableModelKaraokeSongs::SEARCH_TYPE_ARTIST: {
-                haystack = song->artistL.replace('&', " and ");
-                break;
-            }
-            case TableModelKaraokeSongs::SEARCH_TYPE_TITLE: {
-                haystack = song->titleL.replace('&', " and ");
-                break;
-            }
+    };
+    if (m_fullTextSearch) {
+        // The full text index has no apostrophes, "don't" is searched there as "dont" whatever the setting
+        auto terms = splitTerms(m_lastSearch);
+        if (!terms.isEmpty() && searchFullText(terms)) {
+            emit layoutChanged();
+            m_logger->trace("{} [{}] {} full text results in {}ms", m_loggingPrefix, __func__, m_filteredSongs.size(),
+                            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - st).count());
+            return;
         }
-        if (m_settings.ignoreAposInSearch())
+    }
+    const bool ignoreApos = m_settings.ignoreAposInSearch();
+    auto needles = splitTerms(ignoreApos ? QString(m_lastSearch).replace('\'', ' ') : m_lastSearch);
+    auto songMatches = [&](KaraokeSongCatalog::Row row) {
+        if (m_catalog.isDropped(row) || m_catalog.isBad(row))
+            return false;
+        QString haystack = searchHaystack(row, m_searchType);
+        if (ignoreApos && haystack.contains('\''))
             haystack.remove('\'');
-        bool match{true};
-        for (const auto &needle : needles) {
-            if (!haystack.contains(needle)) {
-                match = false;
-                continue;
-            }
+        return std::all_of(needles.begin(), needles.end(), [&haystack](const QString &needle) {
+            return haystack.contains(needle);
+        });
+    };
+    // The index narrows the search down to songs that can match, they still get checked against the
+    // actual search type and apostrophe handling.
+    if (auto candidates = m_searchIndex.candidates(needles); candidates.has_value()) {
+        m_filteredSongs.reserve(candidates->size());
+        for (auto row : *candidates) {
+            if (songMatches(row))
+                m_filteredSongs.emplace_back(row);
+        }
+    } else {
+        m_filteredSongs.reserve(m_allSongs.size());
+        for (auto row : m_allSongs) {
+            if (songMatches(row))
+                m_filteredSongs.emplace_back(row);
         }
-        if (match)
-            m_filteredSongs.emplace_back(song);
     }
     m_filteredSongs.shrink_to_fit();
     emit layoutChanged();
+    m_logger->trace("{} [{}] {} results in {}ms", m_loggingPrefix, __func__, m_filteredSongs.size(),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - st).count());
+}
+
+bool TableModelKaraokeSongs::searchFullText(const QStringList &needles) {
+    DbSongsFts::Column column{DbSongsFts::SearchString};
+    if (m_searchType == SEARCH_TYPE_ARTIST)
+        column = DbSongsFts::Artist;
+    else if (m_searchType == SEARCH_TYPE_TITLE)
+        column = DbSongsFts::Title;
+    QSqlQuery query;
+    query.prepare("SELECT rowid FROM dbsongs_fts WHERE dbsongs_fts MATCH :match ORDER BY rank");
+    query.bindValue(":match", DbSongsFts::matchExpression(needles, column));
+    if (!query.exec()) {
+        m_logger->error("{} Full text search failed, falling back to regular search: {}", m_loggingPrefix,
+                        query.lastError().text().toStdString());
+        m_filteredSongs.clear();
+        return false;
+    }
+    std::vector<KaraokeSongCatalog::Row> matches;
+    while (query.next()) {
+        auto row = m_catalog.rowForId(query.value(0).toInt());
+        if (row != KaraokeSongCatalog::InvalidRow && !m_catalog.isBad(row) && !m_catalog.isDropped(row))
+            matches.emplace_back(row);
+    }
+    if (m_relevanceOrder) {
+        m_filteredSongs = std::move(matches);
+        return true;
+    }
+    std::unordered_set<KaraokeSongCatalog::Row> matched(matches.begin(), matches.end());
+    m_filteredSongs.reserve(matches.size());
+    for (auto row : m_allSongs) {
+        if (matched.count(row) > 0)
+            m_filteredSongs.emplace_back(row);
+    }
+    return true;
+}
+
+void TableModelKaraokeSongs::setFullTextSearch(bool enabled) {
+    if (m_fullTextSearch == enabled)
+        return;
+    m_fullTextSearch = enabled;
+    search(m_lastSearch);
 }
 
 void TableModelKaraokeSongs::setSearchType(TableModelKaraokeSongs::SearchType type) {
@@ -272,42 +367,25 @@ void TableModelKaraokeSongs::setSearchType(TableModelKaraokeSongs::SearchType ty
 }
 
 int TableModelKaraokeSongs::getIdForPath(const QString &path) {
-    auto it = std::find_if(m_allSongs.begin(), m_allSongs.end(), [&](const std::shared_ptr<okj::KaraokeSong> &song) {
-        return (song->path == path);
-    });
-    if (it == m_allSongs.end())
+    auto row = m_catalog.rowForPath(path);
+    if (row == KaraokeSongCatalog::InvalidRow)
         return -1;
-    return it->get()->id;
+    return m_catalog.id(row);
 }
 
 QString TableModelKaraokeSongs::getPath(const int songId) {
-    auto it = std::find_if(m_allSongs.begin(), m_allSongs.end(), [&songId](const std::shared_ptr<okj::KaraokeSong> &song) {
-        return (song->id == songId);
-    });
-    return it->get()->path;
+    auto row = m_catalog.rowForId(songId);
+    if (row == KaraokeSongCatalog::InvalidRow)
+        return {};
+    return m_catalog.path(row);
 }
 
 void TableModelKaraokeSongs::updateSongHistory(const int songId) {
-    auto it = find_if(m_allSongs.begin(), m_allSongs.end(), [&songId](const std::shared_ptr<okj::KaraokeSong> &song) {
-        if (song->id == songId)
-            return true;
-        return false;
-    });
-    if (it != m_allSongs.end()) {
-        it->get()->plays++;
-        it->get()->lastPlay = QDateTime::currentDateTime();
-    }
+    if (auto row = m_catalog.rowForId(songId); row != KaraokeSongCatalog::InvalidRow)
+        m_catalog.recordPlay(row, QDateTime::currentDateTime());
 
-    auto it2 = find_if(m_filteredSongs.begin(), m_filteredSongs.end(),
-                       [&songId](const std::shared_ptr<okj::KaraokeSong> &song) {
-                           if (song->id == songId)
-                               return true;
-                           return false;
-                       });
-    if (it2 != m_filteredSongs.end()) {
-        int row = (int) std::distance(m_filteredSongs.begin(), it2);
+    if (int row = filteredRowForId(songId); row > -1)
         emit dataChanged(this->index(row, COL_PLAYS), this->index(row, COL_LASTPLAY), QVector<int>(Qt::DisplayRole));
-    }
 
     QSqlQuery query;
     query.prepare("UPDATE dbSongs set plays = plays + :incVal, lastplay = :curTs WHERE songid = :songid");
@@ -317,11 +395,11 @@ void TableModelKaraokeSongs::updateSongHistory(const int songId) {
     query.exec();
 }
 
-okj::KaraokeSong &TableModelKaraokeSongs::getSong(const int songId) {
-    auto it = std::find_if(m_allSongs.begin(), m_allSongs.end(), [&songId](const std::shared_ptr<okj::KaraokeSong> &song) {
-        return (song->id == songId);
-    });
-    return **it;
+okj::KaraokeSong TableModelKaraokeSongs::getSong(const int songId) {
+    auto row = m_catalog.rowForId(songId);
+    if (row == KaraokeSongCatalog::InvalidRow)
+        return {};
+    return m_catalog.song(row);
 }
 
 void TableModelKaraokeSongs::resizeIconsForFont(const QFont &font) {
@@ -366,37 +444,34 @@ Qt::ItemFlags TableModelKaraokeSongs::flags(const QModelIndex &index) const {
 
 
 void TableModelKaraokeSongs::sort(int column, Qt::SortOrder order) {
-    auto sortLambda = [&column](const std::shared_ptr<okj::KaraokeSong> &a, const std::shared_ptr<okj::KaraokeSong> &b) -> bool {
+    auto sortLambda = [this, &column](KaraokeSongCatalog::Row a, KaraokeSongCatalog::Row b) -> bool {
+        int cmp;
         switch (column) {
             case COL_ARTIST:
-                if (a->artistL == b->artistL) {
-                    if (a->titleL == b->titleL) {
-                        return (a->songidL < b->songidL);
-                    }
-                    return (a->titleL < b->titleL);
-                }
-                return (a->artistL < b->artistL);
+                if ((cmp = m_catalog.compare(a, b, KaraokeSongCatalog::Artist)) != 0)
+                    return cmp < 0;
+                if ((cmp = m_catalog.compare(a, b, KaraokeSongCatalog::Title)) != 0)
+                    return cmp < 0;
+                return m_catalog.compare(a, b, KaraokeSongCatalog::SongId) < 0;
             case COL_TITLE:
-                if (a->titleL == b->titleL) {
-                    if (a->artistL == b->artistL) {
-                        return (a->songidL < b->songidL);
-                    }
-                    return (a->artistL < b->artistL);
-                }
-                return (a->titleL < b->titleL);
+                if ((cmp = m_catalog.compare(a, b, KaraokeSongCatalog::Title)) != 0)
+                    return cmp < 0;
+                if ((cmp = m_catalog.compare(a, b, KaraokeSongCatalog::Artist)) != 0)
+                    return cmp < 0;
+                return m_catalog.compare(a, b, KaraokeSongCatalog::SongId) < 0;
             case COL_SONGID:
-                return (a->songidL < b->songidL);
+                return m_catalog.compare(a, b, KaraokeSongCatalog::SongId) < 0;
             case COL_FILENAME:
-                return (a->filename.toLower() < b->filename.toLower());
+                return m_catalog.compare(a, b, KaraokeSongCatalog::Filename) < 0;
             case COL_DURATION:
-                return (a->duration < b->duration);
+                return (m_catalog.duration(a) < m_catalog.duration(b));
             case COL_PLAYS:
-                return (a->plays < b->plays);
+                return (m_catalog.plays(a) < m_catalog.plays(b));
             case COL_LASTPLAY:
-                return (a->lastPlay < b->lastPlay);
+                return (m_catalog.lastPlay(a) < m_catalog.lastPlay(b));
 
             default:
-                return (a->id < b->id);
+                return (m_catalog.id(a) < m_catalog.id(b));
         }
     };
 
@@ -406,26 +481,19 @@ void TableModelKaraokeSongs::sort(int column, Qt::SortOrder order) {
     } else {
         std::sort(m_allSongs.rbegin(), m_allSongs.rend(), sortLambda);
     }
+    m_searchIndex.setOrder(m_allSongs);
+    m_relevanceOrder = false;
     QApplication::restoreOverrideCursor();
     search(m_lastSearch);
 }
 
 void TableModelKaraokeSongs::setSongDuration(const QString &path, unsigned int duration) {
-    auto it = find_if(m_allSongs.begin(), m_allSongs.end(), [&path](const std::shared_ptr<okj::KaraokeSong> &song) {
-        return (song->path == path);
-    });
-    if (it == m_allSongs.end())
+    auto catalogRow = m_catalog.rowForPath(path);
+    if (catalogRow == KaraokeSongCatalog::InvalidRow)
         return;
-    it->get()->duration = static_cast<int>(duration);
-    int songId = it->get()->id;
-    auto it2 = find_if(m_filteredSongs.begin(), m_filteredSongs.end(),
-                       [&songId](const std::shared_ptr<okj::KaraokeSong> &song) {
-                           return (song->id == songId);
-                       });
-    if (it2 != m_filteredSongs.end()) {
-        int row = (int) std::distance(m_filteredSongs.begin(), it2);
+    m_catalog.setDuration(catalogRow, static_cast<int>(duration));
+    if (int row = filteredRowForId(m_catalog.id(catalogRow)); row > -1)
         emit dataChanged(this->index(row, COL_DURATION), this->index(row, COL_DURATION), QVector<int>(Qt::DisplayRole));
-    }
 }
 
 void TableModelKaraokeSongs::markSongBad(QString path) {
@@ -434,20 +502,15 @@ void TableModelKaraokeSongs::markSongBad(QString path) {
     query.bindValue(":path", path);
     query.exec();
 
+    auto catalogRow = m_catalog.rowForPath(path);
+    if (catalogRow == KaraokeSongCatalog::InvalidRow)
+        return;
     emit layoutAboutToBeChanged();
-    auto newFilteredEnd = std::remove_if(m_filteredSongs.begin(), m_filteredSongs.end(),
-                                         [&path](const std::shared_ptr<okj::KaraokeSong> &song) {
-                                             return (song->path == path);
-                                         });
-    m_filteredSongs.erase(newFilteredEnd, m_filteredSongs.end());
+    m_filteredSongs.erase(std::remove(m_filteredSongs.begin(), m_filteredSongs.end(), catalogRow), m_filteredSongs.end());
     emit layoutChanged();
 
-    auto songEntry = std::find_if(m_allSongs.begin(), m_allSongs.end(),
-                                         [&path](const std::shared_ptr<okj::KaraokeSong> &song) {
-                                             return (song->path == path);
-                                         });
-    if (songEntry != m_allSongs.end())
-        songEntry->get()->bad = true;
+    m_catalog.setBad(catalogRow);
+    m_searchIndex.removeSong(catalogRow);
 }
 
 TableModelKaraokeSongs::DeleteStatus TableModelKaraokeSongs::removeBadSong(QString path) {
@@ -464,19 +527,14 @@ TableModelKaraokeSongs::DeleteStatus TableModelKaraokeSongs::removeBadSong(QStri
         query.bindValue(":path", path);
         query.exec();
 
-        emit layoutAboutToBeChanged();
-        auto newFilteredEnd = std::remove_if(m_filteredSongs.begin(), m_filteredSongs.end(),
-                                             [&path](const std::shared_ptr<okj::KaraokeSong> &song) {
-                                                 return (song->path == path);
-                                             });
-        m_filteredSongs.erase(newFilteredEnd, m_filteredSongs.end());
-
-        emit layoutChanged();
-        auto newAllSongsEnd = std::remove_if(m_allSongs.begin(), m_allSongs.end(),
-                                             [&path](const std::shared_ptr<okj::KaraokeSong> &song) {
-                                                 return (song->path == path);
-                                             });
-        m_allSongs.erase(newAllSongsEnd, m_allSongs.end());
+        for (auto row = m_catalog.rowForPath(path); row != KaraokeSongCatalog::InvalidRow; row = m_catalog.rowForPath(path)) {
+            emit layoutAboutToBeChanged();
+            m_filteredSongs.erase(std::remove(m_filteredSongs.begin(), m_filteredSongs.end(), row), m_filteredSongs.end());
+            emit layoutChanged();
+            m_allSongs.erase(std::remove(m_allSongs.begin(), m_allSongs.end(), row), m_allSongs.end());
+            m_searchIndex.removeSong(row);
+            m_catalog.remove(row);
+        }
 
         if (isCdg) {
             if (!QFile::remove(mediaFile)) {
@@ -542,7 +600,9 @@ int TableModelKaraokeSongs::addSong(okj::KaraokeSong song) {
     } else {
         int lastInsertId = query.lastInsertId().toInt();
         song.id = lastInsertId;
-        m_allSongs.push_back(std::make_shared<okj::KaraokeSong>(song));
+        auto row = m_catalog.append(song);
+        m_allSongs.emplace_back(row);
+        indexSong(row);
         search(m_lastSearch);
         return lastInsertId;
     }
@@ -10,6 +10,8 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/async_logger.h>
 #include "okjtypes.h"
+#include "songsearchindex.h"
+#include "karaokesongcatalog.h"
 
 
 
@@ -52,18 +54,23 @@ public:
     int getIdForPath(const QString &path);
     QString getPath(int songId);
     void updateSongHistory(int songId);
-    okj::KaraokeSong &getSong(int songId);
+    okj::KaraokeSong getSong(int songId);
     void markSongBad(QString path);
     DeleteStatus removeBadSong(QString path);
     QString findCdgAudioFile(const QString& path);
     int addSong(okj::KaraokeSong song);
+    void setFullTextSearch(bool enabled);
 
 
 private:
     std::string m_loggingPrefix{"[KaraokeSongsModel]"};
     std::shared_ptr<spdlog::logger> m_logger;
-    std::vector<std::shared_ptr<okj::KaraokeSong>> m_filteredSongs;
-    std::vector< std::shared_ptr<okj::KaraokeSong> > m_allSongs;
+    KaraokeSongCatalog m_catalog;
+    std::vector<KaraokeSongCatalog::Row> m_filteredSongs;
+    std::vector<KaraokeSongCatalog::Row> m_allSongs;
+    SongSearchIndex m_searchIndex;
+    bool m_fullTextSearch{false};
+    bool m_relevanceOrder{false};
     QString m_lastSearch;
     int m_curFontHeight{0};
     QImage m_iconCdg;
@@ -78,6 +85,10 @@ private:
     QTimer searchTimer{this};
 
     void searchExec();
+    [[nodiscard]] QString searchHaystack(KaraokeSongCatalog::Row row, SearchType type) const;
+    [[nodiscard]] int filteredRowForId(int songId) const;
+    void indexSong(KaraokeSongCatalog::Row row);
+    bool searchFullText(const QStringList &needles);
     static QVariant getColumnName(int section) ;
     [[nodiscard]] QVariant getColumnSizeHint(int section) const;
     [[nodiscard]] QVariant getItemDisplayData(const QModelIndex &index) const;
@@ -188,6 +188,29 @@ bool TableModelQueueSongs::getPlayed(const int songId) {
     return it->played;
 }
 
+okj::QueueSummary TableModelQueueSongs::summary() const {
+    okj::QueueSummary summary;
+    for (const auto &song : m_songs) {
+        if (song.played) {
+            summary.songsSung++;
+            continue;
+        }
+        summary.songsUnsung++;
+        if (!summary.hasNextSong) {
+            summary.hasNextSong = true;
+            summary.nextSongArtist = song.artist;
+            summary.nextSongTitle = song.title;
+            summary.nextSongDuration = song.duration;
+        }
+    }
+    return summary;
+}
+
+void TableModelQueueSongs::emitQueueModified() {
+    emit queueSummaryChanged(m_curSingerId, summary());
+    emit queueModified(m_curSingerId);
+}
+
 int TableModelQueueSongs::getKey(const int songId) {
     auto it = std::find_if(m_songs.begin(), m_songs.end(), [&songId](okj::QueueSong &song) {
         return (song.id == songId);
@@ -223,7 +246,7 @@ void TableModelQueueSongs::move(const int oldPosition, const int newPosition) {
     });
     emit layoutChanged();
     commitChanges();
-    emit queueModified(m_curSingerId);
+    emitQueueModified();
 }
 
 void TableModelQueueSongs::moveSongId(const int songId, const int newPosition) {
@@ -257,7 +280,7 @@ int TableModelQueueSongs::add(const int songId) {
             ksong.path
     });
     emit layoutChanged();
-    emit queueModified(m_curSingerId);
+    emitQueueModified();
     return queueSongId;
 }
 
@@ -278,7 +301,7 @@ void TableModelQueueSongs::remove(const int songId) {
     });
     emit layoutChanged();
     commitChanges();
-    emit queueModified(m_curSingerId);
+    emitQueueModified();
 }
 
 void TableModelQueueSongs::setKey(const int songId, const int semitones) {
@@ -307,12 +330,19 @@ void TableModelQueueSongs::setPlayed(const int songId, const bool played) {
     auto it = std::find_if(m_songs.begin(), m_songs.end(), [&songId](okj::QueueSong &song) {
         return (song.id == songId);
     });
-    if (it == m_songs.end())
+    if (it == m_songs.end()) {
+        // Song belongs to a singer whose queue isn't loaded, let listeners reload theirs
+        query.prepare("SELECT singer FROM queuesongs WHERE qsongid = :id");
+        query.bindValue(":id", songId);
+        query.exec();
+        if (query.first())
+            emit queueModified(query.value(0).toInt());
         return;
+    }
     it->played = played;
     emit dataChanged(this->index(it->position, 0), this->index(it->position, columnCount() - 1),
                      QVector<int>{Qt::FontRole, Qt::BackgroundRole, Qt::ForegroundRole});
-    emit queueModified(m_curSingerId);
+    emitQueueModified();
 }
 
 void TableModelQueueSongs::removeAll() {
@@ -324,7 +354,7 @@ void TableModelQueueSongs::removeAll() {
     m_songs.clear();
     m_songs.shrink_to_fit();
     emit layoutChanged();
-    emit queueModified(m_curSingerId);
+    emitQueueModified();
 }
 
 void TableModelQueueSongs::commitChanges() {
@@ -372,6 +402,7 @@ void TableModelQueueSongs::songAddSlot(int songId, int singerId, int keyChg) {
         query.exec();
         if (auto error = query.lastError(); error.type() != QSqlError::NoError)
             m_logger->error("{} DB error: {}", m_loggingPrefix, error.text());
+        emit queueModified(singerId);
     }
 }
 
@@ -532,6 +563,7 @@ void TableModelQueueSongs::sort(int column, Qt::SortOrder order) {
     });
     emit layoutChanged();
     commitChanges();
+    emitQueueModified();
 }
 
 void TableModelQueueSongs::setFont(const QFont &font) {
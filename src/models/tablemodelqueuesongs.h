@@ -55,6 +55,7 @@ public:
     [[nodiscard]] int getPosition(int songId);
     [[nodiscard]] bool getPlayed(int songId);
     [[nodiscard]] int getKey(int songId);
+    [[nodiscard]] okj::QueueSummary summary() const;
     void move(int oldPosition, int newPosition);
     void moveSongId(int songId, int newPosition);
     int add(int songId);
@@ -82,11 +83,13 @@ private:
     [[nodiscard]] static QVariant getColumnTextAlignmentRoleData(int column);
     [[nodiscard]] static QString getColumnName(int section);
     [[nodiscard]] QSize getColumnSizeHint(int section) const;
+    void emitQueueModified();
 
 
 
 signals:
     void queueModified(int singerId);
+    void queueSummaryChanged(int singerId, const okj::QueueSummary &summary);
     void songDroppedWithoutSinger();
     void filesDroppedOnSinger(QList<QUrl> urls, int singerId, int position);
     void qSongsMoved(int startRow, int startCol, int endRow, int endCol);
@@ -19,6 +19,8 @@
 */
 
 #include "tablemodelrotation.h"
+#include <QCoreApplication>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDateTime>
@@ -37,6 +39,23 @@ TableModelRotation::TableModelRotation(QObject *parent)
     m_logger = spdlog::get("logger");
     resizeIconsForFont(m_settings.applicationFont());
     m_rotationTopSingerId = m_settings.lastRunRotationTopSingerId();
+    // Every change to singer order goes through a layout change
+    connect(this, &QAbstractItemModel::layoutChanged, this, [&]() { m_waitPrefixDirty = true; });
+    m_writer = new RotationDbWriter;
+    m_writerThread.setObjectName("RotationDbWriter");
+    m_writer->moveToThread(&m_writerThread);
+    connect(&m_writerThread, &QThread::finished, m_writer, &QObject::deleteLater);
+    m_writerThread.start();
+    m_commitTimer.setSingleShot(true);
+    m_commitTimer.setInterval(250);
+    connect(&m_commitTimer, &QTimer::timeout, this, &TableModelRotation::commitChanges);
+}
+
+TableModelRotation::~TableModelRotation() {
+    if (!waitForCommit())
+        m_logger->error("{} Unable to write the last rotation changes to db on disk before closing", m_loggingPrefix);
+    m_writerThread.quit();
+    m_writerThread.wait();
 }
 
 QVariant TableModelRotation::headerData(int section, Qt::Orientation orientation, int role) const {
@@ -115,7 +134,7 @@ QVariant TableModelRotation::getBackgroundRole(const QModelIndex &index) const {
         const auto &singer = m_singers.at(index.row());
         if (singer.id == m_rotationTopSingerId && m_settings.rotationAltSortOrder())
             return QColor("green");
-        if (singer.numSongsSung() == 0)
+        if (queueSummary(singer.id).songsSung == 0)
             return QColor(140, 30, 150);
     }
     return {};
@@ -123,7 +142,7 @@ QVariant TableModelRotation::getBackgroundRole(const QModelIndex &index) const {
 
 QVariant TableModelRotation::getDecorationRole(const QModelIndex &index) const {
     if (index.column() == COL_NAME) {
-        if (getSinger(index.data(Qt::UserRole).toInt()).numSongsUnsung() > 0)
+        if (queueSummary(m_singers.at(index.row()).id).songsUnsung > 0)
             return m_iconGreenCircle;
         return m_iconYellowCircle;
     }
@@ -157,8 +176,12 @@ QVariant TableModelRotation::getDisplayData(const QModelIndex &index) const {
         case COL_ADDTS:
             return m_singers.at(index.row()).addTs;
         case COL_NEXT_SONG:
-            if (m_settings.rotationShowNextSong())
-                return m_singers.at(index.row()).nextSongArtistTitle();
+            if (m_settings.rotationShowNextSong()) {
+                const auto &summary = queueSummary(m_singers.at(index.row()).id);
+                if (summary.hasNextSong)
+                    return summary.nextSongArtist + " - " + summary.nextSongTitle;
+                return " - empty - ";
+            }
             return {};
         default:
             return {};
@@ -169,8 +192,9 @@ QVariant TableModelRotation::getTooltipData(const QModelIndex &index) const {
     QString toolTipText;
     int totalWaitDuration = 0;
     const auto &singer = m_singers.at(index.row());
-    QString qSongsSung = QString::number(singer.numSongsSung());
-    QString qSongsUnsung = QString::number(singer.numSongsUnsung());
+    const auto &summary = queueSummary(singer.id);
+    QString qSongsSung = QString::number(summary.songsSung);
+    QString qSongsUnsung = QString::number(summary.songsUnsung);
     QString singerDistance = QString::number(positionTurnDistance(index.row()));
     if (m_currentSingerId == singer.id) {
         toolTipText = "Current singer - Sung: " + qSongsSung + " - Unsung: " + qSongsUnsung;
@@ -207,6 +231,7 @@ QString TableModelRotation::getWaitTimeString(int totalWaitDuration) {
 
 void TableModelRotation::loadData() {
     m_logger->debug("{} loading rotation data from DB on disk", m_loggingPrefix);
+    waitForCommit();
     emit layoutAboutToBeChanged();
     m_singers.clear();
     QSqlQuery query;
@@ -223,36 +248,121 @@ void TableModelRotation::loadData() {
                 query.value(4).toDateTime()
         });
     }
+    loadQueueSummaries();
     emit layoutChanged();
     m_logger->debug("{} loaded {} rotation singers", m_loggingPrefix, m_singers.size());
 }
 
-void TableModelRotation::commitChanges() {
-    m_logger->trace("{} [{}] Called", m_loggingPrefix, __func__);
+void TableModelRotation::loadQueueSummaries() {
     auto st = std::chrono::high_resolution_clock::now();
+    m_queueSummaries = queryQueueSummaries();
+    m_waitPrefixDirty = true;
+    m_logger->trace("{} [{}] finished in {}ms", m_loggingPrefix, __func__,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - st).count());
+}
+
+void TableModelRotation::refreshQueueSummary(const int singerId) {
+    auto summaries = queryQueueSummaries(singerId);
+    setQueueSummary(singerId, summaries[singerId]);
+}
+
+void TableModelRotation::setQueueSummary(const int singerId, const okj::QueueSummary &summary) {
+    m_queueSummaries[singerId] = summary;
+    m_waitPrefixDirty = true;
+    if (const auto &singer = getSinger(singerId); singer.isValid())
+        emit dataChanged(this->index(singer.position, 0), this->index(singer.position, columnCount(QModelIndex()) - 1));
+}
 
-    m_logger->debug("{} Committing db changes to disk", m_loggingPrefix);
+const okj::QueueSummary &TableModelRotation::queueSummary(const int singerId) const {
+    static const okj::QueueSummary emptySummary;
+    if (auto it = m_queueSummaries.find(singerId); it != m_queueSummaries.end())
+        return it->second;
+    return emptySummary;
+}
+
+std::unordered_map<int, okj::QueueSummary> TableModelRotation::queryQueueSummaries(const int singerId) {
+    std::unordered_map<int, okj::QueueSummary> summaries;
     QSqlQuery query;
-    query.exec("BEGIN TRANSACTION");
-    query.exec("DELETE FROM rotationsingers");
-    query.prepare(
-            "INSERT INTO rotationsingers (singerid,name,position,regular,regularid,addts) VALUES(:singerid,:name,:pos,:regular,:regularid,:addts)");
-    for (const auto &singer: m_singers) {
-        query.bindValue(":singerid", singer.id);
-        query.bindValue(":name", singer.name);
-        query.bindValue(":pos", singer.position);
-        query.bindValue(":regular", singer.regular);
-        query.bindValue(":regularid", -1);
-        query.bindValue(":addts", singer.addTs);
-        query.exec();
-    }
-    query.exec("COMMIT");
+    QString sql{"SELECT queuesongs.singer, queuesongs.played, dbsongs.songid, dbsongs.artist, dbsongs.title, "
+                "dbsongs.duration FROM queuesongs LEFT JOIN dbsongs ON dbsongs.songid = queuesongs.song "};
+    if (singerId != -1)
+        sql += "WHERE queuesongs.singer = :singerId ";
+    query.prepare(sql + "ORDER BY queuesongs.singer, queuesongs.position");
+    query.bindValue(":singerId", singerId);
+    query.exec();
     if (auto lastError = query.lastError(); lastError.type() != QSqlError::NoError)
-        m_logger->error("{} Commit error! Unable to write rotation changes to db on disk! Error: {}", m_loggingPrefix,
-                        lastError.text());
-    else
-        m_logger->debug("{} Commit completed successfully", m_loggingPrefix);
+        spdlog::get("logger")->error("[RotationModel] DB error! Unable to load queue summaries! Error: {}",
+                                     lastError.text().toStdString());
+    while (query.next()) {
+        auto &summary = summaries[query.value(0).toInt()];
+        if (query.value(1).toBool()) {
+            summary.songsSung++;
+            continue;
+        }
+        summary.songsUnsung++;
+        if (!summary.hasNextSong && !query.value(2).isNull()) {
+            summary.hasNextSong = true;
+            summary.nextSongArtist = query.value(3).toString();
+            summary.nextSongTitle = query.value(4).toString();
+            summary.nextSongDuration = query.value(5).toInt();
+        }
+    }
+    return summaries;
+}
+
+int TableModelRotation::nextSongDurationSecs(const okj::QueueSummary &summary) const {
+    if (summary.hasNextSong)
+        return (summary.nextSongDuration / 1000) + m_waitEstimation.singerPad;
+    else if (!m_waitEstimation.skipEmptySingers)
+        return m_waitEstimation.emptySongLength + m_waitEstimation.singerPad;
+    return 0;
+}
 
+const std::vector<int> &TableModelRotation::waitPrefix() const {
+    WaitEstimation estimation{
+            m_settings.estimationSingerPad(),
+            m_settings.estimationEmptySongLength(),
+            m_settings.estimationSkipEmptySingers()
+    };
+    if (!m_waitPrefixDirty && estimation == m_waitEstimation && m_waitPrefix.size() == m_singers.size() + 1)
+        return m_waitPrefix;
+    m_waitEstimation = estimation;
+    m_waitPrefix.resize(m_singers.size() + 1);
+    m_waitPrefix[0] = 0;
+    for (size_t i = 0; i < m_singers.size(); i++)
+        m_waitPrefix[i + 1] = m_waitPrefix[i] + nextSongDurationSecs(queueSummary(m_singers[i].id));
+    m_waitPrefixDirty = false;
+    return m_waitPrefix;
+}
+
+void TableModelRotation::commitChanges() {
+    m_commitTimer.stop();
+    if (m_changedSingers.empty() && m_deletedSingers.empty())
+        return;
+    auto st = std::chrono::high_resolution_clock::now();
+    std::vector<RotationSingerRow> changed;
+    changed.reserve(m_changedSingers.size());
+    for (const auto &singer: m_singers) {
+        if (m_changedSingers.count(singer.id) > 0)
+            changed.emplace_back(RotationSingerRow{singer.id, singer.name, singer.position, singer.regular});
+    }
+    std::vector<int> deleted(m_deletedSingers.begin(), m_deletedSingers.end());
+    m_changedSingers.clear();
+    m_deletedSingers.clear();
+    m_logger->debug("{} Committing {} changed and {} deleted singers to disk", m_loggingPrefix, changed.size(),
+                    deleted.size());
+    QMetaObject::invokeMethod(m_writer, [this, writer = m_writer, dbFileName = QSqlDatabase::database().databaseName(),
+                                         changed = std::move(changed), deleted = std::move(deleted)]() {
+        if (writer->write(dbFileName, changed, deleted))
+            return;
+        std::vector<int> changedIds;
+        changedIds.reserve(changed.size());
+        for (const auto &singer : changed)
+            changedIds.push_back(singer.singerId);
+        QMetaObject::invokeMethod(this, [this, changedIds = std::move(changedIds), deleted]() {
+            requeueBatch(changedIds, deleted);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
     m_logger->trace("{} [{}] finished in {}ms",
                     m_loggingPrefix,
                     __func__,
@@ -260,6 +370,44 @@ void TableModelRotation::commitChanges() {
     );
 }
 
+bool TableModelRotation::waitForCommit() {
+    commitChanges();
+    // Queued calls run in order, so once this returns every earlier batch is on disk or was handed back. The database
+    // is in WAL mode, the writer only waits on other writers here, not on read cursors of the main connection.
+    QMetaObject::invokeMethod(m_writer, []() {}, Qt::BlockingQueuedConnection);
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    return m_changedSingers.empty() && m_deletedSingers.empty();
+}
+
+void TableModelRotation::requeueBatch(const std::vector<int> &changed, const std::vector<int> &deleted) {
+    // Rows are written as they are in the model at the next commit, so later edits of these singers are kept
+    for (auto singerId : changed) {
+        if (getSinger(singerId).isValid())
+            m_changedSingers.insert(singerId);
+    }
+    m_deletedSingers.insert(deleted.begin(), deleted.end());
+    m_logger->warn("{} Retrying {} changed and {} deleted singers that couldn't be written", m_loggingPrefix,
+                   changed.size(), deleted.size());
+    scheduleCommit();
+}
+
+void TableModelRotation::scheduleCommit() {
+    // Coalesces bursts of edits, like dragging a singer through the rotation, into one write
+    if (!m_commitTimer.isActive())
+        m_commitTimer.start();
+}
+
+void TableModelRotation::recordChange(const int singerId) {
+    m_changedSingers.insert(singerId);
+}
+
+void TableModelRotation::recordPositionChanges(int firstPosition, int lastPosition) {
+    firstPosition = std::max(firstPosition, 0);
+    lastPosition = std::min(lastPosition, static_cast<int>(m_singers.size()) - 1);
+    for (int pos = firstPosition; pos <= lastPosition; pos++)
+        recordChange(m_singers.at(pos).id);
+}
+
 int TableModelRotation::singerAdd(const QString &name, const int positionHint) {
     m_logger->trace("{} [{}] Called with ({}, {})", m_loggingPrefix, __func__, name, positionHint);
     auto st = std::chrono::high_resolution_clock::now();
@@ -267,6 +415,10 @@ int TableModelRotation::singerAdd(const QString &name, const int positionHint) {
     m_logger->debug("{} Adding singer {} to rotation using positionHint {}", m_loggingPrefix, name, positionHint);
     auto curTs = QDateTime::currentDateTime();
     int addPos = static_cast<int>(m_singers.size());
+    // The insert goes straight to disk. Position changes still queued for m_writer have to be on disk first, or the
+    // new singer could share a position with one of them if the process died before they were written.
+    if (!waitForCommit())
+        m_logger->warn("{} Adding singer while earlier rotation changes are still waiting to be retried", m_loggingPrefix);
     QSqlQuery query;
     query.prepare(
             "INSERT INTO rotationsingers (name,position,regular,regularid,addts) VALUES(:name,:pos,:regular,:regularid,:addts)");
@@ -371,8 +523,9 @@ void TableModelRotation::singerMove(const int oldPosition, const int newPosition
     std::sort(m_singers.begin(), m_singers.end(), [](okj::RotationSinger &a, okj::RotationSinger &b) {
         return (a.position < b.position);
     });
+    recordPositionChanges(std::min(oldPosition, newPosition), std::max(oldPosition, newPosition));
     if (!skipCommit)
-        commitChanges();
+        scheduleCommit();
 
     emit layoutChanged();
 
@@ -407,14 +560,8 @@ void TableModelRotation::singerSetName(const int singerId, const QString &newNam
     it->name = newName;
     emit dataChanged(this->index(it->position, COL_NAME), this->index(it->position, COL_NAME),
                      QVector<int>{Qt::DisplayRole});
-    QSqlQuery query;
-    query.prepare("UPDATE rotationsingers SET name = :name WHERE singerid = :singerid");
-    query.bindValue(":name", newName);
-    query.bindValue(":singerid", singerId);
-    query.exec();
-    if (auto lastError = query.lastError(); lastError.type() != QSqlError::NoError)
-        m_logger->error("{} DB error! Unable to write rotation changes to db on disk! Error: {}", m_loggingPrefix,
-                        lastError.text());
+    recordChange(singerId);
+    scheduleCommit();
     emit rotationModified();
     outputRotationDebug();
 }
@@ -431,18 +578,23 @@ void TableModelRotation::singerDelete(const int singerId) {
         m_settings.setLastRunRotationTopSingerId(m_rotationTopSingerId);
     }
 
+    const int deletedPosition = getSinger(singerId).position;
     emit layoutAboutToBeChanged();
     auto it = std::remove_if(m_singers.begin(), m_singers.end(), [&singerId](okj::RotationSinger &singer) {
         return (singer.id == singerId);
     });
     m_singers.erase(it, m_singers.end());
+    m_queueSummaries.erase(singerId);
     int pos{0};
     for (auto &singer: m_singers) {
         singer.position = pos++;
     }
+    m_changedSingers.erase(singerId);
+    m_deletedSingers.insert(singerId);
+    recordPositionChanges(deletedPosition, static_cast<int>(m_singers.size()) - 1);
     emit layoutChanged();
     emit rotationModified();
-    commitChanges();
+    scheduleCommit();
     outputRotationDebug();
 }
 
@@ -460,15 +612,8 @@ void TableModelRotation::singerSetRegular(const int singerId, const bool isRegul
     it->regular = isRegular;
     emit dataChanged(this->index(it->position, COL_REGULAR), this->index(it->position, COL_REGULAR),
                      QVector<int>{Qt::DisplayRole});
-    QSqlQuery query;
-    query.prepare("UPDATE rotationsingers SET regular = :regular WHERE singerid = :singerid");
-    query.bindValue(":regular", isRegular);
-    query.bindValue(":singerid", singerId);
-    query.exec();
-    if (auto lastError = query.lastError(); lastError.type() != QSqlError::NoError) {
-        m_logger->error("{} DB error! Unable to write rotation changes to db on disk! Error: {}", m_loggingPrefix,
-                        lastError.text());
-    }
+    recordChange(singerId);
+    scheduleCommit();
 }
 
 void TableModelRotation::singerMakeRegular(const int singerId) {
@@ -510,11 +655,7 @@ QStringList TableModelRotation::historySingers() const {
 }
 
 int TableModelRotation::rotationDuration() const {
-    int secs = 0;
-    for (const auto &singer: m_singers) {
-        secs += singer.nextSongDurationSecs();
-    }
-    return secs;
+    return waitPrefix().back();
 }
 
 void TableModelRotation::clearRotation() {
@@ -530,6 +671,10 @@ void TableModelRotation::clearRotation() {
         m_logger->error("{} DB error! Error occurred while clearing the rotation singers db table on disk! Error: {}",
                         m_loggingPrefix, lastError.text());
     m_singers.clear();
+    m_queueSummaries.clear();
+    m_changedSingers.clear();
+    m_deletedSingers.clear();
+    m_commitTimer.stop();
     m_settings.setCurrentRotationPosition(-1);
     m_currentSingerId = -1;
     emit layoutChanged();
@@ -579,8 +724,9 @@ void TableModelRotation::fixSingerPositions() {
     for (auto &singer: m_singers) {
         singer.position = pos++;
     }
+    recordPositionChanges(0, static_cast<int>(m_singers.size()) - 1);
     emit layoutChanged();
-    commitChanges();
+    scheduleCommit();
     m_logger->error("{} Repair complete", m_loggingPrefix);
 }
 
@@ -719,7 +865,7 @@ bool TableModelRotation::dropMimeData(const QMimeData *data, Qt::DropAction acti
         for (const auto &val: ids) {
             singerMove(getSinger(val.toInt()).position, static_cast<int>(dropRow), true);
         }
-        commitChanges();
+        scheduleCommit();
         emit rotationModified();
         if (dropRow == m_singers.size() - 1) {
             // moving to bottom
@@ -814,44 +960,13 @@ int TableModelRotation::positionWaitTime(int position) const {
         return 0;
 
     const auto &curSinger = getSinger(m_currentSingerId);
-    const auto &singer = getSingerAtPosition(position);
-    int totalWaitDuration{0};
-
-    if (curSinger.position == singer.position)
+    if (curSinger.position == position)
         return 0;
 
-    if (curSinger.position < singer.position) {
-        for (int i = curSinger.position; i < singer.position; i++) {
-            const auto &loopSinger = getSingerAtPosition(i);
-            if (i == curSinger.position) {
-                totalWaitDuration += m_remainSecs;
-            } else if (loopSinger.id != singer.id) {
-                int nextDuration = loopSinger.nextSongDurationSecs();
-                totalWaitDuration += nextDuration;
-            }
-        }
-        return totalWaitDuration;
-    }
-
-    if (curSinger.position > singer.position) {
-        for (int i = 0; i < singer.position; i++) {
-            const auto &loopSinger = getSingerAtPosition(i);
-            if (loopSinger.id != singer.id) {
-                int nextDuration = loopSinger.nextSongDurationSecs();
-                totalWaitDuration += nextDuration;
-            }
-        }
-        for (int i = curSinger.position; i < m_singers.size(); i++) {
-            const auto &loopSinger = getSingerAtPosition(i);
-            if (i == curSinger.position)
-                totalWaitDuration += 240;
-            else if (loopSinger.id != singer.id) {
-                int nextDuration = loopSinger.nextSongDurationSecs();
-                totalWaitDuration += nextDuration;
-            }
-        }
-        return totalWaitDuration;
-    }
-
-    return 0;
+    // Everyone between the current singer and this one sings their next song, the current singer
+    // only has what's left of theirs
+    const auto &prefix = waitPrefix();
+    if (curSinger.position < position)
+        return m_remainSecs + prefix[position] - prefix[curSinger.position + 1];
+    return prefix[position] + 240 + prefix[m_singers.size()] - prefix[curSinger.position + 1];
 }
@@ -27,10 +27,15 @@
 #include <QImage>
 #include <QItemDelegate>
 #include <QPainter>
+#include <QThread>
+#include <QTimer>
 #include <spdlog/async_logger.h>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include "settings.h"
 #include "../okjtypes.h"
+#include "rotationdbwriter.h"
 
 class ItemDelegateRotation : public QItemDelegate
 {
@@ -70,6 +75,7 @@ public:
         false
     };
     explicit TableModelRotation(QObject *parent = nullptr);
+    ~TableModelRotation() override;
     [[nodiscard]] QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
     [[nodiscard]] int rowCount(const QModelIndex &parent) const override;
     [[nodiscard]] int columnCount(const QModelIndex &parent) const override;
@@ -94,8 +100,13 @@ public:
     [[nodiscard]] bool singerExists(const QString &name) const;
     [[nodiscard]] QStringList singers() const;
     [[nodiscard]] int singerTurnDistance(int singerId) const;
+    [[nodiscard]] const okj::QueueSummary& queueSummary(int singerId) const;
     void loadData();
+    void loadQueueSummaries();
+    void refreshQueueSummary(int singerId);
+    void setQueueSummary(int singerId, const okj::QueueSummary &summary);
     void commitChanges();
+    bool waitForCommit();
     int singerAdd(const QString& name, int positionHint = ADD_BOTTOM);
     void singerMove(int oldPosition, int newPosition, bool skipCommit = false);
     void singerSetName(int singerId, const QString &newName);
@@ -122,6 +133,30 @@ private:
     int m_curFontHeight{0};
     int m_remainSecs{0};
     Settings m_settings;
+    // Singers changed or deleted since the last commit, written out in one batch by m_writer
+    std::unordered_set<int> m_changedSingers;
+    std::unordered_set<int> m_deletedSingers;
+    QTimer m_commitTimer;
+    QThread m_writerThread;
+    RotationDbWriter *m_writer{nullptr};
+    void recordChange(int singerId);
+    void recordPositionChanges(int firstPosition, int lastPosition);
+    void scheduleCommit();
+    void requeueBatch(const std::vector<int> &changed, const std::vector<int> &deleted);
+    std::unordered_map<int, okj::QueueSummary> m_queueSummaries;
+    // m_waitPrefix[i] is the estimated time it takes the singers at positions 0 to i-1 to sing their next song
+    mutable std::vector<int> m_waitPrefix;
+    mutable bool m_waitPrefixDirty{true};
+    struct WaitEstimation {
+        int singerPad{0};
+        int emptySongLength{0};
+        bool skipEmptySingers{false};
+        bool operator==(const WaitEstimation &other) const = default;
+    };
+    mutable WaitEstimation m_waitEstimation;
+    [[nodiscard]] int nextSongDurationSecs(const okj::QueueSummary &summary) const;
+    [[nodiscard]] const std::vector<int>& waitPrefix() const;
+    [[nodiscard]] static std::unordered_map<int, okj::QueueSummary> queryQueueSummaries(int singerId = -1);
     [[nodiscard]] QVariant getTooltipData(const QModelIndex &index) const;
     [[nodiscard]] QVariant getDisplayData(const QModelIndex &index) const;
     [[nodiscard]] QVariant getColumnSizeHint(const QModelIndex &index) const;
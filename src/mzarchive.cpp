@@ -28,6 +28,77 @@
 #include <io.h>
 #endif
 
+namespace {
+
+// Gives miniz random access to the zip through a QFile instead of loading the whole archive
+// into memory. Opening the archive only reads the end of central directory record and the
+// central directory; entry data is read on demand when it is extracted.
+// QFile is used over mz_zip_reader_init_file() because it handles non-ASCII paths on Windows.
+class MzFileReader
+{
+public:
+    mz_zip_archive archive{};
+    QFile file;
+
+    explicit MzFileReader(const QString &path) : file(path) {}
+    ~MzFileReader()
+    {
+        if (m_initialized)
+            mz_zip_reader_end(&archive);
+    }
+
+    bool open()
+    {
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        archive.m_pRead = &MzFileReader::read;
+        archive.m_pIO_opaque = &file;
+        m_initialized = mz_zip_reader_init(&archive, file.size(), 0);
+        return m_initialized;
+    }
+
+private:
+    bool m_initialized{false};
+
+    static size_t read(void *pOpaque, mz_uint64 fileOfs, void *pBuf, size_t n)
+    {
+        auto file = static_cast<QFile*>(pOpaque);
+        if (file->pos() != static_cast<qint64>(fileOfs) && !file->seek(static_cast<qint64>(fileOfs)))
+            return 0;
+        auto bytesRead = file->read(static_cast<char*>(pBuf), static_cast<qint64>(n));
+        return bytesRead < 0 ? 0 : static_cast<size_t>(bytesRead);
+    }
+};
+
+size_t writeToQFile(void *pOpaque, mz_uint64 fileOfs, const void *pBuf, size_t n)
+{
+    Q_UNUSED(fileOfs)
+    auto file = static_cast<QFile*>(pOpaque);
+    auto bytesWritten = file->write(static_cast<const char*>(pBuf), static_cast<qint64>(n));
+    return bytesWritten < 0 ? 0 : static_cast<size_t>(bytesWritten);
+}
+
+constexpr int ID3V1_TAG_SIZE = 128;
+
+// Keeps only the last bytes of everything inflated, where an ID3v1 tag would be
+size_t keepId3v1Tail(void *pOpaque, mz_uint64 fileOfs, const void *pBuf, size_t n)
+{
+    Q_UNUSED(fileOfs)
+    auto tail = static_cast<QByteArray*>(pOpaque);
+    auto data = static_cast<const char*>(pBuf);
+    if (n >= ID3V1_TAG_SIZE)
+    {
+        *tail = QByteArray(data + n - ID3V1_TAG_SIZE, ID3V1_TAG_SIZE);
+        return n;
+    }
+    tail->append(data, static_cast<int>(n));
+    if (tail->size() > ID3V1_TAG_SIZE)
+        tail->remove(0, tail->size() - ID3V1_TAG_SIZE);
+    return n;
+}
+
+}
+
 MzArchive::MzArchive(const QString &ArchiveFile, QObject *parent) : QObject(parent)
 {
     archiveFile = ArchiveFile;
@@ -102,28 +173,11 @@ bool MzArchive::extractAudio(const QString& destPath, const QString& destFile)
             m_logger->warn("{} {} - Archive using non-standard compression method, falling back to infozip based zip handling", m_loggingPrefix, archiveFile);
             return oka.extractAudio(destPath, destFile);
         }
-        mz_zip_archive archive;
-        memset(&archive, 0, sizeof(archive));
-        //mz_zip_reader_init_file(&archive, archiveFile.toLocal8Bit(), 0);
-        QFile zipFile(archiveFile);
-        zipFile.open(QIODevice::ReadOnly);
-        QByteArray zipData = zipFile.readAll();
-        zipFile.close();
-        mz_zip_reader_init_mem(&archive, zipData.data(), zipData.size(), 0);
-        if (mz_zip_reader_extract_to_file(&archive, m_audioFileIndex, QString(destPath + QDir::separator() + destFile).toLocal8Bit(),0))
-        {
-            mz_zip_reader_end(&archive);
+        if (extractEntry(m_audioFileIndex, destPath + QDir::separator() + destFile))
             return true;
-        }
-        else
-        {
-            m_logger->warn("{} Failed to extract audio file", m_loggingPrefix);
-            auto err = mz_zip_get_error_string(mz_zip_get_last_error(&archive));
-            m_logger->warn("{} Unzip error: {}", m_loggingPrefix, err);
-            mz_zip_reader_end(&archive);
-            m_logger->warn("{} Attempting to fall back to external infozip method", m_loggingPrefix);
-            return oka.extractAudio(destPath, destFile);
-        }
+        m_logger->warn("{} Failed to extract audio file", m_loggingPrefix);
+        m_logger->warn("{} Attempting to fall back to external infozip method", m_loggingPrefix);
+        return oka.extractAudio(destPath, destFile);
     }
     return false;
 }
@@ -138,28 +192,84 @@ bool MzArchive::extractCdg(const QString& destPath, const QString& destFile)
             m_logger->warn("{} {} - Archive using non-standard compression method, falling back to infozip based zip handling", m_loggingPrefix, archiveFile);
             return oka.extractCdg(destPath, destFile);
         }
-        mz_zip_archive archive;
-        memset(&archive, 0, sizeof(archive));
-        QFile zipFile(archiveFile);
-        zipFile.open(QIODevice::ReadOnly);
-        QByteArray zipData = zipFile.readAll();
-        zipFile.close();
-        mz_zip_reader_init_mem(&archive, zipData.data(), zipData.size(), 0);
-        if (mz_zip_reader_extract_to_file(&archive, m_cdgFileIndex, QString(destPath + QDir::separator() + destFile).toLocal8Bit(),0))
-        {
-            mz_zip_reader_end(&archive);
+        if (extractEntry(m_cdgFileIndex, destPath + QDir::separator() + destFile))
             return true;
-        }
-        else
+        m_logger->warn("{} Failed to extract cdg file", m_loggingPrefix);
+        return false;
+    }
+    return false;
+}
+
+// Decompresses the audio entry straight into memory. Returns an empty array if the archive
+// needs the infozip fallback or the entry can't be read; callers then extract to disk instead.
+QByteArray MzArchive::readAudioData()
+{
+    if (!findAudio() || !m_audioSupportedCompression || !m_cdgSupportedCompression || m_audioSize <= 0)
+        return QByteArray();
+    return readEntry(m_audioFileIndex, m_audioSize);
+}
+
+// Decompresses only as much of an mp3 audio entry as it takes to hold the ID3v2 tag at its start.
+// Returns an empty array if the entry doesn't start with one, or if the archive needs the
+// infozip fallback.
+QByteArray MzArchive::readAudioId3v2Tag()
+{
+    if (!findAudio() || !m_audioSupportedCompression || !m_cdgSupportedCompression || audioExt != ".mp3")
+        return QByteArray();
+    const size_t headerSize = 10;
+    return readEntryPrefix(m_audioFileIndex, headerSize, [this, headerSize] (const QByteArray &header) -> size_t {
+        if (!header.startsWith("ID3") || static_cast<quint8>(header.at(3)) == 0xFF)
+            return 0;
+        // Tag size is a 28 bit syncsafe integer that excludes the header and footer
+        size_t tagSize{0};
+        for (int i = 6; i < 10; i++)
         {
-            m_logger->warn("{} Failed to extract cdg file", m_loggingPrefix);
-            auto err = mz_zip_get_error_string(mz_zip_get_last_error(&archive));
-            m_logger->warn("{} Unzip error: ", m_loggingPrefix, err);
-            mz_zip_reader_end(&archive);
-            return false;
+            auto byte = static_cast<quint8>(header.at(i));
+            if (byte & 0x80)
+                return 0;
+            tagSize = (tagSize << 7) | byte;
         }
+        tagSize += headerSize;
+        if (header.at(5) & 0x10)
+            tagSize += headerSize;
+        return tagSize > m_audioSize ? 0 : tagSize;
+    });
+}
+
+// Streams the whole mp3 audio entry through the inflater and keeps the ID3v1 tag at its end. Returns an empty array if
+// there is none, or if the archive needs the infozip fallback.
+QByteArray MzArchive::readAudioId3v1Tag()
+{
+    if (!canReadAudio() || audioExt != ".mp3" || m_audioSize < ID3V1_TAG_SIZE)
+        return QByteArray();
+    MzFileReader reader(archiveFile);
+    if (!reader.open())
+    {
+        m_logger->warn("{} Error opening zip file!", m_loggingPrefix);
+        return QByteArray();
     }
-    return false;
+    QByteArray tail;
+    if (!mz_zip_reader_extract_to_callback(&reader.archive, m_audioFileIndex, keepId3v1Tail, &tail, 0))
+    {
+        auto err = mz_zip_get_error_string(mz_zip_get_last_error(&reader.archive));
+        m_logger->warn("{} Unzip error: {}", m_loggingPrefix, err);
+        return QByteArray();
+    }
+    if (tail.size() != ID3V1_TAG_SIZE || !tail.startsWith("TAG"))
+        return QByteArray();
+    return tail;
+}
+
+bool MzArchive::canReadAudio()
+{
+    return findAudio() && m_audioSupportedCompression && m_cdgSupportedCompression;
+}
+
+QByteArray MzArchive::readCdgData()
+{
+    if (!findCDG() || !m_audioSupportedCompression || !m_cdgSupportedCompression || m_cdgSize <= 0)
+        return QByteArray();
+    return readEntry(m_cdgFileIndex, m_cdgSize);
 }
 
 bool MzArchive::isValidKaraokeFile()
@@ -221,27 +331,18 @@ bool MzArchive::findEntries()
 {
     if (m_audioFound && m_cdgFound && m_audioSupportedCompression && m_cdgSupportedCompression)
         return true;
-    mz_zip_archive archive;
-    memset(&archive, 0, sizeof(archive));
     mz_zip_archive_file_stat fStat;
 
-    QFile zipFile(archiveFile);
-    if (!zipFile.open(QIODevice::ReadOnly))
+    MzFileReader reader(archiveFile);
+    if (!reader.open())
     {
         m_logger->warn("{} Error opening zip file!", m_loggingPrefix);
         return false;
     }
-    QByteArray zipData = zipFile.readAll();
-    zipFile.close();
-    if (!mz_zip_reader_init_mem(&archive, zipData.data(), zipData.size(), 0))
-    {
-        m_logger->warn("{} Error opening zip file!", m_loggingPrefix);
-        return false;
-    }
-    unsigned int files = mz_zip_reader_get_num_files(&archive);
+    unsigned int files = mz_zip_reader_get_num_files(&reader.archive);
     for (unsigned int i=0; i < files; i++)
     {
-        if (mz_zip_reader_file_stat(&archive, i, &fStat))
+        if (mz_zip_reader_file_stat(&reader.archive, i, &fStat))
         {
             QString fileName = fStat.m_filename;
             if (fileName.endsWith(".cdg",Qt::CaseInsensitive))
@@ -266,16 +367,88 @@ bool MzArchive::findEntries()
                 }
             }
             if (m_audioFound && m_cdgFound && m_cdgSupportedCompression && m_audioSupportedCompression)
-            {
-                mz_zip_reader_end(&archive);
                 return true;
-            }
             else if (m_audioFound && m_cdgFound && (!m_cdgSupportedCompression || !m_audioSupportedCompression))
                 return oka.isValidKaraokeFile();
         }
     }
-    mz_zip_reader_end(&archive);
     return false;
 }
 
+bool MzArchive::extractEntry(unsigned int fileIndex, const QString &destFilePath)
+{
+    MzFileReader reader(archiveFile);
+    if (!reader.open())
+    {
+        m_logger->warn("{} Error opening zip file!", m_loggingPrefix);
+        return false;
+    }
+    QFile destFile(destFilePath);
+    if (!destFile.open(QIODevice::WriteOnly))
+    {
+        m_logger->warn("{} Unable to open {} for writing", m_loggingPrefix, destFilePath);
+        return false;
+    }
+    if (!mz_zip_reader_extract_to_callback(&reader.archive, fileIndex, &writeToQFile, &destFile, 0))
+    {
+        auto err = mz_zip_get_error_string(mz_zip_get_last_error(&reader.archive));
+        m_logger->warn("{} Unzip error: {}", m_loggingPrefix, err);
+        destFile.close();
+        destFile.remove();
+        return false;
+    }
+    return true;
+}
+
+QByteArray MzArchive::readEntry(unsigned int fileIndex, size_t size)
+{
+    MzFileReader reader(archiveFile);
+    if (!reader.open())
+    {
+        m_logger->warn("{} Error opening zip file!", m_loggingPrefix);
+        return QByteArray();
+    }
+    QByteArray data(static_cast<int>(size), Qt::Uninitialized);
+    if (!mz_zip_reader_extract_to_mem(&reader.archive, fileIndex, data.data(), size, 0))
+    {
+        auto err = mz_zip_get_error_string(mz_zip_get_last_error(&reader.archive));
+        m_logger->warn("{} Unzip error: {}", m_loggingPrefix, err);
+        return QByteArray();
+    }
+    return data;
+}
 
+// Inflates the first headerSize bytes of an entry, asks prefixSize how many bytes the prefix is long in total and
+// inflates the rest of it in the same pass. Returns an empty array if prefixSize returns 0 or the entry is too short.
+QByteArray MzArchive::readEntryPrefix(unsigned int fileIndex, size_t headerSize, const std::function<size_t(const QByteArray &header)> &prefixSize)
+{
+    MzFileReader reader(archiveFile);
+    if (!reader.open())
+    {
+        m_logger->warn("{} Error opening zip file!", m_loggingPrefix);
+        return QByteArray();
+    }
+    auto iter = mz_zip_reader_extract_iter_new(&reader.archive, fileIndex, 0);
+    if (!iter)
+    {
+        auto err = mz_zip_get_error_string(mz_zip_get_last_error(&reader.archive));
+        m_logger->warn("{} Unzip error: {}", m_loggingPrefix, err);
+        return QByteArray();
+    }
+    // Inflating stops as soon as the buffer is full, the rest of the entry is never touched
+    QByteArray data(static_cast<int>(headerSize), Qt::Uninitialized);
+    size_t size{0};
+    if (mz_zip_reader_extract_iter_read(iter, data.data(), headerSize) == headerSize)
+        size = prefixSize(data);
+    if (size > headerSize)
+    {
+        data.resize(static_cast<int>(size));
+        if (mz_zip_reader_extract_iter_read(iter, data.data() + headerSize, size - headerSize) != size - headerSize)
+            size = 0;
+    }
+    mz_zip_reader_extract_iter_free(iter);
+    if (size < headerSize)
+        return QByteArray();
+    data.truncate(static_cast<int>(size));
+    return data;
+}
@@ -25,6 +25,7 @@
 #include <QObject>
 #include <QStringList>
 #include <okarchive.h>
+#include <functional>
 #include <spdlog/spdlog.h>
 #include <spdlog/async_logger.h>
 #include <spdlog/fmt/ostr.h>
@@ -45,6 +46,14 @@ public:
     QString audioExtension();
     bool extractAudio(const QString& destPath, const QString& destFile);
     bool extractCdg(const QString& destPath, const QString& destFile);
+    QByteArray readAudioData();
+    QByteArray readAudioId3v2Tag();
+    QByteArray readAudioId3v1Tag();
+    /**
+     * @brief Whether the audio entry can be read into memory, false if the archive needs the infozip fallback
+     */
+    bool canReadAudio();
+    QByteArray readCdgData();
     bool isValidKaraokeFile();
     QString getLastError();
 
@@ -63,6 +72,9 @@ private:
     bool m_cdgFound{false};
     bool m_audioFound{false};
     bool findEntries();
+    bool extractEntry(unsigned int fileIndex, const QString &destFilePath);
+    QByteArray readEntry(unsigned int fileIndex, size_t size);
+    QByteArray readEntryPrefix(unsigned int fileIndex, size_t headerSize, const std::function<size_t(const QByteArray &header)> &prefixSize);
     QStringList audioExtensions;
     OkArchive oka;
     std::string m_loggingPrefix{"[MZArchive]"};
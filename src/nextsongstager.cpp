@@ -0,0 +1,124 @@
+#include "nextsongstager.h"
+#include "mzarchive.h"
+#include "okjutil.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+NextSongStager::NextSongStager(QObject *parent) : QObject(parent)
+{
+    m_logger = spdlog::get("logger");
+    connect(&m_watcher, &QFutureWatcher<StagedSong>::finished, this, &NextSongStager::loadFinished);
+}
+
+NextSongStager::~NextSongStager()
+{
+    m_watcher.waitForFinished();
+}
+
+void NextSongStager::stage(const QString &karaokeFilePath)
+{
+    if (karaokeFilePath == m_path)
+        return;
+    clear();
+    if (!karaokeFilePath.endsWith(".zip", Qt::CaseInsensitive) && !karaokeFilePath.endsWith(".cdg", Qt::CaseInsensitive))
+        return;
+    m_path = karaokeFilePath;
+    // A load that is still running for a previous path is left to finish, loadFinished() picks up the new one
+    if (!m_watcher.isRunning())
+        m_watcher.setFuture(QtConcurrent::run(&NextSongStager::loadSong, m_path));
+}
+
+std::optional<StagedSong> NextSongStager::take(const QString &karaokeFilePath)
+{
+    if (!m_staged.has_value() || m_staged->path != karaokeFilePath)
+        return std::nullopt;
+    auto staged = std::move(m_staged);
+    clear();
+    auto changedOnDisk = [] (const QString &path, const QDateTime &lastModified, qint64 size) {
+        QFileInfo fileInfo(path);
+        return !fileInfo.exists() || fileInfo.lastModified() != lastModified || fileInfo.size() != size;
+    };
+    bool changed = changedOnDisk(karaokeFilePath, staged->lastModified, staged->size);
+    if (!changed && !staged->audioPath.isEmpty())
+    {
+        // A different audio file may have been put next to the cdg file since, play() would pick that one
+        changed = findMatchingAudioFile(karaokeFilePath) != staged->audioPath
+                || changedOnDisk(staged->audioPath, staged->audioLastModified, staged->audioSize);
+    }
+    if (changed)
+    {
+        m_logger->info("{} File changed on disk since it was staged, discarding: {}", m_loggingPrefix, karaokeFilePath);
+        return std::nullopt;
+    }
+    return staged;
+}
+
+void NextSongStager::clear()
+{
+    if (!m_path.isEmpty())
+        m_logger->debug("{} Dropping staged song: {}", m_loggingPrefix, m_path);
+    m_path.clear();
+    m_staged.reset();
+}
+
+StagedSong NextSongStager::loadSong(const QString &karaokeFilePath)
+{
+    StagedSong song;
+    song.path = karaokeFilePath;
+    QFileInfo fileInfo(karaokeFilePath);
+    song.lastModified = fileInfo.lastModified();
+    song.size = fileInfo.size();
+    if (karaokeFilePath.endsWith(".zip", Qt::CaseInsensitive))
+    {
+        MzArchive archive(karaokeFilePath);
+        if (archive.checkCDG() && archive.checkAudio())
+        {
+            song.audioData = archive.readAudioData();
+            song.cdgData = archive.readCdgData();
+        }
+    }
+    else
+    {
+        song.audioPath = findMatchingAudioFile(karaokeFilePath);
+        if (song.audioPath.isEmpty())
+            return song;
+        QFileInfo audioInfo(song.audioPath);
+        song.audioLastModified = audioInfo.lastModified();
+        song.audioSize = audioInfo.size();
+        QFile cdgFile(karaokeFilePath);
+        QFile audioFile(song.audioPath);
+        if (cdgFile.open(QIODevice::ReadOnly) && audioFile.open(QIODevice::ReadOnly))
+        {
+            song.cdgData = cdgFile.readAll();
+            song.audioData = audioFile.readAll();
+        }
+    }
+    if (song.isValid())
+    {
+        song.cdgReader = std::make_shared<CdgFileReader>(song.cdgData);
+        song.cdgReader->buildIndex();
+    }
+    return song;
+}
+
+void NextSongStager::loadFinished()
+{
+    auto song = m_watcher.result();
+    if (song.path != m_path)
+    {
+        // Staging target changed while loading
+        if (!m_path.isEmpty())
+            m_watcher.setFuture(QtConcurrent::run(&NextSongStager::loadSong, m_path));
+        return;
+    }
+    if (!song.isValid())
+    {
+        m_logger->warn("{} Unable to stage song, it will be loaded when played: {}", m_loggingPrefix, song.path);
+        return;
+    }
+    m_logger->info("{} Staged next song ({} bytes audio, {} bytes cdg): {}", m_loggingPrefix,
+                   song.audioData.size(), song.cdgData.size(), song.path);
+    m_staged = std::move(song);
+    emit songStaged(m_path);
+}
@@ -0,0 +1,79 @@
+#ifndef NEXTSONGSTAGER_H
+#define NEXTSONGSTAGER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <memory>
+#include <optional>
+#include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
+#include <spdlog/fmt/ostr.h>
+#include "cdg/cdgfilereader.h"
+
+std::ostream& operator<<(std::ostream& os, const QString& s);
+
+struct StagedSong
+{
+    QString path;
+    QByteArray cdgData;
+    QByteArray audioData;
+    // Parsed from cdgData with its keyframe index already built
+    std::shared_ptr<CdgFileReader> cdgReader;
+    QDateTime lastModified;
+    qint64 size{0};
+    // The audio file paired with a loose cdg file, empty for zips
+    QString audioPath;
+    QDateTime audioLastModified;
+    qint64 audioSize{0};
+    bool isValid() const { return !cdgData.isEmpty() && !audioData.isEmpty(); }
+};
+
+/**
+ * @brief Loads the next rotation song into memory in the background while the current song plays.
+ *
+ * Zip archives are decompressed and loose cdg+audio pairs are read from disk off the GUI thread, so
+ * starting the staged song doesn't have to touch the disk or inflate anything.  The cdg data is also
+ * parsed and its seek index built ahead of time.  Only one song is kept staged, staging a different
+ * path drops whatever was staged before.
+ *
+ * The audio is not prerolled, the karaoke backend builds its pipeline when the song is played.
+ */
+class NextSongStager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NextSongStager(QObject *parent = nullptr);
+    ~NextSongStager() override;
+
+    /**
+     * @brief Start staging the given file. Does nothing if it is already staged or being staged.
+     * @param karaokeFilePath Path to a zip or cdg file, anything else clears the staged song.
+     */
+    void stage(const QString &karaokeFilePath);
+
+    /**
+     * @brief Hand over the staged data for a file if it's ready and neither the file nor the audio file paired
+     * with it have changed on disk since.
+     * The stager is empty afterwards.
+     */
+    std::optional<StagedSong> take(const QString &karaokeFilePath);
+
+    void clear();
+    [[nodiscard]] QString stagedPath() const { return m_path; }
+
+signals:
+    void songStaged(const QString &path);
+
+private:
+    std::string m_loggingPrefix{"[NextSongStager]"};
+    std::shared_ptr<spdlog::logger> m_logger;
+    QString m_path;
+    std::optional<StagedSong> m_staged;
+    QFutureWatcher<StagedSong> m_watcher;
+    static StagedSong loadSong(const QString &karaokeFilePath);
+    void loadFinished();
+};
+
+#endif // NEXTSONGSTAGER_H
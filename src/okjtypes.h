@@ -83,6 +83,16 @@ namespace okj {
         [[nodiscard]] int numSongsUnsung() const;
     };
 
+    // Per singer totals of the queue, kept by TableModelRotation so painting the rotation doesn't hit the db
+    struct QueueSummary {
+        int songsSung{0};
+        int songsUnsung{0};
+        bool hasNextSong{false};
+        QString nextSongArtist;
+        QString nextSongTitle;
+        int nextSongDuration{0};
+    };
+
     struct QueueSong {
         int id{0};
         int singerId{0};
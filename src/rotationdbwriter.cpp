@@ -0,0 +1,99 @@
+#include "rotationdbwriter.h"
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+#include <chrono>
+
+RotationDbWriter::RotationDbWriter(QObject *parent) : QObject(parent)
+{
+    m_logger = spdlog::get("logger");
+}
+
+RotationDbWriter::~RotationDbWriter()
+{
+    if (!QSqlDatabase::contains(m_connectionName))
+        return;
+    QSqlDatabase::database(m_connectionName, false).close();
+    QSqlDatabase::removeDatabase(m_connectionName);
+}
+
+bool RotationDbWriter::openDb(const QString &dbFileName)
+{
+    if (m_dbOpen)
+        return true;
+    auto db = QSqlDatabase::contains(m_connectionName) ? QSqlDatabase::database(m_connectionName, false)
+                                                       : QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
+    db.setDatabaseName(dbFileName);
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=30000");
+    m_dbOpen = db.open();
+    if (!m_dbOpen)
+        m_logger->error("{} Unable to open db: {}", m_loggingPrefix, db.lastError().text());
+    return m_dbOpen;
+}
+
+void RotationDbWriter::write(const QString &dbFileName, const std::vector<RotationSingerRow> &changed, const std::vector<int> &deleted)
+{
+    if (changed.empty() && deleted.empty())
+        return true;
+    auto st = std::chrono::high_resolution_clock::now();
+    if (!openDb(dbFileName))
+        return false;
+    auto db = QSqlDatabase::database(m_connectionName);
+    if (!db.transaction())
+    {
+        m_logger->error("{} Unable to start a transaction: {}", m_loggingPrefix, db.lastError().text());
+        return false;
+    }
+    // Half a batch on disk would be a rotation that never existed, any failure drops all of it
+    auto rollback = [&] () {
+        db.rollback();
+        m_logger->error("{} Rolled back {} changed and {} deleted singers", m_loggingPrefix, changed.size(), deleted.size());
+        return false;
+    };
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM rotationsingers WHERE singerid = :singerid");
+    for (auto singerId : deleted)
+    {
+        query.bindValue(":singerid", singerId);
+        if (!query.exec())
+        {
+            m_logger->error("{} Error deleting singer {}: {}", m_loggingPrefix, singerId, query.lastError().text());
+            return rollback();
+        }
+    }
+    // Names are unique, a batch can hand one singer's old name to another. Park every name first so the order the rows
+    // are written in doesn't matter.
+    query.prepare("UPDATE rotationsingers SET name = char(1) || singerid WHERE singerid = :singerid");
+    for (const auto &singer : changed)
+    {
+        query.bindValue(":singerid", singer.singerId);
+        if (!query.exec())
+        {
+            m_logger->error("{} Error renaming singer {}: {}", m_loggingPrefix, singer.singerId, query.lastError().text());
+            return rollback();
+        }
+    }
+    query.prepare("UPDATE rotationsingers SET name = :name, position = :pos, regular = :regular WHERE singerid = :singerid");
+    for (const auto &singer : changed)
+    {
+        query.bindValue(":name", singer.name);
+        query.bindValue(":pos", singer.position);
+        query.bindValue(":regular", singer.regular);
+        query.bindValue(":singerid", singer.singerId);
+        if (!query.exec())
+        {
+            m_logger->error("{} Error updating singer {}: {}", m_loggingPrefix, singer.singerId, query.lastError().text());
+            return rollback();
+        }
+    }
+    if (!db.commit())
+    {
+        m_logger->error("{} Commit error! Unable to write rotation changes to db on disk! Error: {}", m_loggingPrefix,
+                        db.lastError().text());
+        return rollback();
+    }
+    m_logger->trace("{} Wrote {} changed and {} deleted singers in {}ms", m_loggingPrefix, changed.size(), deleted.size(),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - st).count());
+    return true;
+}
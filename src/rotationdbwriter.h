@@ -0,0 +1,47 @@
+#ifndef ROTATIONDBWRITER_H
+#define ROTATIONDBWRITER_H
+
+#include <QObject>
+#include <QString>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/async_logger.h>
+#include <spdlog/fmt/ostr.h>
+
+std::ostream& operator<<(std::ostream& os, const QString& s);
+
+struct RotationSingerRow
+{
+    int singerId{0};
+    QString name;
+    int position{0};
+    bool regular{false};
+};
+
+/**
+ * @brief Writes batches of rotation changes to the rotationsingers table on its own db connection.
+ *
+ * Meant to live on a worker thread, TableModelRotation hands it the singers that changed since the last
+ * batch.  Each batch is written in a single transaction so the table on disk always matches the rotation
+ * as it was at the end of some batch, even if the process dies mid write. A batch that can't be written
+ * completely is rolled back and left to the caller to hand in again.
+ * Rows are only ever updated or deleted here, new singers are inserted by the model so it gets their id.
+ */
+class RotationDbWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RotationDbWriter(QObject *parent = nullptr);
+    ~RotationDbWriter() override;
+
+    bool write(const QString &dbFileName, const std::vector<RotationSingerRow> &changed, const std::vector<int> &deleted);
+
+private:
+    std::string m_loggingPrefix{"[RotationDbWriter]"};
+    std::shared_ptr<spdlog::logger> m_logger;
+    const QString m_connectionName{"RotationDbWriter"};
+    bool m_dbOpen{false};
+    bool openDb(const QString &dbFileName);
+};
+
+#endif // ROTATIONDBWRITER_H
@@ -31,6 +31,7 @@
 #include <QDataStream>
 #include <QFontDatabase>
 #include <QUuid>
+#include <QThread>
 #include <fstream>
 
 #ifdef Q_OS_WIN
@@ -1054,6 +1055,16 @@ void Settings::setAudioDetectSilenceBm(bool enabled)
     settings->setValue("audioDetectSilenceBm", enabled);
 }
 
+int Settings::bmCrossfadeMs()
+{
+    return settings->value("bmCrossfadeMs", 3000).toInt();
+}
+
+void Settings::setBmCrossfadeMs(int ms)
+{
+    settings->setValue("bmCrossfadeMs", ms);
+}
+
 QString Settings::audioOutputDevice()
 {
     return settings->value("audioOutputDevice", 0).toString();
@@ -1752,6 +1763,26 @@ void Settings::dbSetLazyLoadDurations(bool val)
     settings->setValue("dbLazyLoadDurations", val);
 }
 
+int Settings::dbImportThreads()
+{
+    return settings->value("dbImportThreads", qMax(QThread::idealThreadCount(), 1)).toInt();
+}
+
+void Settings::dbSetImportThreads(int threads)
+{
+    settings->setValue("dbImportThreads", threads);
+}
+
+bool Settings::dbFullTextSearch()
+{
+    return settings->value("dbFullTextSearch", false).toBool();
+}
+
+void Settings::dbSetFullTextSearch(bool enabled)
+{
+    settings->setValue("dbFullTextSearch", enabled);
+}
+
 void Settings::setBmKCrossfade(bool enabled)
 {
     settings->setValue("bmKCrossFade", enabled);
@@ -177,6 +177,8 @@ public:
     bool audioDetectSilenceBm();
     void setAudioDetectSilence(bool enabled);
     void setAudioDetectSilenceBm(bool enabled);
+    int bmCrossfadeMs();
+    void setBmCrossfadeMs(int ms);
     QString audioOutputDevice();
     QString audioOutputDeviceBm();
     void setAudioOutputDevice(QString device);
@@ -268,6 +270,8 @@ public:
     int currentRotationPosition();
     bool dbSkipValidation();
     bool dbLazyLoadDurations();
+    int dbImportThreads();
+    bool dbFullTextSearch();
     int systemId();
     QFont cdgRemainFont();
     QColor cdgRemainTextColor();
@@ -332,6 +336,8 @@ public slots:
     void setRemainBtmOffset(int offset);
     void dbSetLazyLoadDurations(bool val);
     void dbSetSkipValidation(bool val);
+    void dbSetImportThreads(int threads);
+    void dbSetFullTextSearch(bool enabled);
     void setBmKCrossfade(bool enabled);
     void setShowCdgWindow(bool show);
     void setCdgWindowFullscreen(bool fullScreen);
@@ -26,7 +26,6 @@ SoftwareRenderVideoSink::SoftwareRenderVideoSink(QWidget *surface)
     gst_app_sink_set_drop(m_appSink, true);
 
     // Process eos even if there are unread samples.
-    // As samples are only read when the widget is painted, samples are not read if the widget is hidden.
     // Without this, the sink will hang/never change state from playing->ready->null.
     gst_app_sink_set_wait_on_eos(m_appSink, false);
 
@@ -53,7 +52,7 @@ bool SoftwareRenderVideoSink::eventFilter(QObject *obj, QEvent *event)
         m_pendingRepaint = false;
         if (m_active)
         {
-            return pullSampleAndDrawImage();
+            return drawImage();
         }
         else
         {
@@ -76,15 +75,35 @@ void SoftwareRenderVideoSink::onSurfaceResized(const QSize &size)
 {
     // Tell what image dimension we can handle and let
     // the Videoscale element earlier in the pipeline do the actual scaline.
-    gst_caps_set_simple(m_videoCaps, "width", G_TYPE_INT, size.width(), "height", G_TYPE_INT, size.height(), nullptr);
+    // Ask for device pixels so frames never need scaling when painted on high dpi screens.
+    const qreal pixelRatio = m_surface->devicePixelRatioF();
+    const QSize deviceSize = size * pixelRatio;
+    m_targetWidth = deviceSize.width();
+    m_targetHeight = deviceSize.height();
+    m_targetPixelRatio = pixelRatio;
+    gst_caps_set_simple(m_videoCaps, "width", G_TYPE_INT, deviceSize.width(), "height", G_TYPE_INT, deviceSize.height(), nullptr);
     gst_app_sink_set_caps(m_appSink, m_videoCaps);
     gst_element_send_event(GST_ELEMENT(m_appSink), gst_event_new_reconfigure());
 }
 
-GstFlowReturn SoftwareRenderVideoSink::NewSampleCallback([[maybe_unused]]GstAppSink *appsink, gpointer user_data)
+GstFlowReturn SoftwareRenderVideoSink::NewSampleCallback(GstAppSink *appsink, gpointer user_data)
 {
+    // Runs on the streaming thread, which doubles as the render worker: the frame is pulled and brought to the
+    // surface size here so the paint event only has to blit it.
     SoftwareRenderVideoSink *me = (SoftwareRenderVideoSink*) user_data;
     me->m_active = true;
+
+    GstSample* sample = gst_app_sink_try_pull_sample(appsink, 0);
+    if (!sample)
+        return GST_FLOW_OK;
+
+    auto now = std::chrono::steady_clock::now();
+    auto duration = GST_BUFFER_DURATION(gst_sample_get_buffer(sample));
+    // Without a duration assume 25fps
+    auto displayTime = std::chrono::microseconds(GST_CLOCK_TIME_IS_VALID(duration) ? duration / GST_USECOND : 40000);
+
+    me->setLatestFrame({me->renderSample(sample), now, now + displayTime});
+
     if (!me->m_pendingRepaint)
     {
         me->m_pendingRepaint = true;
@@ -104,43 +123,87 @@ void SoftwareRenderVideoSink::cleanupFunction(void* _info)
     delete info;
 }
 
-bool SoftwareRenderVideoSink::pullSampleAndDrawImage()
+QImage SoftwareRenderVideoSink::renderSample(GstSample *sample)
 {
-    // Pull sample and paint it. Must be called from gui thread!
-    GstSample* sample = gst_app_sink_try_pull_sample(m_appSink, 0);
+    SampleInfo *info = new SampleInfo();
+    info->sample = sample;
+    info->bufferInfo = new GstMapInfo;
+    GstCaps *caps;
+    GstStructure *s;
+    const gchar *format;
+    int width, height;
+
+    caps = gst_sample_get_caps(sample);
+    s = gst_caps_get_structure(caps, 0);
+    gst_structure_get_int(s, "width", &width);
+    gst_structure_get_int(s, "height", &height);
+    format = gst_structure_get_string(s, "format");
+
+    info->buffer = gst_sample_get_buffer (sample);
+
+    gst_buffer_map(info->buffer, info->bufferInfo, GST_MAP_READ);
+    guint8 *rawFrame = info->bufferInfo->data;
+
+    QImage::Format qtFormat = QImage::Format_RGB32;
+
+    if (strcmp(format, "RGB16") == 0)
+        qtFormat = QImage::Format_RGB16;
+    else if (strcmp(format, "BGRx") == 0)
+        qtFormat = QImage::Format_RGB32;
+
+    // Wraps the buffer without copying, the sample is released with the last copy of the image
+    QImage frame(rawFrame, width, height, qtFormat, cleanupFunction, info);
+
+    // Frames negotiated before the last resize don't fit the surface anymore, Qt's smooth scaler is SIMD optimized
+    const QSize target(m_targetWidth, m_targetHeight);
+    if (!target.isEmpty() && frame.size() != target)
+        frame = frame.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    frame.setDevicePixelRatio(m_targetPixelRatio);
+    return frame;
+}
 
-    if (sample)
+void SoftwareRenderVideoSink::setLatestFrame(QueuedFrame &&frame)
+{
+    QMutexLocker locker(&m_latestFrameLock);
+    if (m_latestFrame)
+        m_droppedFrames++;
+    m_latestFrame = std::move(frame);
+}
+
+SoftwareRenderVideoSink::Stats SoftwareRenderVideoSink::takeStats()
+{
+    Stats stats;
+    stats.paintedFrames = m_paintedFrames.exchange(0);
+    stats.droppedFrames = m_droppedFrames.exchange(0);
+    stats.lateFrames = m_lateFrames.exchange(0);
+    auto latencyUs = m_presentLatencyUs.exchange(0);
+    stats.avgPresentLatencyUs = stats.paintedFrames > 0 ? latencyUs / static_cast<qint64>(stats.paintedFrames) : 0;
+    return stats;
+}
+
+bool SoftwareRenderVideoSink::drawImage()
+{
+    // Must be called from gui thread!
+    bool haveFrame{false};
     {
-        SampleInfo *info = new SampleInfo();
-        info->sample = sample;
-        info->bufferInfo = new GstMapInfo;
-        GstCaps *caps;
-        GstStructure *s;
-        const gchar *format;
-        int width, height;
-
-        caps = gst_sample_get_caps(sample);
-        s = gst_caps_get_structure(caps, 0);
-        gst_structure_get_int(s, "width", &width);
-        gst_structure_get_int(s, "height", &height);
-        format = gst_structure_get_string(s, "format");
-
-        info->buffer = gst_sample_get_buffer (sample);
-
-        gst_buffer_map(info->buffer, info->bufferInfo, GST_MAP_READ);
-        guint8 *rawFrame = info->bufferInfo->data;
-
-        QImage::Format qtFormat;
-
-        if (strcmp(format, "RGB16") == 0)
-            qtFormat = QImage::Format_RGB16;
-        else if (strcmp(format, "BGRx") == 0)
-            qtFormat = QImage::Format_RGB32;
-
-        QImage frame(rawFrame, width, height, qtFormat, cleanupFunction, info);
-        m_buffer = frame;
+        QMutexLocker locker(&m_latestFrameLock);
+        if (m_latestFrame)
+        {
+            auto frame = std::move(*m_latestFrame);
+            m_latestFrame.reset();
+            locker.unlock();
+
+            auto now = std::chrono::steady_clock::now();
+            m_presentLatencyUs += std::chrono::duration_cast<std::chrono::microseconds>(now - frame.readyAt).count();
+            if (now > frame.deadline)
+                m_lateFrames++;
+            m_paintedFrames++;
+            m_buffer = std::move(frame.image);
+            haveFrame = true;
+        }
     }
-    else
+
+    if (!haveFrame)
     {
         // No sample found in queue - are we still playing?
         GstState state = GST_STATE_NULL;
@@ -156,7 +219,11 @@ bool SoftwareRenderVideoSink::pullSampleAndDrawImage()
     if (!m_buffer.isNull())
     {
         QPainter painter(m_surface);
-        painter.drawImage(m_surface->contentsRect(), m_buffer, m_buffer.rect());
+        const QRect contentsRect = m_surface->contentsRect();
+        if (m_buffer.size() / m_buffer.devicePixelRatio() == contentsRect.size())
+            painter.drawImage(contentsRect.topLeft(), m_buffer);
+        else
+            painter.drawImage(contentsRect, m_buffer, m_buffer.rect());
         return true;
     }
 
@@ -5,12 +5,27 @@
 #include <gst/app/gstappsink.h>
 
 #include <QWidget>
+#include <QMutex>
+#include <chrono>
+#include <optional>
 
 
 class SoftwareRenderVideoSink : public QObject
 {
     Q_OBJECT
 
+public:
+    struct Stats
+    {
+        quint64 paintedFrames{0};
+        // Frames replaced by a newer one before they were painted
+        quint64 droppedFrames{0};
+        // Frames painted after their display duration was already over
+        quint64 lateFrames{0};
+        // Average time from a frame being ready to it being painted
+        qint64 avgPresentLatencyUs{0};
+    };
+
 private:
 
     struct SampleInfo
@@ -20,19 +35,43 @@ private:
         GstMapInfo *bufferInfo;
     };
 
+    struct QueuedFrame
+    {
+        QImage image;
+        std::chrono::steady_clock::time_point readyAt;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
     std::atomic<bool> m_active {false};
     std::atomic<bool> m_pendingRepaint {false};
 
     QWidget *m_surface;
     QImage m_buffer;
 
+    // Frames are prepared on the streaming thread and only blitted in the paint event. Only the newest one is kept,
+    // a frame that arrives before the last one was painted replaces it.
+    QMutex m_latestFrameLock;
+    std::optional<QueuedFrame> m_latestFrame;
+
+    // Surface size in device pixels, read by the streaming thread
+    std::atomic<int> m_targetWidth {0};
+    std::atomic<int> m_targetHeight {0};
+    std::atomic<qreal> m_targetPixelRatio {1.0};
+
+    std::atomic<quint64> m_paintedFrames {0};
+    std::atomic<quint64> m_droppedFrames {0};
+    std::atomic<quint64> m_lateFrames {0};
+    std::atomic<qint64> m_presentLatencyUs {0};
+
     void onSurfaceResized(const QSize &size);
 
     GstAppSink *m_appSink;
     GstCaps *m_videoCaps;
 
     static GstFlowReturn NewSampleCallback(GstAppSink *appsink, gpointer user_data);
-    bool pullSampleAndDrawImage();
+    QImage renderSample(GstSample *sample);
+    void setLatestFrame(QueuedFrame &&frame);
+    bool drawImage();
     static void cleanupFunction(void *info);
 
 signals:
@@ -46,6 +85,10 @@ public:
     ~SoftwareRenderVideoSink();
     GstAppSink* getSink() { return m_appSink; }
 
+    /**
+     * @brief Frame counters since the last call, safe to call from any thread.
+     */
+    Stats takeStats();
 
 };
 
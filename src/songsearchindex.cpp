@@ -0,0 +1,177 @@
+#include "songsearchindex.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+void SongSearchIndex::clear()
+{
+    m_indexed.clear();
+    m_order.clear();
+    m_tokenIds.clear();
+    m_tokens.clear();
+    m_tokenSongs.clear();
+    m_trigramTokens.clear();
+}
+
+void SongSearchIndex::reserve(size_t songCount)
+{
+    m_indexed.reserve(songCount);
+    m_order.reserve(songCount);
+}
+
+void SongSearchIndex::addSong(Row row, const QStringList &texts)
+{
+    if (row >= m_indexed.size())
+        m_indexed.resize(row + 1, false);
+    if (m_indexed[row])
+        return;
+    m_indexed[row] = true;
+    m_order.push_back(row);
+
+    // Index with and without apostrophes so either search setting finds the song
+    std::vector<quint32> songTokens;
+    for (QString text : texts)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            if (pass == 1)
+            {
+                if (!text.contains('\''))
+                    break;
+                text.remove('\'');
+            }
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+            const auto tokens = text.splitRef(' ', QString::SkipEmptyParts);
+#else
+            const auto tokens = text.splitRef(' ', Qt::SkipEmptyParts);
+#endif
+            for (const auto &token : tokens)
+                songTokens.push_back(tokenId(token.toString()));
+        }
+    }
+    std::sort(songTokens.begin(), songTokens.end());
+    songTokens.erase(std::unique(songTokens.begin(), songTokens.end()), songTokens.end());
+    // Posting lists stay sorted as long as rows are added in increasing order, which loading does.
+    // A row added out of order only costs a re-sort of the lists it's in.
+    for (auto id : songTokens)
+    {
+        auto &songs = m_tokenSongs[id];
+        if (!songs.empty() && songs.back() > row)
+            songs.insert(std::upper_bound(songs.begin(), songs.end(), row), row);
+        else
+            songs.push_back(row);
+    }
+}
+
+void SongSearchIndex::removeSong(Row row)
+{
+    if (row >= m_indexed.size() || !m_indexed[row])
+        return;
+    // Posting lists keep the stale row, candidates() skips rows that aren't indexed
+    m_indexed[row] = false;
+    m_order.erase(std::remove(m_order.begin(), m_order.end(), row), m_order.end());
+}
+
+void SongSearchIndex::setOrder(const std::vector<Row> &rows)
+{
+    m_order.clear();
+    for (auto row : rows)
+    {
+        if (row < m_indexed.size() && m_indexed[row])
+            m_order.push_back(row);
+    }
+}
+
+std::optional<std::vector<SongSearchIndex::Row>> SongSearchIndex::candidates(const QStringList &needles) const
+{
+    if (needles.isEmpty() || needles.size() >= std::numeric_limits<quint16>::max())
+        return std::nullopt;
+
+    // hits[row] counts how many of the needles processed so far the song matched, in order
+    std::vector<quint16> hits(m_indexed.size(), 0);
+    quint16 round{0};
+    for (const auto &needle : needles)
+    {
+        for (auto id : tokensContaining(needle))
+        {
+            for (auto row : m_tokenSongs[id])
+            {
+                if (hits[row] == round)
+                    hits[row] = round + 1;
+            }
+        }
+        round++;
+    }
+
+    std::vector<Row> rows;
+    for (auto row : m_order)
+    {
+        if (hits[row] == round)
+            rows.push_back(row);
+    }
+    return rows;
+}
+
+quint32 SongSearchIndex::tokenId(const QString &token)
+{
+    if (auto it = m_tokenIds.constFind(token); it != m_tokenIds.constEnd())
+        return it.value();
+    auto id = static_cast<quint32>(m_tokens.size());
+    m_tokenIds.insert(token, id);
+    m_tokens.push_back(token);
+    m_tokenSongs.emplace_back();
+
+    std::vector<quint64> trigrams;
+    for (int i = 0; i + 3 <= token.size(); i++)
+        trigrams.push_back(trigramKey(token.constData() + i));
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    for (auto trigram : trigrams)
+        m_trigramTokens[trigram].push_back(id);
+    return id;
+}
+
+std::vector<quint32> SongSearchIndex::tokensContaining(const QString &needle) const
+{
+    std::vector<quint32> ids;
+    if (needle.size() < 3)
+    {
+        // Too short to have a trigram, check the vocabulary directly
+        for (quint32 id = 0; id < m_tokens.size(); id++)
+        {
+            if (m_tokens[id].contains(needle))
+                ids.push_back(id);
+        }
+        return ids;
+    }
+
+    std::vector<const std::vector<quint32>*> lists;
+    for (int i = 0; i + 3 <= needle.size(); i++)
+    {
+        auto it = m_trigramTokens.find(trigramKey(needle.constData() + i));
+        if (it == m_trigramTokens.end())
+            return ids;
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](auto a, auto b) { return a->size() < b->size(); });
+    ids = *lists.front();
+    std::vector<quint32> intersection;
+    for (size_t i = 1; i < lists.size() && !ids.empty(); i++)
+    {
+        intersection.clear();
+        std::set_intersection(ids.begin(), ids.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(intersection));
+        ids.swap(intersection);
+    }
+    // Sharing all trigrams doesn't guarantee the token contains the needle
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [&](quint32 id) {
+        return !m_tokens[id].contains(needle);
+    }), ids.end());
+    return ids;
+}
+
+quint64 SongSearchIndex::trigramKey(const QChar *chars)
+{
+    return (static_cast<quint64>(chars[0].unicode()) << 32) |
+           (static_cast<quint64>(chars[1].unicode()) << 16) |
+           static_cast<quint64>(chars[2].unicode());
+}
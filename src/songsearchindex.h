@@ -0,0 +1,64 @@
+#ifndef SONGSEARCHINDEX_H
+#define SONGSEARCHINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Inverted index used to narrow down karaoke song searches.
+ *
+ * Every song's search text is split on spaces into tokens. Each distinct token is stored once with a
+ * posting list of the songs containing it, and the token vocabulary itself is indexed by trigram.
+ * Since search needles never contain spaces, a needle can only match a song's text inside one of its
+ * tokens, so matching needles against the (much smaller) vocabulary and intersecting the posting
+ * lists yields every song that can match.
+ *
+ * Results are a superset: the caller still verifies candidates against the exact search rules.
+ */
+class SongSearchIndex
+{
+public:
+    using Row = quint32;
+
+    void clear();
+    void reserve(size_t songCount);
+
+    /**
+     * @brief Index a song under every form of its text that may be searched.
+     * @param row Stable handle for the song, rows are expected to be small consecutive numbers.
+     */
+    void addSong(Row row, const QStringList &texts);
+    void removeSong(Row row);
+
+    /**
+     * @brief Sets the order candidates are returned in, call after the song list is (re)sorted.
+     */
+    void setOrder(const std::vector<Row> &rows);
+
+    /**
+     * @brief Find the songs that may contain all of the given needles.
+     * @param needles Lowercase search terms without spaces.
+     * @return Candidate rows in the order given to setOrder(), or nullopt if the needles can't narrow
+     * the search down and every song has to be checked.
+     */
+    [[nodiscard]] std::optional<std::vector<Row>> candidates(const QStringList &needles) const;
+
+private:
+    std::vector<bool> m_indexed;
+    std::vector<Row> m_order;
+
+    QHash<QString, quint32> m_tokenIds;
+    std::vector<QString> m_tokens;
+    std::vector<std::vector<Row>> m_tokenSongs;
+    std::unordered_map<quint64, std::vector<quint32>> m_trigramTokens;
+
+    quint32 tokenId(const QString &token);
+    [[nodiscard]] std::vector<quint32> tokensContaining(const QString &needle) const;
+    static quint64 trigramKey(const QChar *chars);
+};
+
+#endif // SONGSEARCHINDEX_H
@@ -1,6 +1,9 @@
 #include "tagreader.h"
 #include <tag.h>
 #include <taglib/fileref.h>
+#include <taglib.h>
+#include <mpegfile.h>
+#include <tbytevectorstream.h>
 
 TagReader::TagReader(QObject *parent) : QObject(parent)
 {
@@ -96,17 +99,8 @@ void TagReader::taglibTags(const QString& path)
     TagLib::FileRef f(path.toLocal8Bit().data());
     if (!f.isNull())
     {
-        m_artist = f.tag()->artist().toCString(true);
-        m_title = f.tag()->title().toCString(true);
+        setTaglibTags(f.tag());
         m_duration = f.audioProperties()->length() * 1000;
-        m_album = f.tag()->album().toCString(true);
-        auto track = f.tag()->track();
-        if (track == 0)
-            m_track = QString();
-        else if (track < 10)
-            m_track = "0" + QString::number(track);
-        else
-            m_track = QString::number(track);
         m_logger->info("{} Taglib result: Artist: {} - Title: {} - Album: {} - Track: {} - Duration: {}", m_loggingPrefix, m_artist, m_title, m_album, m_track, m_duration);
     }
     else
@@ -115,6 +109,47 @@ void TagReader::taglibTags(const QString& path)
         m_artist = QString();
         m_title = QString();
         m_album = QString();
+        m_track = QString();
         m_duration = 0;
     }
 }
+
+// Parses tags out of mp3 data that is already in memory, which may be nothing more than the ID3v2 tag
+// at the start of the file. Audio properties aren't read, so the duration is left alone.
+void TagReader::taglibTags(const QByteArray &mp3Data)
+{
+    TagLib::ByteVector buffer(mp3Data.constData(), static_cast<unsigned int>(mp3Data.size()));
+    TagLib::ByteVectorStream stream(buffer);
+#if TAGLIB_MAJOR_VERSION >= 2
+    TagLib::MPEG::File f(&stream, false);
+#else
+    TagLib::MPEG::File f(&stream, TagLib::ID3v2::FrameFactory::instance(), false);
+#endif
+    if (f.isValid())
+    {
+        setTaglibTags(f.tag());
+        m_logger->info("{} Taglib result: Artist: {} - Title: {} - Album: {} - Track: {}", m_loggingPrefix, m_artist, m_title, m_album, m_track);
+    }
+    else
+    {
+        m_logger->error("{} Taglib was unable to process the in-memory mp3 data", m_loggingPrefix);
+        m_artist = QString();
+        m_title = QString();
+        m_album = QString();
+        m_track = QString();
+    }
+}
+
+void TagReader::setTaglibTags(TagLib::Tag *tag)
+{
+    m_artist = tag->artist().toCString(true);
+    m_title = tag->title().toCString(true);
+    m_album = tag->album().toCString(true);
+    auto track = tag->track();
+    if (track == 0)
+        m_track = QString();
+    else if (track < 10)
+        m_track = "0" + QString::number(track);
+    else
+        m_track = QString::number(track);
+}
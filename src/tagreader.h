@@ -10,6 +10,10 @@
 
 std::ostream& operator<<(std::ostream& os, const QString& s);
 
+namespace TagLib {
+class Tag;
+}
+
 
 class TagReader : public QObject
 {
@@ -35,6 +39,10 @@ public:
     unsigned int getDuration() const;
     void setMedia(const QString& path);
     void taglibTags(const QString& path);
+    void taglibTags(const QByteArray& mp3Data);
+
+private:
+    void setTaglibTags(TagLib::Tag *tag);
 
 signals:
 
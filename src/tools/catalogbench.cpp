@@ -0,0 +1,183 @@
+// okj-catalogbench - karaoke song list memory and load time benchmark
+//
+// Loads a synthetic library into the two layouts the karaoke song list has used: a vector of shared okj::KaraokeSong
+// objects with lowercase copies of their text, as before KaraokeSongCatalog, and the catalog itself. Reports the load
+// time and how much the resident set grew for each. Every layout runs in a child process of its own so memory freed
+// by one can't hide what the other allocates. With the catalog loaded it then times appending songs one at a time,
+// each followed by a path lookup, which is what applying a library change to the song list does.
+//
+// Resident set sizes are read from /proc and only reported on Linux.
+//
+// Exit status is 0 if every appended song was found by its path, 2 if any of them wasn't.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QProcess>
+#include <QTextStream>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+#include "karaokesongcatalog.h"
+#include "okjtypes.h"
+
+namespace {
+
+qint64 residentBytes()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    const auto fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+// Libraries are mostly a few thousand artists with many songs each, spread over one directory per disc
+class SongGenerator
+{
+public:
+    explicit SongGenerator(int songCount) : m_rng(songCount)
+    {
+        std::uniform_int_distribution<int> letter('a', 'z');
+        for (int i = 0; i < std::max(1, songCount / 20); i++)
+        {
+            QString artist;
+            for (int j = 0; j < 12; j++)
+                artist += QChar(j % 6 == 0 ? letter(m_rng) - 32 : letter(m_rng));
+            m_artists.append(artist);
+        }
+    }
+
+    okj::KaraokeSong song(int i)
+    {
+        std::uniform_int_distribution<int> artistIndex(0, m_artists.size() - 1);
+        std::uniform_int_distribution<int> titleLength(8, 30);
+        std::uniform_int_distribution<int> letter('a', 'z');
+        okj::KaraokeSong song;
+        song.id = i + 1;
+        song.artist = m_artists.at(artistIndex(m_rng));
+        for (int j = titleLength(m_rng); j > 0; j--)
+            song.title += j % 7 == 0 ? QChar(' ') : QChar(letter(m_rng));
+        song.songid = QString("SC%1-%2").arg(i / 15, 4, 10, QChar('0')).arg(i % 15 + 1, 2, 10, QChar('0'));
+        song.filename = song.songid + " - " + song.artist + " - " + song.title;
+        song.path = QString("/media/karaoke/SC%1/").arg(i / 15, 4, 10, QChar('0')) + song.filename + ".zip";
+        song.duration = 180000 + i % 120000;
+        song.plays = i % 7;
+        song.searchString = QString(song.filename + " " + song.artist + " " + song.title + " " + song.songid).replace('&', " and ").toLower();
+        return song;
+    }
+
+private:
+    std::mt19937 m_rng;
+    QStringList m_artists;
+};
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("okj-catalogbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares memory use and load time of the karaoke song list layouts.");
+    parser.addHelpOption();
+    QCommandLineOption songsOption("songs", "Songs in the generated library, 200000 by default.", "count", "200000");
+    QCommandLineOption appendsOption("appends", "Songs appended one at a time after loading, 1000 by default.", "count", "1000");
+    QCommandLineOption layoutOption("layout", "Only run one layout in this process: songs or catalog.", "layout");
+    parser.addOptions({songsOption, appendsOption, layoutOption});
+    parser.process(app);
+
+    const int songCount = std::max(1, parser.value(songsOption).toInt());
+    const int appendCount = std::max(0, parser.value(appendsOption).toInt());
+    QTextStream out(stdout);
+
+    if (!parser.isSet(layoutOption))
+    {
+        out << "layout\tsongs\tload_ms\trss_kib\tappend_lookup_us\n";
+        out.flush();
+        int status = 0;
+        for (const auto &layout : {"songs", "catalog"})
+        {
+            QProcess child;
+            child.setProcessChannelMode(QProcess::ForwardedChannels);
+            child.start(QCoreApplication::applicationFilePath(), {"--songs", QString::number(songCount), "--appends",
+                        QString::number(appendCount), "--layout", layout});
+            if (!child.waitForFinished(-1) || child.exitCode() != 0)
+                status = std::max(status, child.exitCode() == 2 ? 2 : 1);
+        }
+        return status;
+    }
+
+    const QString layout = parser.value(layoutOption);
+    SongGenerator generator(songCount);
+    const qint64 rssBefore = residentBytes();
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::shared_ptr<okj::KaraokeSong>> songs;
+    KaraokeSongCatalog catalog;
+    if (layout == "songs")
+    {
+        songs.reserve(songCount);
+        for (int i = 0; i < songCount; i++)
+        {
+            auto song = generator.song(i);
+            song.artistL = song.artist.toLower();
+            song.titleL = song.title.toLower();
+            song.songidL = song.songid.toLower();
+            songs.push_back(std::make_shared<okj::KaraokeSong>(song));
+        }
+    }
+    else if (layout == "catalog")
+    {
+        catalog.reserve(songCount);
+        for (int i = 0; i < songCount; i++)
+            catalog.append(generator.song(i));
+    }
+    else
+    {
+        out << "Unknown layout " << layout << "\n";
+        return 1;
+    }
+    const qint64 loadMs = timer.elapsed();
+    const qint64 rssAfter = residentBytes();
+
+    QString appendResult = "-";
+    bool allFound = true;
+    if (layout == "catalog" && appendCount > 0)
+    {
+        // The first lookup sorts the path index of the bulk load, keep that out of the appends
+        catalog.rowForPath(generator.song(0).path);
+        std::vector<okj::KaraokeSong> appended;
+        for (int i = 0; i < appendCount; i++)
+            appended.push_back(generator.song(songCount + i));
+        timer.start();
+        for (const auto &song : appended)
+        {
+            auto row = catalog.append(song);
+            allFound = allFound && catalog.rowForPath(song.path) == row;
+        }
+        appendResult = QString::number(timer.nsecsElapsed() / 1000 / appendCount);
+    }
+
+    out << layout << "\t" << songCount << "\t" << loadMs << "\t"
+        << (rssBefore < 0 || rssAfter < 0 ? QString("n/a") : QString::number((rssAfter - rssBefore) / 1024))
+        << "\t" << appendResult << "\n";
+    if (!allFound)
+    {
+        out << "Appended songs were not found by their path\n";
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,497 @@
+// okj-cdgscan - headless CDG decode benchmark and corruption scanner
+//
+// Decodes every .cdg below the given paths, including the ones inside media+g zips, on all cores and reports
+// decode throughput, seek index build time, frame count and corrupted packets for each file. Meant to be run against
+// a library before a show, or nightly to catch performance regressions in the decoder.
+//
+// With --frame-bench it instead times the frame decoder against the QImage based one it replaced on the files below
+// the given paths, and checks both draw the same frames. Without paths it uses generated tile, scroll and mixed packet
+// streams.
+//
+// With --upscale-check it also scales every frame the way CdgAppSrc does, rescaling only what changed, and counts the
+// frames that come out different from scaling the whole frame.
+//
+// Exit status is 0 if every file decoded cleanly, 2 if any file is unreadable, has corrupted packets or frames that
+// scaled differently. With --frame-bench it is 2 if the two decoders drew different frames.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "cdg/cdgfilereader.h"
+#include "cdg/cdgupscaler.h"
+#include "mzarchive.h"
+#include "tools/legacycdgimageframe.h"
+
+std::ostream & operator<<(std::ostream& os, const QString& s)
+{
+    return os << s.toStdString();
+}
+
+struct ScanResult {
+    QString path;
+    QString error;
+    int packets{0};
+    int frames{0};
+    qint64 decodeUs{0};
+    qint64 indexUs{0};
+    cdg::PacketErrors packetErrors;
+    // Frames CdgUpscaler scaled differently from a full rescale, -1 if not checked
+    int upscaleMismatches{-1};
+
+    [[nodiscard]] bool isBad() const { return !error.isEmpty() || packetErrors.total() > 0 || upscaleMismatches > 0; }
+};
+
+// Scales every frame like CdgAppSrc does, only rescaling what changed, and compares it with the whole frame scaled
+// from scratch. Returns the number of frames that differ at any of the factors.
+static int checkUpscaler(const QByteArray &cdgData)
+{
+    std::vector<CdgUpscaler> incremental;
+    std::vector<CdgUpscaler> full;
+    std::vector<std::vector<uchar>> incrementalBuffers;
+    std::vector<std::vector<uchar>> fullBuffers;
+    for (int factor : {2, 3, 4})
+    {
+        incremental.emplace_back(factor);
+        full.emplace_back(factor);
+        incrementalBuffers.emplace_back(incremental.back().outputBufferSize());
+        fullBuffers.emplace_back(full.back().outputBufferSize());
+    }
+
+    int mismatches{0};
+    CdgFileReader reader(cdgData);
+    while (reader.moveToNextFrame())
+    {
+        bool same = true;
+        for (size_t i = 0; i < incremental.size(); i++)
+        {
+            incremental[i].render(reader.currentFrame().data(), reader.currentFrameChangedRect(), incrementalBuffers[i].data());
+            full[i].invalidate();
+            full[i].render(reader.currentFrame().data(), QRect(), fullBuffers[i].data());
+            same = same && incrementalBuffers[i] == fullBuffers[i];
+        }
+        if (!same)
+            mismatches++;
+    }
+    return mismatches;
+}
+
+// The cdg data of a bare .cdg or of the one in a zip, empty with error set if there is none
+static QByteArray readCdgData(const QString &path, QString &error)
+{
+    QByteArray cdgData;
+    if (path.endsWith(".zip", Qt::CaseInsensitive))
+    {
+        MzArchive archive(path);
+        if (!archive.checkCDG())
+        {
+            error = "no cdg in archive";
+            return {};
+        }
+        cdgData = archive.readCdgData();
+    }
+    else
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            error = file.errorString();
+            return {};
+        }
+        cdgData = file.readAll();
+    }
+    if (cdgData.size() < (int)sizeof(cdg::CDG_SubCode))
+    {
+        error = "empty or unreadable cdg data";
+        return {};
+    }
+    return cdgData;
+}
+
+static ScanResult scanFile(const QString &path, bool checkUpscale)
+{
+    ScanResult result;
+    result.path = path;
+
+    const QByteArray cdgData = readCdgData(path, result.error);
+    if (cdgData.isEmpty())
+        return result;
+
+    // Same work the player does, timed apart: render each frame, and build the seek index, which decodes every
+    // packet once more. The player builds the index off the GUI thread while the song starts.
+    CdgFileReader reader(cdgData);
+    QElapsedTimer timer;
+    timer.start();
+    while (reader.moveToNextFrame())
+        result.frames++;
+    result.decodeUs = timer.nsecsElapsed() / 1000;
+    timer.start();
+    reader.buildIndex();
+    result.indexUs = timer.nsecsElapsed() / 1000;
+    result.packets = cdgData.size() / (int)sizeof(cdg::CDG_SubCode);
+    result.packetErrors = reader.packetErrors();
+    if (checkUpscale)
+        result.upscaleMismatches = checkUpscaler(cdgData);
+    return result;
+}
+
+namespace {
+
+// Packets between two frames going out, the player's 30 fps at 300 packets per second
+constexpr int PACKETS_PER_FRAME = 10;
+
+cdg::CDG_SubCode makePacket(cdg::CdgCommand instruction, const std::array<char,16> &data)
+{
+    cdg::CDG_SubCode packet{};
+    packet.command = static_cast<cdg::CdgCommand>(0x09);
+    packet.instruction = instruction;
+    packet.data = data;
+    return packet;
+}
+
+cdg::CDG_SubCode tilePacket(std::mt19937 &rng, cdg::CdgCommand instruction)
+{
+    std::uniform_int_distribution<int> color(0, 15);
+    std::uniform_int_distribution<int> row(0, 17);
+    std::uniform_int_distribution<int> column(0, 49);
+    std::uniform_int_distribution<int> pixels(0, 63);
+    std::array<char,16> data{};
+    data[0] = static_cast<char>(color(rng));
+    data[1] = static_cast<char>(color(rng));
+    data[2] = static_cast<char>(row(rng));
+    data[3] = static_cast<char>(column(rng));
+    for (int i = 4; i < 16; i++)
+        data[i] = static_cast<char>(pixels(rng));
+    return makePacket(instruction, data);
+}
+
+// Scrolls by a whole tile in one of the four directions and leaves the offsets at 0
+cdg::CDG_SubCode scrollPacket(std::mt19937 &rng, cdg::CdgCommand instruction)
+{
+    std::uniform_int_distribution<int> direction(0, 3);
+    std::uniform_int_distribution<int> color(0, 15);
+    std::array<char,16> data{};
+    data[0] = static_cast<char>(color(rng));
+    const int dir = direction(rng);
+    if (dir < 2)
+        data[1] = static_cast<char>((dir + 1) << 4);
+    else
+        data[2] = static_cast<char>((dir - 1) << 4);
+    return makePacket(instruction, data);
+}
+
+cdg::CDG_SubCode colorsPacket(std::mt19937 &rng, cdg::CdgCommand instruction)
+{
+    std::uniform_int_distribution<int> bits(0, 63);
+    std::array<char,16> data{};
+    for (auto &byte : data)
+        byte = static_cast<char>(bits(rng));
+    return makePacket(instruction, data);
+}
+
+// Mostly tiles, as in the lyrics of a typical song, with the odd XOR highlight, scroll, palette change and clear
+cdg::CDG_SubCode mixedPacket(std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> kind(0, 999);
+    const int k = kind(rng);
+    if (k < 880)
+        return tilePacket(rng, cdg::CmdTileBlock);
+    if (k < 980)
+        return tilePacket(rng, cdg::CmdTileBlockXOR);
+    if (k < 990)
+        return scrollPacket(rng, cdg::CmdScrollCopy);
+    if (k < 998)
+        return colorsPacket(rng, k % 2 ? cdg::CmdColorsLow : cdg::CmdColorsHigh);
+    std::array<char,16> data{};
+    data[0] = static_cast<char>(k % 16);
+    return makePacket(cdg::CmdMemoryPreset, data);
+}
+
+struct FrameBenchWorkload {
+    QString name;
+    std::function<cdg::CDG_SubCode(std::mt19937 &)> packet;
+    // The old decoder filled the wrong column on a preset scroll to the left, its frames differ there
+    bool comparable{true};
+};
+
+// Decodes the packets and sends out a frame every PACKETS_PER_FRAME packets like the player, returns the time taken by
+// the fastest of the runs
+template <typename Frame>
+qint64 timeFrameDecoder(const std::vector<cdg::CDG_SubCode> &packets, int runs)
+{
+    std::vector<uchar> buffer(cdg::CDG_IMAGE_SIZE);
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int run = 0; run < runs; run++)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        Frame frame;
+        for (size_t i = 0; i < packets.size(); i++)
+        {
+            frame.applySubCode(packets[i]);
+            if ((i + 1) % PACKETS_PER_FRAME == 0)
+                frame.copyCroppedImagedata(buffer.data());
+        }
+        best = std::min(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+bool sameFrames(const std::vector<cdg::CDG_SubCode> &packets)
+{
+    std::vector<uchar> legacyBuffer(cdg::CDG_IMAGE_SIZE);
+    std::vector<uchar> buffer(cdg::CDG_IMAGE_SIZE);
+    LegacyCdgImageFrame legacyFrame;
+    CdgImageFrame frame;
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        legacyFrame.applySubCode(packets[i]);
+        frame.applySubCode(packets[i]);
+        if ((i + 1) % PACKETS_PER_FRAME != 0)
+            continue;
+        legacyFrame.copyCroppedImagedata(legacyBuffer.data());
+        frame.copyCroppedImagedata(buffer.data());
+        if (legacyBuffer != buffer)
+            return false;
+    }
+    return true;
+}
+
+int frameBench(QTextStream &out, int packetCount, int runs)
+{
+    const QVector<FrameBenchWorkload> workloads {
+        {"tiles", [] (std::mt19937 &rng) { return tilePacket(rng, cdg::CmdTileBlock); }},
+        {"xor tiles", [] (std::mt19937 &rng) { return tilePacket(rng, cdg::CmdTileBlockXOR); }},
+        {"scroll copy", [] (std::mt19937 &rng) { return scrollPacket(rng, cdg::CmdScrollCopy); }},
+        {"scroll preset", [] (std::mt19937 &rng) { return scrollPacket(rng, cdg::CmdScrollPreset); }, false},
+        {"mixed", mixedPacket}
+    };
+
+    out << "workload\tpackets\tlegacy_ns/packet\tns/packet\tspeedup\tframes\n";
+    bool allSame = true;
+    for (const auto &workload : workloads)
+    {
+        std::mt19937 rng(packetCount);
+        std::vector<cdg::CDG_SubCode> packets;
+        packets.reserve(packetCount);
+        for (int i = 0; i < packetCount; i++)
+            packets.push_back(workload.packet(rng));
+
+        const qint64 legacyNs = timeFrameDecoder<LegacyCdgImageFrame>(packets, runs);
+        const qint64 ns = timeFrameDecoder<CdgImageFrame>(packets, runs);
+        QString result = "-";
+        if (workload.comparable)
+        {
+            const bool same = sameFrames(packets);
+            result = same ? "SAME" : "DIFFERENT";
+            allSame = allSame && same;
+        }
+        out << workload.name << "\t" << packetCount << "\t"
+            << QString::number(static_cast<double>(legacyNs) / packetCount, 'f', 1) << "\t"
+            << QString::number(static_cast<double>(ns) / packetCount, 'f', 1) << "\t"
+            << QString::number(static_cast<double>(legacyNs) / std::max<qint64>(1, ns), 'f', 2) << "\t"
+            << result << "\n";
+        out.flush();
+    }
+    return allSame ? 0 : 2;
+}
+
+struct FileBenchResult {
+    QString path;
+    QString error;
+    int packets{0};
+    qint64 legacyNs{0};
+    qint64 ns{0};
+    bool same{true};
+};
+
+FileBenchResult benchFile(const QString &path, int runs)
+{
+    FileBenchResult result;
+    result.path = path;
+    const QByteArray cdgData = readCdgData(path, result.error);
+    if (cdgData.isEmpty())
+        return result;
+    std::vector<cdg::CDG_SubCode> packets(cdgData.size() / sizeof(cdg::CDG_SubCode));
+    memcpy(packets.data(), cdgData.constData(), packets.size() * sizeof(cdg::CDG_SubCode));
+    result.packets = static_cast<int>(packets.size());
+    result.legacyNs = timeFrameDecoder<LegacyCdgImageFrame>(packets, runs);
+    result.ns = timeFrameDecoder<CdgImageFrame>(packets, runs);
+    result.same = sameFrames(packets);
+    return result;
+}
+
+QString packetsPerSecond(qint64 packets, qint64 ns)
+{
+    return QString::number(ns > 0 ? packets * 1000000000LL / ns : 0);
+}
+
+// Both decoders over real songs, the files are decoded in parallel but every one of them on a single thread
+int fileFrameBench(QTextStream &out, const QStringList &files, int runs)
+{
+    const auto results = QtConcurrent::blockingMapped<QVector<FileBenchResult>>(files, [runs] (const QString &path) {
+        return benchFile(path, runs);
+    });
+
+    out << "frames\tpackets\tlegacy_packets/s\tpackets/s\tspeedup\tpath\n";
+    qint64 totalPackets{0};
+    qint64 totalLegacyNs{0};
+    qint64 totalNs{0};
+    int different{0};
+    for (const auto &result : results)
+    {
+        if (!result.error.isEmpty())
+        {
+            out << "ERROR\t\t\t\t\t" << result.path << "\t" << result.error << "\n";
+            continue;
+        }
+        totalPackets += result.packets;
+        totalLegacyNs += result.legacyNs;
+        totalNs += result.ns;
+        if (!result.same)
+            different++;
+        out << (result.same ? "SAME" : "DIFFERENT") << "\t"
+            << result.packets << "\t"
+            << packetsPerSecond(result.packets, result.legacyNs) << "\t"
+            << packetsPerSecond(result.packets, result.ns) << "\t"
+            << QString::number(static_cast<double>(result.legacyNs) / std::max<qint64>(1, result.ns), 'f', 2) << "\t"
+            << result.path << "\n";
+    }
+    out << "\nFiles: " << results.size() << ", drawn differently: " << different
+        << ", packets: " << totalPackets
+        << ", legacy throughput: " << packetsPerSecond(totalPackets, totalLegacyNs) << " packets/s per thread"
+        << ", throughput: " << packetsPerSecond(totalPackets, totalNs) << " packets/s per thread"
+        << ", speedup: " << QString::number(static_cast<double>(totalLegacyNs) / std::max<qint64>(1, totalNs), 'f', 2) << "\n";
+    out.flush();
+    return different > 0 ? 2 : 0;
+}
+
+}
+
+static QStringList findFiles(const QStringList &paths)
+{
+    QStringList files;
+    auto isCandidate = [] (const QString &name) {
+        return name.endsWith(".cdg", Qt::CaseInsensitive) || name.endsWith(".zip", Qt::CaseInsensitive);
+    };
+    for (const auto &path : paths)
+    {
+        if (QFileInfo(path).isFile())
+        {
+            if (isCandidate(path))
+                files.append(path);
+            continue;
+        }
+        QDirIterator it(path, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+            auto file = it.next();
+            if (isCandidate(file))
+                files.append(file);
+        }
+    }
+    return files;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("okj-cdgscan");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Decodes every CDG file (bare or zipped) below the given paths and reports "
+                                     "decode throughput, frame counts and corrupted packets.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Directories or files to scan.", "<path>...");
+    QCommandLineOption threadsOption({"j", "threads"}, "Number of files to decode in parallel, all cores by default.", "count");
+    QCommandLineOption badOnlyOption("bad-only", "Only list files that are unreadable or have corrupted packets.");
+    QCommandLineOption frameBenchOption("frame-bench", "Time the frame decoder against the one it replaced instead of "
+                                        "scanning files, on the given files or on generated packets without paths. The "
+                                        "old decoder drew left preset scrolls wrong, songs using them differ.");
+    QCommandLineOption packetsOption("packets", "Generated packets per --frame-bench workload, 180000 (10 minutes) by default.",
+                                     "count", "180000");
+    QCommandLineOption runsOption("runs", "Runs per --frame-bench workload or file, the fastest one counts. 5 by default.", "count", "5");
+    QCommandLineOption upscaleCheckOption("upscale-check", "Also check that scaling only the changed part of each frame "
+                                          "gives the same result as scaling the whole frame, at 2x, 3x and 4x.");
+    parser.addOptions({threadsOption, badOnlyOption, frameBenchOption, packetsOption, runsOption, upscaleCheckOption});
+    parser.process(app);
+
+    if (parser.isSet(frameBenchOption) && parser.positionalArguments().isEmpty())
+    {
+        QTextStream out(stdout);
+        return frameBench(out, std::max(PACKETS_PER_FRAME, parser.value(packetsOption).toInt()),
+                          std::max(1, parser.value(runsOption).toInt()));
+    }
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+    if (parser.isSet(threadsOption) && parser.value(threadsOption).toInt() > 0)
+        QThreadPool::globalInstance()->setMaxThreadCount(parser.value(threadsOption).toInt());
+
+    // The decoder and archive code log through the app's logger, the report below covers what they'd warn about
+    auto logger = spdlog::stderr_color_mt("logger");
+    logger->set_level(spdlog::level::err);
+
+    QTextStream out(stdout);
+    if (parser.isSet(frameBenchOption))
+        return fileFrameBench(out, findFiles(parser.positionalArguments()), std::max(1, parser.value(runsOption).toInt()));
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+    const auto files = findFiles(parser.positionalArguments());
+    const bool checkUpscale = parser.isSet(upscaleCheckOption);
+    const auto results = QtConcurrent::blockingMapped<QVector<ScanResult>>(files, [checkUpscale] (const QString &path) {
+        return scanFile(path, checkUpscale);
+    });
+
+    out << "status\tpackets\tframes\tms\tpackets/s\tindex_ms\trow\tcolumn\tcolor\tscroll\tupscale\tpath\n";
+    int badFiles{0};
+    qint64 totalPackets{0};
+    qint64 totalDecodeUs{0};
+    qint64 totalIndexUs{0};
+    for (const auto &result : results)
+    {
+        totalPackets += result.packets;
+        totalDecodeUs += result.decodeUs;
+        totalIndexUs += result.indexUs;
+        if (result.isBad())
+            badFiles++;
+        else if (parser.isSet(badOnlyOption))
+            continue;
+        if (!result.error.isEmpty())
+        {
+            out << "ERROR\t\t\t\t\t\t\t\t\t\t\t" << result.path << "\t" << result.error << "\n";
+            continue;
+        }
+        const auto &errors = result.packetErrors;
+        out << (errors.total() > 0 ? "CORRUPT" : result.upscaleMismatches > 0 ? "UPSCALE" : "OK") << "\t"
+            << result.packets << "\t"
+            << result.frames << "\t"
+            << result.decodeUs / 1000 << "\t"
+            << (result.decodeUs > 0 ? result.packets * 1000000LL / result.decodeUs : 0) << "\t"
+            << result.indexUs / 1000 << "\t"
+            << errors.row << "\t" << errors.column << "\t" << errors.color << "\t" << errors.scroll << "\t"
+            << (result.upscaleMismatches < 0 ? QString("-") : QString::number(result.upscaleMismatches)) << "\t"
+            << result.path << "\n";
+    }
+
+    // Per core throughput, comparable between runs regardless of the number of threads
+    out << "\nFiles: " << results.size() << ", bad: " << badFiles
+        << ", packets: " << totalPackets
+        << ", decode throughput: " << (totalDecodeUs > 0 ? totalPackets * 1000000LL / totalDecodeUs : 0) << " packets/s per thread"
+        << ", index throughput: " << (totalIndexUs > 0 ? totalPackets * 1000000LL / totalIndexUs : 0) << " packets/s per thread"
+        << ", threads: " << QThreadPool::globalInstance()->maxThreadCount()
+        << ", wall time: " << wallTimer.elapsed() << "ms\n";
+    out.flush();
+
+    return badFiles > 0 ? 2 : 0;
+}
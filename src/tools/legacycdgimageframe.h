@@ -0,0 +1,36 @@
+#ifndef LEGACYCDGIMAGEFRAME_H
+#define LEGACYCDGIMAGEFRAME_H
+
+#include <QImage>
+#include "cdg/libCDG.h"
+
+// CdgImageFrame as it was before it drew into a raw pixel buffer: tiles are drawn one pixel at a time through the
+// scanlines of an indexed QImage. Only kept for okj-cdgscan to compare the two against each other.
+class LegacyCdgImageFrame
+{
+public:
+    LegacyCdgImageFrame();
+
+    bool applySubCode(const cdg::CDG_SubCode &subCode);
+
+    void copyCroppedImagedata(uchar *destbuffer);
+
+private:
+    QImage m_image;
+
+    int m_bytesPerPixel;
+    int m_borderLRBytes;
+    int m_borderRBytesOffset;
+    int m_curVOffset;
+    int m_curHOffset;
+
+    bool m_lastCmdWasMempreset {false};
+
+    void cmdScroll(const cdg::CdgScrollCmdData &scrollCmdData, const cdg::ScrollType type);
+    void cmdTileBlock(const cdg::CdgTileBlockData &tileBlockPacket, const cdg::TileBlockType &type);
+    bool cmdMemoryPreset(const cdg::CdgMemoryPresetData &memoryPreset);
+    void cmdBorderPreset(const cdg::CdgBorderPresetData &borderPreset);
+    bool cmdColors(const cdg::CdgColorsData &data,const cdg::CdgColorTables &table);
+};
+
+#endif // LEGACYCDGIMAGEFRAME_H
@@ -0,0 +1,301 @@
+// okj-rotationcrashtest - rotation crash consistency check
+//
+// Rotation changes reach the database in batches written by RotationDbWriter on its own thread, and singers are
+// inserted straight away by TableModelRotation. This checks that the rotationsingers table is consistent whenever the
+// process dies: a child process loads the rotation from a scratch database and keeps adding, moving, renaming,
+// deleting and flagging singers as regulars through TableModelRotation until it is killed at a random moment. Before
+// every batch it writes the rotations the table may hold until the batch is on disk to a side file. The database is
+// then checked for singer positions that are not exactly 0 to n-1 and for names and regular flags that match none of
+// those rotations. The next child starts from whatever the last one left behind.
+//
+// The settings are kept in Qt's test locations, the real OpenKJ settings aren't touched.
+//
+// Exit status is 0 if the positions were contiguous after every kill, 2 if they weren't after any of them.
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include "models/tablemodelrotation.h"
+
+std::ostream & operator<<(std::ostream& os, const QString& s)
+{
+    return os << s.toStdString();
+}
+
+namespace {
+
+constexpr int MAX_SINGERS = 40;
+
+bool createSchema(const QString &dbFileName)
+{
+    auto db = QSqlDatabase::addDatabase("QSQLITE", "schema");
+    db.setDatabaseName(dbFileName);
+    bool ok = db.open();
+    {
+        QSqlQuery query(db);
+        ok = ok && query.exec("PRAGMA journal_mode=WAL");
+        // The columns of these tables the rotation model uses, as created by MainWindow::dbInit()
+        ok = ok && query.exec("CREATE TABLE dbSongs ( songid INTEGER PRIMARY KEY AUTOINCREMENT, Artist COLLATE NOCASE, "
+                              "Title COLLATE NOCASE, DiscId COLLATE NOCASE, 'Duration' INTEGER, path VARCHAR(700) NOT NULL UNIQUE, "
+                              "filename COLLATE NOCASE, searchstring TEXT)");
+        ok = ok && query.exec("CREATE TABLE rotationSingers ( singerid INTEGER PRIMARY KEY AUTOINCREMENT, name COLLATE NOCASE UNIQUE, "
+                              "'position' INTEGER NOT NULL, 'regular' LOGICAL DEFAULT(0), 'regularid' INTEGER, addts TIMESTAMP)");
+        ok = ok && query.exec("CREATE TABLE queueSongs ( qsongid INTEGER PRIMARY KEY AUTOINCREMENT, singer INT, song INTEGER NOT NULL, "
+                              "artist INT, title INT, discid INT, path INT, keychg INT, played LOGICAL DEFAULT(0), 'position' INT)");
+    }
+    db.close();
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("schema");
+    return ok;
+}
+
+// A rotation as the names and regular flags of its singers in position order
+QJsonArray rotationState(TableModelRotation &rotation)
+{
+    QJsonArray singers;
+    for (int position = 0; position < static_cast<int>(rotation.singerCount()); position++)
+    {
+        const auto &singer = rotation.getSingerAtPosition(position);
+        singers.append(QJsonArray{singer.name, singer.regular});
+    }
+    return singers;
+}
+
+// Rotations the table may hold if the child dies now
+bool writeExpectedStates(const QString &fileName, const std::vector<QJsonArray> &states)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QJsonArray array;
+    for (const auto &state : states)
+        array.append(state);
+    file.write(QJsonDocument(array).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QJsonArray readExpectedStates(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return {};
+    return QJsonDocument::fromJson(file.readAll()).array();
+}
+
+// Empty if the positions are 0 to n-1, otherwise what is wrong with them
+QString checkPositions(const QString &dbFileName, int &singerCount, QJsonArray &state)
+{
+    QString problem;
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", "check");
+        db.setDatabaseName(dbFileName);
+        if (!db.open())
+            return "unable to open the database: " + db.lastError().text();
+        QSqlQuery query(db);
+        query.exec("SELECT position, name, regular FROM rotationsingers ORDER BY position");
+        singerCount = 0;
+        state = QJsonArray();
+        while (query.next() && problem.isEmpty())
+        {
+            const int position = query.value(0).toInt();
+            if (position != singerCount)
+                problem = QString("expected position %1, found %2").arg(singerCount).arg(position);
+            state.append(QJsonArray{query.value(1).toString(), query.value(2).toBool()});
+            singerCount++;
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("check");
+    return problem;
+}
+
+// Runs until killed
+int runChild(const QString &dbFileName, const QString &expectedFileName, int round)
+{
+    auto logger = spdlog::stderr_color_mt("logger");
+    logger->set_level(spdlog::level::err);
+    auto db = QSqlDatabase::addDatabase("QSQLITE");
+    db.setDatabaseName(dbFileName);
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=30000");
+    if (!db.open())
+        return 1;
+
+    TableModelRotation rotation;
+    rotation.loadData();
+    if (!writeExpectedStates(expectedFileName, {rotationState(rotation)}))
+        return 1;
+    int named{0};
+    auto newName = [&] () { return QString("Singer %1-%2").arg(round).arg(named++); };
+    QTimer timer;
+    timer.setInterval(2);
+    QObject::connect(&timer, &QTimer::timeout, [&] () {
+        auto random = QRandomGenerator::global();
+        const auto committed = rotationState(rotation);
+        const int singerCount = static_cast<int>(rotation.singerCount());
+        std::vector<QJsonArray> pending;
+        if (singerCount < 2 || (random->bounded(10) < 3 && singerCount < MAX_SINGERS))
+        {
+            // The insert is on disk before singerAdd() returns, at the bottom, the move to the hinted position isn't
+            const auto name = newName();
+            auto inserted = committed;
+            inserted.append(QJsonArray{name, false});
+            if (!writeExpectedStates(expectedFileName, {committed, inserted}))
+                QApplication::exit(1);
+            rotation.singerAdd(name, random->bounded(3));
+            pending = {inserted, rotationState(rotation)};
+        }
+        else
+        {
+            // Several changes in one batch, none of them reach the disk before waitForCommit()
+            for (int changes = random->bounded(1, 5); changes > 0 && rotation.singerCount() > 1; changes--)
+            {
+                const int count = static_cast<int>(rotation.singerCount());
+                const auto &singer = rotation.getSingerAtPosition(random->bounded(count));
+                switch (random->bounded(5))
+                {
+                    case 0:
+                        rotation.singerMove(random->bounded(count), random->bounded(count));
+                        break;
+                    case 1:
+                        rotation.singerDelete(singer.id);
+                        break;
+                    case 2:
+                        rotation.singerSetRegular(singer.id, !singer.regular);
+                        break;
+                    case 3:
+                        rotation.singerSetName(singer.id, newName());
+                        break;
+                    default:
+                    {
+                        // Hand one singer's name to another in the same batch
+                        const int otherId = rotation.getSingerAtPosition(random->bounded(count)).id;
+                        if (otherId == singer.id)
+                            break;
+                        const QString name = singer.name;
+                        const int singerId = singer.id;
+                        rotation.singerSetName(singerId, newName());
+                        rotation.singerSetName(otherId, name);
+                        break;
+                    }
+                }
+            }
+            pending = {committed, rotationState(rotation)};
+        }
+        if (!writeExpectedStates(expectedFileName, pending) || !rotation.waitForCommit() ||
+                !writeExpectedStates(expectedFileName, {rotationState(rotation)}))
+            QApplication::exit(1);
+    });
+    timer.start();
+    return QApplication::exec();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    // The rotation model draws its icons, it needs a GUI application but no display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QStandardPaths::setTestModeEnabled(true);
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Kills a process editing the rotation at random moments and checks the singer "
+                                     "positions it left in the database.");
+    parser.addHelpOption();
+    QCommandLineOption roundsOption("rounds", "Number of processes to kill, 50 by default.", "count", "50");
+    QCommandLineOption maxRunOption("max-run", "Longest a process runs before it is killed, in ms. 2000 by default.", "ms", "2000");
+    QCommandLineOption childOption("child", "Internal: edit the rotation in the given database until killed.", "db");
+    QCommandLineOption roundOption("round", "Internal: round number of the child.", "round", "0");
+    childOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    roundOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOptions({roundsOption, maxRunOption, childOption, roundOption});
+    parser.process(app);
+
+    if (parser.isSet(childOption))
+        return runChild(parser.value(childOption), parser.value(childOption) + ".expected", parser.value(roundOption).toInt());
+
+    QTextStream out(stdout);
+    QTemporaryDir tempDir;
+    const QString dbFileName = QDir(tempDir.path()).filePath("openkj.sqlite");
+    if (!tempDir.isValid() || !createSchema(dbFileName))
+    {
+        out << "Unable to create the scratch database\n";
+        return 1;
+    }
+
+    const QString expectedFileName = dbFileName + ".expected";
+    const int rounds = std::max(1, parser.value(roundsOption).toInt());
+    const int maxRunMs = std::max(10, parser.value(maxRunOption).toInt());
+    int failures{0};
+    // What the table held when the last child was killed, a child killed before it wrote its first state left it alone
+    QJsonArray lastState;
+    out << "round\trun_ms\tsingers\tresult\n";
+    for (int round = 0; round < rounds; round++)
+    {
+        QFile::remove(expectedFileName);
+        QProcess child;
+        child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        child.start(QCoreApplication::applicationFilePath(), {"--child", dbFileName, "--round", QString::number(round)});
+        if (!child.waitForStarted())
+        {
+            out << "Unable to start the child process\n";
+            return 1;
+        }
+        const int runMs = QRandomGenerator::global()->bounded(10, maxRunMs + 1);
+        if (child.waitForFinished(runMs))
+        {
+            out << "Child exited on its own with status " << child.exitCode() << "\n";
+            return 1;
+        }
+        child.kill();
+        child.waitForFinished();
+
+        int singerCount{0};
+        QJsonArray state;
+        auto problem = checkPositions(dbFileName, singerCount, state);
+        if (problem.isEmpty())
+        {
+            auto expected = readExpectedStates(expectedFileName);
+            if (!QFile::exists(expectedFileName))
+                expected.append(lastState);
+            if (!expected.contains(state))
+                problem = QString("names or regular flags match none of the %1 expected rotations").arg(expected.size());
+        }
+        lastState = state;
+        out << round << "\t" << runMs << "\t" << singerCount << "\t" << (problem.isEmpty() ? "OK" : problem) << "\n";
+        out.flush();
+        if (!problem.isEmpty())
+        {
+            failures++;
+            // Start the next round from a consistent rotation again
+            QSqlDatabase::addDatabase("QSQLITE", "reset").setDatabaseName(dbFileName);
+            {
+                auto db = QSqlDatabase::database("reset");
+                QSqlQuery(db).exec("DELETE FROM rotationsingers");
+                db.close();
+            }
+            QSqlDatabase::removeDatabase("reset");
+            lastState = QJsonArray();
+        }
+    }
+    out << failures << " of " << rounds << " kills left inconsistent positions\n";
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,156 @@
+// okj-scanbench - library directory walk benchmark
+//
+// Times the directory walk the database updater does when it looks for karaoke files: the single threaded recursive
+// QDirIterator walk it used to do against DirectoryWalker at a range of thread counts. Both are run over the same tree
+// and their sorted results compared. Without a path a synthetic library is generated in a temp dir, by default 100k
+// files spread over 5k directories. Point it at a network share to see the effect of round trip latency.
+//
+// Exit status is 0 if every walk found the same files, 2 if any of them differs from the QDirIterator walk.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include "directorywalker.h"
+
+static bool createTree(const QString &root, int dirCount, int fileCount)
+{
+    // Two levels, artist dirs holding disc dirs, like most libraries are laid out
+    const int artistCount = std::max(1, static_cast<int>(std::sqrt(dirCount)));
+    QStringList dirs;
+    for (int i = 0; i < dirCount; i++)
+    {
+        auto dir = QString("%1/Artist %2/Disc %3").arg(root).arg(i % artistCount, 4, 10, QChar('0')).arg(i, 5, 10, QChar('0'));
+        if (!QDir().mkpath(dir))
+            return false;
+        dirs.append(dir);
+    }
+    // Mostly mp3+g pairs, some zips, the odd file the scanner has to skip
+    for (int i = 0; i < fileCount; i++)
+    {
+        const auto base = QString("%1/SC%2 - Artist %3 - Title %2").arg(dirs.at(i % dirCount)).arg(i, 6, 10, QChar('0')).arg(i % artistCount);
+        QString name;
+        switch (i % 10)
+        {
+            case 0:
+            case 1:
+                name = base + ".zip";
+                break;
+            case 9:
+                name = base + ".txt";
+                break;
+            default:
+                name = base + (i % 2 ? ".cdg" : ".mp3");
+        }
+        QFile file(name);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+    }
+    return true;
+}
+
+static QStringList iteratorWalk(const QString &root)
+{
+    QStringList files;
+    QDirIterator iterator(QDir(root).absolutePath(), QDirIterator::Subdirectories);
+    while (iterator.hasNext())
+    {
+        iterator.next();
+        if (!iterator.fileInfo().isDir())
+            files.append(iterator.filePath());
+    }
+    files.sort();
+    return files;
+}
+
+static QStringList parallelWalk(const QString &root, int threads)
+{
+    DirectoryWalker walker(threads);
+    std::vector<QStringList> files(walker.threadCount());
+    walker.walk({root}, [&files] (int worker, const QString &dirPrefix, const QStringList &fileNames) {
+        for (const auto &fileName : fileNames)
+            files[worker].append(dirPrefix + fileName);
+    });
+    return DirectoryWalker::mergeSorted(files);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("okj-scanbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times the single threaded QDirIterator walk against DirectoryWalker over a "
+                                     "generated library or an existing directory.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("path", "Existing directory to walk instead of a generated one.", "[path]");
+    QCommandLineOption dirsOption("dirs", "Directories in the generated library, 5000 by default.", "count", "5000");
+    QCommandLineOption filesOption("files", "Files in the generated library, 100000 by default.", "count", "100000");
+    QCommandLineOption runsOption("runs", "Walks per variant, the fastest one counts. 3 by default.", "count", "3");
+    QCommandLineOption maxThreadsOption("max-threads", "Highest thread count to try, twice the cores by default.", "count");
+    parser.addOptions({dirsOption, filesOption, runsOption, maxThreadsOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTemporaryDir tempDir;
+    QString root;
+    if (!parser.positionalArguments().isEmpty())
+    {
+        root = parser.positionalArguments().first();
+    }
+    else
+    {
+        root = tempDir.path();
+        out << "Generating " << parser.value(filesOption) << " files in " << parser.value(dirsOption) << " directories below " << root << "\n";
+        out.flush();
+        if (!createTree(root, std::max(1, parser.value(dirsOption).toInt()), parser.value(filesOption).toInt()))
+        {
+            out << "Unable to create the library\n";
+            return 1;
+        }
+    }
+    const int runs = std::max(1, parser.value(runsOption).toInt());
+    const int maxThreads = parser.isSet(maxThreadsOption) ? parser.value(maxThreadsOption).toInt() : QThread::idealThreadCount() * 2;
+
+    // The first walk warms the dentry cache, after that every variant sees the same one
+    const auto expected = iteratorWalk(root);
+    auto timeWalk = [runs] (const std::function<QStringList()> &walk, QStringList &files) {
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int i = 0; i < runs; i++)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            files = walk();
+            best = std::min(best, timer.elapsed());
+        }
+        return best;
+    };
+
+    out << "walker\tthreads\tms\tfiles\tfiles/s\tspeedup\tresult\n";
+    QStringList files;
+    const auto baseline = timeWalk([&root] () { return iteratorWalk(root); }, files);
+    out << "QDirIterator\t1\t" << baseline << "\t" << files.size() << "\t" << files.size() * 1000LL / std::max<qint64>(1, baseline)
+        << "\t1.00\t" << (files == expected ? "OK" : "DIFFERENT") << "\n";
+    out.flush();
+    bool allMatch = files == expected;
+    for (int threads = 1; threads <= std::max(1, maxThreads); threads *= 2)
+    {
+        const auto elapsed = timeWalk([&root, threads] () { return parallelWalk(root, threads); }, files);
+        out << "DirectoryWalker\t" << threads << "\t" << elapsed << "\t" << files.size() << "\t" << files.size() * 1000LL / std::max<qint64>(1, elapsed)
+            << "\t" << QString::number(static_cast<double>(baseline) / std::max<qint64>(1, elapsed), 'f', 2)
+            << "\t" << (files == expected ? "OK" : "DIFFERENT") << "\n";
+        out.flush();
+        allMatch = allMatch && files == expected;
+    }
+
+    return allMatch ? 0 : 2;
+}
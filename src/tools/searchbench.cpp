@@ -0,0 +1,225 @@
+// okj-searchbench - karaoke song search benchmark
+//
+// Times karaoke song searches over a synthetic library two ways: the linear scan of every song's search text that
+// the song list did before SongSearchIndex, and the index's candidate lookup followed by the same check of each
+// candidate. Libraries of 10k, 100k and 500k songs are generated by default, the text is made up of a small set of
+// common words plus a long tail of rare ones, like real song titles. Both ways are checked to return the same songs.
+//
+// Exit status is 0 if every search returned the same songs both ways, 2 if any of them differs.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+#include "songsearchindex.h"
+
+namespace {
+
+struct Song {
+    QString searchString;
+    QString artist;
+    QString title;
+};
+
+const QStringList commonWords {
+    "love", "you", "me", "the", "my", "i", "a", "to", "of", "in", "heart", "baby", "night", "don't", "can't",
+    "girl", "man", "time", "little", "blue", "home", "rock", "roll", "world", "way", "good", "day", "dream", "fire",
+    "christmas", "crazy", "sweet", "kiss", "dance", "on", "be", "it's", "all", "your", "song"
+};
+
+QString rareWord(std::mt19937 &rng)
+{
+    static const QStringList syllables {
+        "ka", "ra", "o", "ke", "lin", "tor", "bel", "ma", "sun", "der", "vi", "el", "ston", "gar", "ney", "pha",
+        "que", "zu", "mi", "lo", "an", "ber", "ish", "ro", "chi", "wen", "dy", "ta", "son", "ex"
+    };
+    std::uniform_int_distribution<int> syllableCount(2, 4);
+    std::uniform_int_distribution<int> syllable(0, syllables.size() - 1);
+    QString word;
+    for (int i = syllableCount(rng); i > 0; i--)
+        word += syllables.at(syllable(rng));
+    return word;
+}
+
+QString words(std::mt19937 &rng, int count, const QStringList &rareWords)
+{
+    std::uniform_int_distribution<int> common(0, commonWords.size() - 1);
+    std::uniform_int_distribution<int> rare(0, rareWords.size() - 1);
+    std::bernoulli_distribution pickCommon(0.6);
+    QStringList picked;
+    for (int i = 0; i < count; i++)
+        picked.append(pickCommon(rng) ? commonWords.at(common(rng)) : rareWords.at(rare(rng)));
+    return picked.join(' ');
+}
+
+std::vector<Song> createLibrary(int songCount)
+{
+    std::mt19937 rng(songCount);
+    QStringList rareWords;
+    for (int i = 0; i < std::max(1000, songCount / 10); i++)
+        rareWords.append(rareWord(rng));
+    QStringList artists;
+    std::uniform_int_distribution<int> artistWords(1, 3);
+    for (int i = 0; i < std::max(1, songCount / 20); i++)
+        artists.append(words(rng, artistWords(rng), rareWords));
+
+    std::uniform_int_distribution<int> artist(0, artists.size() - 1);
+    std::uniform_int_distribution<int> titleWords(1, 5);
+    std::vector<Song> songs;
+    songs.reserve(songCount);
+    for (int i = 0; i < songCount; i++)
+    {
+        Song song;
+        song.artist = artists.at(artist(rng));
+        song.title = words(rng, titleWords(rng), rareWords);
+        const QString songId = QString("SC%1-%2").arg(i / 15, 4, 10, QChar('0')).arg(i % 15 + 1, 2, 10, QChar('0'));
+        const QString fileName = songId + " - " + song.artist + " - " + song.title;
+        // Same as DbUpdater's searchstring and the song list's haystacks
+        song.searchString = (fileName + " " + song.artist + " " + song.title + " " + songId).toLower().replace('&', " and ");
+        songs.push_back(song);
+    }
+    return songs;
+}
+
+// The song list's search with "ignore apostrophes" on, over the artist, title and file name
+QStringList needlesFor(const QString &search)
+{
+    QString text = search.toLower();
+    text.replace(',', ' ');
+    text.replace('&', " and ");
+    text.replace('\'', ' ');
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+    return text.split(' ', QString::SkipEmptyParts);
+#else
+    return text.split(' ', Qt::SkipEmptyParts);
+#endif
+}
+
+bool songMatches(const Song &song, const QStringList &needles)
+{
+    QString haystack = song.searchString;
+    if (haystack.contains('\''))
+        haystack.remove('\'');
+    return std::all_of(needles.begin(), needles.end(), [&haystack](const QString &needle) {
+        return haystack.contains(needle);
+    });
+}
+
+std::vector<SongSearchIndex::Row> linearSearch(const std::vector<Song> &songs, const QStringList &needles)
+{
+    std::vector<SongSearchIndex::Row> rows;
+    for (SongSearchIndex::Row row = 0; row < songs.size(); row++)
+    {
+        if (songMatches(songs[row], needles))
+            rows.push_back(row);
+    }
+    return rows;
+}
+
+std::vector<SongSearchIndex::Row> indexedSearch(const std::vector<Song> &songs, const SongSearchIndex &index,
+                                                const QStringList &needles, size_t &candidateCount)
+{
+    auto candidates = index.candidates(needles);
+    if (!candidates.has_value())
+    {
+        candidateCount = songs.size();
+        return linearSearch(songs, needles);
+    }
+    candidateCount = candidates->size();
+    std::vector<SongSearchIndex::Row> rows;
+    for (auto row : *candidates)
+    {
+        if (songMatches(songs[row], needles))
+            rows.push_back(row);
+    }
+    return rows;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("okj-searchbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times karaoke song searches with and without SongSearchIndex over generated libraries.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma separated library sizes, 10000,100000,500000 by default.", "counts",
+                                   "10000,100000,500000");
+    QCommandLineOption runsOption("runs", "Runs per search, the fastest one counts. 5 by default.", "count", "5");
+    QCommandLineOption searchOption("search", "Search to time, may be given more than once. A mix of short, common, "
+                                    "rare and multi word searches by default.", "text");
+    parser.addOptions({sizesOption, runsOption, searchOption});
+    parser.process(app);
+
+    QStringList searches = parser.values(searchOption);
+    if (searches.isEmpty())
+        searches = QStringList{"e", "lo", "love", "love you", "don't stop", "sc0042", "christmas baby", "kalinstor", "zzzz"};
+    const int runs = std::max(1, parser.value(runsOption).toInt());
+
+    auto timeSearch = [runs] (const std::function<std::vector<SongSearchIndex::Row>()> &search,
+                              std::vector<SongSearchIndex::Row> &rows) {
+        qint64 best = std::numeric_limits<qint64>::max();
+        for (int i = 0; i < runs; i++)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            rows = search();
+            best = std::min(best, timer.nsecsElapsed() / 1000);
+        }
+        return best;
+    };
+
+    QTextStream out(stdout);
+    bool allMatch = true;
+    for (const auto &size : parser.value(sizesOption).split(','))
+    {
+        const int songCount = size.toInt();
+        if (songCount <= 0)
+            continue;
+        const auto songs = createLibrary(songCount);
+
+        QElapsedTimer timer;
+        timer.start();
+        SongSearchIndex index;
+        index.reserve(songs.size());
+        std::vector<SongSearchIndex::Row> order;
+        order.reserve(songs.size());
+        for (SongSearchIndex::Row row = 0; row < songs.size(); row++)
+        {
+            const auto &song = songs[row];
+            index.addSong(row, {song.searchString, song.artist.toLower(), song.title.toLower()});
+            order.push_back(row);
+        }
+        index.setOrder(order);
+        out << songCount << " songs indexed in " << timer.elapsed() << "ms\n";
+        out << "songs\tsearch\tscan_us\tindex_us\tcandidates\tresults\tspeedup\tresult\n";
+        out.flush();
+
+        for (const auto &search : qAsConst(searches))
+        {
+            const auto needles = needlesFor(search);
+            std::vector<SongSearchIndex::Row> expected;
+            std::vector<SongSearchIndex::Row> rows;
+            size_t candidateCount{0};
+            const auto scanUs = timeSearch([&] () { return linearSearch(songs, needles); }, expected);
+            const auto indexUs = timeSearch([&] () { return indexedSearch(songs, index, needles, candidateCount); }, rows);
+            out << songCount << "\t" << search << "\t" << scanUs << "\t" << indexUs << "\t" << candidateCount
+                << "\t" << expected.size()
+                << "\t" << QString::number(static_cast<double>(scanUs) / std::max<qint64>(1, indexUs), 'f', 1)
+                << "\t" << (rows == expected ? "OK" : "DIFFERENT") << "\n";
+            out.flush();
+            allMatch = allMatch && rows == expected;
+        }
+        out << "\n";
+    }
+
+    return allMatch ? 0 : 2;
+}